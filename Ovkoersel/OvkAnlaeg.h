@@ -0,0 +1,327 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Overkørsel anlæg med mange overkørsler
+ * Version: 1.1
+ * Type: Bibliotek
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel kerne komponenter.
+ *
+ * "Overkørsel anlæg" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel anlæg" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel anlæg".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Inkluderes af Ovkoersel.h, når BrugAnlaeg er defineret. Kræver BrugTilstandstabel.
+ * Version 1.1: Tid tælles hver klokcyklus i tilstande med timer, også når betingelserne ikke er opfyldt
+ */
+
+#ifndef OvkAnlaeg_h
+#define OvkAnlaeg_h
+
+#ifndef BrugTilstandstabel
+#error "Anlæg kræver BrugTilstandstabel"
+#endif
+
+// Ansvar: Afvikler mange ens overkørsler i ét program. Alle overkørsler bruger samme tilstandstabel og konfiguration.
+// Hver overkørsels data ligger i arrays per komponenttype, og en klokcyklus gennemløber hvert array for alle overkørsler.
+// En bit per betjeningsenhed og per ydre enhed, så MaxNoCtrls og MaxNoDevices højst må være 8.
+// Betjeningsenheder: Kontaktprel filtreres med lodrette tællere som InPort. Flipflop og status som t_FlipFlop og t_CrossingCtrl.
+// Tilstande: Som t_Crossing med tilstandstabel. Tilstand bliver kun evalueret ved start, ved ny status eller når tid er startet.
+// Tid tælles i klokcyklusser og udløber som t_ClockWork. I en tilstand med en overgang med timer tælles hver klokcyklus,
+// og tiden starter forfra når den udløber, også når betingelserne ikke er opfyldt.
+// Ydre enheder: RAILSIGNAL som t_RailSignal med hvid lanterne, ROADSIGNAL som t_RoadSignal og BARRIER som t_Barrier.
+// Alle vejbomme i en overkørsel bevæger sig samtidigt i barrierTime.
+// Udgange: 2 bit per ydre enhed. Bit 2*n: Lampe eller vejbom er nede. Bit 2*n+1: Hvid lanterne eller vejbom bevæger sig
+// DIRECT: Betjeningsenhed uden flipflop
+// RAILSIGNAL, ROADSIGNAL, BARRIER: Typer af ydre enheder
+// MaxNoCrossings: Antal overkørsler der er plads til
+// noCrossings: Antal oprettede overkørsler
+// raw, value, count0-2: Indgange, filtreret værdi og lodrette tællere for kontaktprel
+// prevInput, bistable, oneshot: Flipflop for alle betjeningsenheder
+// lastStatus: Status ved seneste evaluering af tilstand
+// timed: Bit per tilstand med en overgang med timer
+// state, entry, timer, period: Tilstand, ENTRY mangler, tid tilbage og tidens længde i klokcyklusser
+// deviceState: Bit er sat når ydre enhed er sat til PASS
+// output, blinkHigh, blinking: Udgange, blinkfase og udgange der blinker
+// barrierMove: Klokcyklusser til vejbomme står stille
+// setTable(...): Kobler tabeller med overgange og handlinger til alle overkørsler
+// setCtrl(...), setDevice(...), setBarrierTime(...): Konfigurerer alle overkørsler ens
+// add(...): Opretter en overkørsel i starttilstand. Leverer index eller NoCrossing
+// setInput(...): Sætter indgangene til en overkørsel. En bit per betjeningsenhed
+// doClockCycle(...): Gennemløber en klokcyklus for alle overkørsler. Kaldes efter Blinker::doClockCycle()
+// status(...), stateOf(...), outputOf(...): Leverer en overkørsels status, tilstand og udgange
+// dispatchCount(...): Leverer antal overkørsler hvor tilstand blev evalueret i seneste klokcyklus
+template <unsigned int MaxNoCrossings>
+class t_CrossingFleet {
+public:
+  enum {DIRECT = 0xFF};
+  enum {RAILSIGNAL, ROADSIGNAL, BARRIER};
+  static const unsigned int NoCrossing = 0xFFFF;
+private:
+  static_assert((MaxNoCtrls <= 8) && (MaxNoDevices <= 8), "Anlæg kan højst bruge 8 betjeningsenheder og 8 ydre enheder");
+  static_assert(MaxNoCrossings < NoCrossing, "For mange overkørsler");
+  enum {BounceTime = 30, BounceCycles = BounceTime/Clock::ClockCycle+1};
+  // Konfiguration fælles for alle overkørsler
+  const StateTable::t_Transition *transitions = nullptr;
+  const StateTable::t_Action *actions = nullptr;
+  byte firstTransition[MaxNoStates+1] = {};
+  byte firstAction[MaxNoStates+1] = {};
+  byte timed[(MaxNoStates+7)/8] = {};
+  byte startState = 0;
+  byte ctrlMask = 0, closedMask = 0, directMask = 0, bistableMask = 0, oneshotMask = 0;
+  byte railMask = 0, roadMask = 0, barrierMask = 0, initialPass = 0;
+  unsigned int barrierCycles = 1;
+  unsigned int noCrossings = 0;
+  unsigned int dispatched = 0;
+  // Data per overkørsel
+  byte raw[MaxNoCrossings];
+  byte value[MaxNoCrossings];
+  byte count0[MaxNoCrossings];
+  byte count1[MaxNoCrossings];
+  byte count2[MaxNoCrossings];
+  byte prevInput[MaxNoCrossings];
+  byte bistable[MaxNoCrossings];
+  byte oneshot[MaxNoCrossings];
+  byte lastStatus[MaxNoCrossings];
+  byte state[MaxNoCrossings];
+  bool entry[MaxNoCrossings];
+  unsigned int timer[MaxNoCrossings];
+  unsigned int period[MaxNoCrossings];
+  byte deviceState[MaxNoCrossings];
+  unsigned int output[MaxNoCrossings];
+  unsigned int blinkHigh[MaxNoCrossings];
+  unsigned int blinking[MaxNoCrossings];
+  unsigned int barrierMove[MaxNoCrossings];
+  static unsigned int lampBit(byte deviceName) {return 1U << (2*deviceName);}
+  static unsigned int secondBit(byte deviceName) {return 2U << (2*deviceName);}
+  byte statusOf(unsigned int index) const {
+    return (value[index] & directMask) | (bistable[index] & bistableMask) | (oneshot[index] & oneshotMask);
+  }
+  void to(unsigned int index, byte deviceName, byte deviceState);
+  void doActions(unsigned int index, byte when);
+  byte doCondition(unsigned int index, byte status);
+public:
+  template <size_t NoTransitions, size_t NoActions>
+  void setTable(const StateTable::t_Transition (&a_transitions)[NoTransitions], const StateTable::t_Action (&a_actions)[NoActions], byte a_startState) {
+    transitions = a_transitions;
+    actions = a_actions;
+    startState = a_startState;
+    StateTable::makeIndex(a_transitions, firstTransition);
+    StateTable::makeIndex(a_actions, firstAction);
+    StateTable::markTimed(a_transitions, timed);
+  }
+  void setCtrl(byte ctrlName, byte contact, byte flipflopType = DIRECT);
+  void setDevice(byte deviceName, byte kind, byte a_state = BLOCK);
+  void setBarrierTime(unsigned long barrierTime) {barrierCycles = (barrierTime/Clock::ClockCycle > 0)?barrierTime/Clock::ClockCycle:1;}
+  unsigned int add(void);
+  void setInput(unsigned int index, byte inputs) {raw[index] = inputs;}
+  void doClockCycle(void);
+  unsigned int size(void) const {return noCrossings;}
+  byte status(unsigned int index, byte ctrlName) const {return ((statusOf(index) >> ctrlName) & 1)?ON:OFF;}
+  byte stateOf(unsigned int index) const {return state[index];}
+  unsigned int outputOf(unsigned int index) const {return output[index];}
+  unsigned int dispatchCount(void) const {return dispatched;}
+};
+
+template <unsigned int MaxNoCrossings>
+void t_CrossingFleet<MaxNoCrossings>::setCtrl(byte ctrlName, byte contact, byte flipflopType) {
+  if (ctrlName >= MaxNoCtrls) return;
+  byte mask = 1 << ctrlName;
+  ctrlMask |= mask;
+  if (contact == NCLOSED) closedMask |= mask;
+  else closedMask &= ~mask;
+  directMask &= ~mask; bistableMask &= ~mask; oneshotMask &= ~mask;
+  if (flipflopType == BISTABLE) bistableMask |= mask;
+  else if (flipflopType == ONESHOT) oneshotMask |= mask;
+  else directMask |= mask;
+}
+
+template <unsigned int MaxNoCrossings>
+void t_CrossingFleet<MaxNoCrossings>::setDevice(byte deviceName, byte kind, byte a_state) {
+  if (deviceName >= MaxNoDevices) return;
+  byte mask = 1 << deviceName;
+  railMask &= ~mask; roadMask &= ~mask; barrierMask &= ~mask;
+  if (kind == RAILSIGNAL) railMask |= mask;
+  if (kind == ROADSIGNAL) roadMask |= mask;
+  if (kind == BARRIER) barrierMask |= mask;
+  if (a_state == PASS) initialPass |= mask;
+  else initialPass &= ~mask;
+}
+
+template <unsigned int MaxNoCrossings>
+unsigned int t_CrossingFleet<MaxNoCrossings>::add(void) {
+  if (noCrossings >= MaxNoCrossings) return NoCrossing;
+  unsigned int index = noCrossings++;
+  // Knapper i hvile: NCLOSED har pullup og læses høj
+  raw[index] = value[index] = prevInput[index] = closedMask;
+  count0[index] = count1[index] = count2[index] = 0;
+  bistable[index] = oneshot[index] = lastStatus[index] = 0;
+  state[index] = startState;
+  entry[index] = true;
+  timer[index] = period[index] = 0;
+  deviceState[index] = 0;
+  output[index] = blinkHigh[index] = blinking[index] = 0;
+  barrierMove[index] = 0;
+  for (byte cnt=0; cnt < MaxNoDevices; cnt++) {
+    byte mask = 1 << cnt;
+    if (((railMask | roadMask) & mask) != 0) to(index, cnt, ((initialPass & mask) != 0)?PASS:BLOCK);
+    // Vejbomme står stille i starttilstand
+    if ((barrierMask & mask) != 0) {
+      if ((initialPass & mask) != 0) deviceState[index] |= mask;
+      else output[index] |= lampBit(cnt);
+    }
+  }
+  return index;
+}
+
+template <unsigned int MaxNoCrossings>
+void t_CrossingFleet<MaxNoCrossings>::to(unsigned int index, byte deviceName, byte a_state) {
+  byte mask = 1 << deviceName;
+  if (a_state == PASS) deviceState[index] |= mask;
+  else deviceState[index] &= ~mask;
+  if ((railMask & mask) != 0) {
+    if (a_state == BLOCK) {
+      output[index] = (output[index] | lampBit(deviceName)) & ~secondBit(deviceName);
+      blinking[index] &= ~secondBit(deviceName);
+    }
+    else {
+      output[index] &= ~lampBit(deviceName);
+      blinking[index] |= secondBit(deviceName);
+    }
+  }
+  if ((roadMask & mask) != 0) {
+    if (a_state == PASS) {
+      output[index] &= ~lampBit(deviceName);
+      blinking[index] &= ~lampBit(deviceName);
+    }
+    else blinking[index] |= lampBit(deviceName);
+  }
+  if ((barrierMask & mask) != 0) {
+    // Vender bommen under bevægelse, tager den tilbage samme vej
+    barrierMove[index] = barrierCycles-barrierMove[index];
+    output[index] = (output[index] & ~lampBit(deviceName)) | secondBit(deviceName);
+  }
+}
+
+template <unsigned int MaxNoCrossings>
+void t_CrossingFleet<MaxNoCrossings>::doActions(unsigned int index, byte when) {
+  StateTable::t_Action action;
+  byte stateNo = state[index];
+  for (byte cnt=firstAction[stateNo]; cnt < firstAction[stateNo+1]; cnt++) {
+    memcpy_P(&action, &actions[cnt], sizeof(action));
+    if (action.when != when) continue;
+    switch (action.kind) {
+      case StateTable::TO: if (action.name < MaxNoDevices) to(index, action.name, action.value); break;
+      case StateTable::RESET: bistable[index] &= ~(1 << action.name); oneshot[index] &= ~(1 << action.name); break;
+      case StateTable::MSEC: timer[index] = period[index] = action.value/Clock::ClockCycle; break;
+      case StateTable::SECONDS: timer[index] = period[index] = action.value*1000UL/Clock::ClockCycle; break;
+    }
+  }
+}
+
+template <unsigned int MaxNoCrossings>
+byte t_CrossingFleet<MaxNoCrossings>::doCondition(unsigned int index, byte status) {
+  StateTable::t_Transition transition;
+  byte stateNo = state[index];
+  bool isTimedOut = false;
+  if (StateTable::isTimed(timed, stateNo) == true) {
+    // Som t_ClockWork udløber tiden ved det kald, hvor den har talt ned, og starter forfra
+    if (timer[index] > 1) timer[index]--;
+    else {
+      timer[index] = period[index];
+      isTimedOut = true;
+    }
+  }
+  for (byte cnt=firstTransition[stateNo]; cnt < firstTransition[stateNo+1]; cnt++) {
+    memcpy_P(&transition, &transitions[cnt], sizeof(transition));
+    if ((status & transition.onMask) != transition.onMask) continue;
+    if ((status & transition.offMask) != 0) continue;
+    if ((transition.timer == true) && (isTimedOut == false)) continue;
+    return transition.to;
+  }
+  return stateNo;
+}
+
+template <unsigned int MaxNoCrossings>
+void t_CrossingFleet<MaxNoCrossings>::doClockCycle(void) {
+  unsigned int index;
+  dispatched = 0;
+  // Kontaktprel for alle overkørsler
+  for (index=0; index < noCrossings; index++) {
+    byte delta = (raw[index] ^ value[index]) & ctrlMask;
+    byte next0 = ~count0[index] & delta;
+    byte next1 = (count1[index] ^ count0[index]) & delta;
+    byte next2 = (count2[index] ^ (count1[index] & count0[index])) & delta;
+    byte done = delta;
+    done &= (BounceCycles & 1)?next0:~next0;
+    done &= (BounceCycles & 2)?next1:~next1;
+    done &= (BounceCycles & 4)?next2:~next2;
+    value[index] ^= done;
+    count0[index] = next0 & ~done;
+    count1[index] = next1 & ~done;
+    count2[index] = next2 & ~done;
+  }
+  // Flipflop for alle overkørsler
+  for (index=0; index < noCrossings; index++) {
+    byte changed = value[index] ^ prevInput[index];
+    byte toggle = changed & ((value[index] & ~closedMask) | (~value[index] & closedMask));
+    bistable[index] ^= toggle;
+    oneshot[index] |= bistable[index] & changed;
+    prevInput[index] = value[index];
+  }
+  // Tilstande, kun hvor der er sket noget
+  for (index=0; index < noCrossings; index++) {
+    byte status = statusOf(index);
+    if ((entry[index] == false) && (status == lastStatus[index]) && (timer[index] == 0)) continue;
+    lastStatus[index] = status;
+    dispatched++;
+    if (entry[index] == true) {
+      doActions(index, StateTable::ENTRY);
+      entry[index] = false;
+    }
+    byte nextState = doCondition(index, status);
+    if (nextState != state[index]) {
+      doActions(index, StateTable::EXIT);
+      state[index] = nextState;
+      entry[index] = true;
+      timer[index] = 0;
+    }
+  }
+  // Blink for alle overkørsler
+  if (Blinker::toSubscriber() == true) {
+    for (index=0; index < noCrossings; index++) {
+      output[index] = (output[index] & ~blinking[index]) | (blinkHigh[index] & blinking[index]);
+      blinkHigh[index] ^= blinking[index];
+    }
+  }
+  // Vejbomme for alle overkørsler
+  if (barrierMask != 0) {
+    unsigned int moveBits = 0, downBits = 0;
+    for (byte cnt=0; cnt < MaxNoDevices; cnt++) {
+      if ((barrierMask & (1 << cnt)) != 0) {moveBits |= secondBit(cnt); downBits |= lampBit(cnt);}
+    }
+    for (index=0; index < noCrossings; index++) {
+      if (barrierMove[index] == 0) continue;
+      if (--barrierMove[index] > 0) continue;
+      unsigned int down = 0;
+      for (byte cnt=0; cnt < MaxNoDevices; cnt++) {
+        if (((barrierMask & ~deviceState[index]) & (1 << cnt)) != 0) down |= lampBit(cnt);
+      }
+      output[index] = (output[index] & ~(moveBits | downBits)) | down;
+    }
+  }
+}
+
+#endif
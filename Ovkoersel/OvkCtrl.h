@@ -1,10 +1,10 @@
 /*
  * Projekt: Overkørsel st. enkeltsporet strækning
  * Produkt: Overkørsel betjenings enheder
- * Version: 1.1
+ * Version: 1.8
  * Type: Bibliotek
  * Programmeret af: Jan Birch
- * Opdateret: 17-05-2021
+ * Opdateret: 17-10-2026
  * GNU General Public License version 3
  * This file is part of Overkørsel IO kerne.
  * 
@@ -24,6 +24,13 @@
  * Noter:
  * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
  * Version 1.1: nullptr brugt jf. standard for c++
+ * Version 1.2: Betjeningsenhed melder ændring ved hændelsesstyring
+ * Version 1.3: Flipflop registrerer skift ved BrugSporing
+ * Version 1.4: Flipflop i en byte og magasin i betjeningsenheden ved BrugKompakt
+ * Version 1.5: Ankomsttid fra togets målte hastighed mellem 2 sensorenheder, som vælges med BrugAnkomsttid
+ * Version 1.6: Ankomsttid regnes uden afrunding til 100 msek
+ * Version 1.7: Betjeningsenhed peger på programmets flipflop også ved BrugKompakt
+ * Version 1.8: Ankomsttid holder tider fra millis() i 32 bit, så ventetiden også holder når millis() løber rundt
  */
 
 #include <Arduino.h>
@@ -45,13 +52,25 @@
 // reset(...): Resætter flipflop
 // bistable(...): Udlæser bistabil værdi
 // oneshot(...): Udlæser oneshot værdi
+// Med sporing har hver flipflop et nummer, og hvert skift af bistabil værdi bliver registreret
+// Med kompakt ligger bits i en byte
 class t_FlipFlop {
 private:
   enum {DOWN, UP};
+#ifndef BrugKompakt
   unsigned int flankType : 1;
   unsigned int prevInput : 1;
   unsigned int valueBistable : 1;
   unsigned int valueOneShot : 1;
+#else
+  byte flankType : 1;
+  byte prevInput : 1;
+  byte valueBistable : 1;
+  byte valueOneShot : 1;
+#endif
+#ifdef BrugSporing
+  byte traceNo;
+#endif
 public:
   t_FlipFlop(byte ContacType);
   void update(bool currentInput);
@@ -61,18 +80,31 @@ public:
 };
 
 t_FlipFlop::t_FlipFlop(byte ContacType): valueBistable(OFF), valueOneShot(OFF) {
+#ifdef BrugSporing
+  traceNo = Trace::noFlipFlops++;
+#endif
   flankType = (ContacType==NOPEN)? UP:DOWN;
   prevInput = (ContacType==NCLOSED) ? HIGH:LOW;
 }
 
 void t_FlipFlop::update(bool currentInput) {
   if (prevInput == currentInput) return;
+#ifdef BrugSporing
+  bool prevBistable = valueBistable;
+#endif
   if ((flankType == UP) && (currentInput == HIGH)) valueBistable = !valueBistable;
   if ((flankType == DOWN) && (currentInput == LOW)) valueBistable = !valueBistable;
+#ifdef BrugSporing
+  if (prevBistable != valueBistable) Trace::record(Trace::FLIPFLOP, traceNo | (valueBistable << 7));
+#endif
   if (valueBistable == ON) valueOneShot = ON;
   prevInput = currentInput;
 }
 
+#if defined(BrugKompakt) && !defined(BrugSporing)
+static_assert(sizeof(t_FlipFlop) == 1, "Kompakt flipflop skal ligge i en byte");
+#endif
+
 //----------
 
 // Ansvar: Varetager betjenings- og sensorenheder.
@@ -85,13 +117,34 @@ void t_FlipFlop::update(bool currentInput) {
 // doClockCyckle(...): Udfører polling og overfører værdi fra input til magasin
 // status(...): Leverer kontroludgangens værdi
 // reset(...): Styrer reset af magasin
+// Ved hændelsesstyring:
+// lastStatus: Status ved sidste opslag
+// hasChanged(...): Melder om status har skiftet siden sidste opslag
+// Med kompakt deler flag en byte. Magasinet er programmets flipflop som uden kompakt
 class t_CrossingCtrl {
 private:
   t_DigitalInDrv *p_driver;
   t_FlipFlop *p_flipflop;
+#ifndef BrugKompakt
   byte flipflopType;
+#ifdef BrugHaendelsesstyring
+  byte lastStatus;
+#endif
+#else
+  byte flipflopType : 1;
+  byte lastStatus : 1;
+#endif
 public:
+#if defined(BrugKompakt)
+  t_CrossingCtrl(void): p_driver(nullptr), p_flipflop(nullptr), flipflopType(BISTABLE), lastStatus(OFF) {}
+#elif !defined(BrugHaendelsesstyring)
   t_CrossingCtrl(void): p_driver(nullptr), p_flipflop(nullptr) {}
+#else
+  t_CrossingCtrl(void): p_driver(nullptr), p_flipflop(nullptr), lastStatus(OFF) {}
+#endif
+#ifdef BrugHaendelsesstyring
+  bool hasChanged(void);
+#endif
   void setDriver(t_DigitalInDrv *a_driver) {p_driver = a_driver;}
   void setFlipFlop(t_FlipFlop *a_flipflop, byte a_flipflopType=BISTABLE) {p_flipflop=a_flipflop; flipflopType=a_flipflopType;}
   void doClockCycle(void);
@@ -116,4 +169,117 @@ byte t_CrossingCtrl::status(void) const {
   return outState;
 }
 
+#ifdef BrugHaendelsesstyring
+bool t_CrossingCtrl::hasChanged(void) {
+  byte currentStatus = status();
+  bool changed = (currentStatus != lastStatus);
+  lastStatus = currentStatus;
+  return changed;
+}
+#endif
+
+#ifdef BrugAnkomsttid
+// Ansvar: Måler togets hastighed mellem 2 sensorenheder og beregner, hvor længe advarsel på vejen kan vente,
+// så vejen er lukket lige længe før toget når overkørslen, uanset om det er en hurtig motorvogn eller et langsomt godstog.
+// Målested ligger measureDistance mm før tændsted, og tændsted ligger crossingDistance mm før overkørslen.
+// Ankomsten regnes med sikkerhed: Målt tid mellem sensorerne trækkes SensorJitter fra, toget kan blive speedMargin procent
+// hurtigere efter målestedet, status kan skifte SensorDelay efter toget, og urværk og transition kan koste 2 klokcyklusser.
+// Uden gyldig måling er ventetiden 0, og advarsel starter som uden måling. Det gælder tændsted uden målested,
+// mere end MaxTransit mellem sensorerne og tog, der er for hurtige til at vente.
+// Målested skal have et magasin, så status skifter når toget kommer. update(...) nulstiller det, når passagen er registreret.
+// Seqs: IDLE: Venter på målested. MEASURING: Målested er passeret. MEASURED: Tændsted er passeret efter målested
+// SensorDelay: Længste tid i msek fra toget passerer til status skifter. Kontaktprel på en trykknap og 3 klokcyklusser
+// SensorJitter: Største forskel i msek på de 2 sensorers forsinkelse
+// MaxTransit: Længste tid i msek mellem målested og tændsted
+// p_first, p_second: Målested og tændsted
+// measureDistance, crossingDistance: Afstande i mm
+// warningTime: Mindste tid i msek fra advarsel starter til toget er i overkørslen
+// speedMargin: Procent toget højst bliver hurtigere efter målestedet
+// firstStatus, secondStatus: Sensorernes status ved forrige opdatering
+// firstMillis: Tid målested blev passeret. transit: Målt tid mellem sensorerne. dueMillis: Tid advarsel skal starte.
+//   Tider fra millis() holdes i 32 bit, så forskelle løber rigtigt rundt
+// setSensors(...), setDistances(...), setWarning(...): Opsætning
+// restart(...): Glemmer måling og husker sensorernes status. Kaldes når tilstanden, der venter på tog, starter
+// update(...): Følger sensorerne. Kaldes af tilstanden, der venter på tog, før tændsted bliver læst
+// waitTime(...): Leverer resterende ventetid i msek. 0 uden gyldig måling og når ventetiden er gået.
+//   Tilstanden, der venter, skal skifte når waitTime(...) er 0, og ikke kun på et urværk
+// speed(...): Målt hastighed i mm/sek. 0 uden gyldig måling
+class t_ArrivalTimer {
+private:
+  enum {IDLE, MEASURING, MEASURED};
+  enum {SensorDelay = 30+3*Clock::ClockCycle, SensorJitter = 3*Clock::ClockCycle};
+  enum : unsigned int {MaxTransit = 30000};
+  t_CrossingCtrl *p_first;
+  t_CrossingCtrl *p_second;
+  unsigned int measureDistance;
+  unsigned int crossingDistance;
+  unsigned int warningTime;
+  byte speedMargin;
+  byte seq;
+  byte firstStatus;
+  byte secondStatus;
+  uint32_t firstMillis;
+  unsigned long transit;
+  uint32_t dueMillis;
+public:
+  t_ArrivalTimer(void): p_first(nullptr), p_second(nullptr), measureDistance(1), crossingDistance(0), warningTime(0),
+                        speedMargin(0), seq(IDLE), firstStatus(OFF), secondStatus(OFF), firstMillis(0), transit(0), dueMillis(0) {}
+  void setSensors(t_CrossingCtrl *a_first, t_CrossingCtrl *a_second) {p_first = a_first; p_second = a_second;}
+  void setDistances(unsigned int a_measureDistance, unsigned int a_crossingDistance);
+  void setWarning(unsigned int a_warningTime, byte a_speedMargin) {warningTime = a_warningTime; speedMargin = a_speedMargin;}
+  void restart(void);
+  void update(void);
+  unsigned long waitTime(void) const;
+  unsigned int speed(void) const {return ((seq == MEASURED) && (transit > 0))?(unsigned long)measureDistance*1000/transit:0;}
+};
+
+void t_ArrivalTimer::setDistances(unsigned int a_measureDistance, unsigned int a_crossingDistance) {
+  measureDistance = (a_measureDistance > 0)?a_measureDistance:1;
+  crossingDistance = a_crossingDistance;
+}
+
+void t_ArrivalTimer::restart(void) {
+  seq = IDLE;
+  if ((p_first == nullptr) || (p_second == nullptr)) return;
+  firstStatus = p_first->status();
+  secondStatus = p_second->status();
+}
+
+void t_ArrivalTimer::update(void) {
+  if ((p_first == nullptr) || (p_second == nullptr)) return;
+  byte first = p_first->status();
+  byte second = p_second->status();
+  uint32_t w_millis = millis();
+  if ((seq == MEASURING) && (w_millis-firstMillis > MaxTransit)) seq = IDLE;
+  if ((first == ON) && (firstStatus == OFF)) {
+    firstMillis = w_millis;
+    seq = MEASURING;
+    p_first->reset();
+    first = p_first->status();
+  }
+  if ((second == ON) && (secondStatus == OFF)) {
+    dueMillis = w_millis;
+    if (seq == MEASURING) {
+      transit = w_millis-firstMillis;
+      // Tid fra tændsted til overkørsel, hvis toget kører så hurtigt som muligt. Divideres i 2 trin uden at løbe over 32 bit
+      unsigned long least = (transit > SensorJitter)?transit-SensorJitter:0;
+      unsigned long time = (unsigned long)crossingDistance*least/measureDistance;
+      unsigned long arrival = time/(100+speedMargin)*100+time%(100+speedMargin)*100/(100+speedMargin);
+      unsigned long needed = (unsigned long)warningTime+SensorDelay+2*Clock::ClockCycle;
+      if (arrival > needed) dueMillis += arrival-needed;
+      seq = MEASURED;
+    }
+    else seq = IDLE;
+  }
+  firstStatus = first;
+  secondStatus = second;
+}
+
+unsigned long t_ArrivalTimer::waitTime(void) const {
+  if (seq != MEASURED) return 0;
+  int32_t left = dueMillis-millis();
+  return (left > 0)?left:0;
+}
+#endif
+
 #endif
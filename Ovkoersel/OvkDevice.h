@@ -1,10 +1,10 @@
 /*
  * Projekt: Overkørsel st. enkeltsporet strækning
  * Produkt: Overkørsel eksterne enheder
- * Version: 1.2
+ * Version: 1.6
  * Type: Bibliotek
  * Programmeret af: Jan Birch
- * Opdateret: 11-06-2021
+ * Opdateret: 17-10-2026
  * GNU General Public License version 3
  * This file is part of Overkørsel IO kerne.
  * 
@@ -25,6 +25,10 @@
  * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
  * Version 1.1: nullptr brugt jf. standard for c++
  * Version 1.2: Tilføjet ydre enhed for vejbom
+ * Version 1.3: Ydre enhed melder om den er aktiv ved hændelsesstyring
+ * Version 1.4: Tilføjet ydre enhed for melding til sikringsanlæg
+ * Version 1.5: Tilstand og blinkfase deler en byte ved BrugKompakt
+ * Version 1.6: Signaler læser blinkniveau fra oscillatorbank ved BrugOscillatorbank
 */
 
 #include <Arduino.h>
@@ -40,15 +44,29 @@
 // setDriver(...): Kobler hardware driver til ydre enhed
 // doClockCycle(...): Udfører klokcyklus for ydre enheder, som ikke har den metode
 // to(...): Opdaterer den ydre enheds status
+// isBusy(...): Svarer på om enheden blinker eller bevæger sig. Bruges ved hændelsesstyring
+// Med kompakt deler tilstand og blinkfase for signaler en byte, og signaler spørger blinkerTriggered direkte
+// blinkHigh: Toggler blink
+// Med oscillatorbank læser signaler niveauet fra Oscillator og har ingen blinkfase
 class t_CrossingDevice {
 protected:
   t_DigitalOutDrv *p_driver;
+#if !defined(BrugKompakt) || defined(BrugOscillatorbank)
   byte state;
 public:
   t_CrossingDevice(byte a_state=BLOCK) : p_driver(nullptr), state(a_state) {}
+#else
+  byte state : 7;
+  byte blinkHigh : 1;
+public:
+  t_CrossingDevice(byte a_state=BLOCK) : p_driver(nullptr), state(a_state), blinkHigh(false) {}
+#endif
   void setDriver(t_DigitalOutDrv *a_driver);
   virtual void doClockCycle(void) {}
   virtual void to(byte a_state)=0;
+#ifdef BrugHaendelsesstyring
+  virtual bool isBusy(void) const {return false;}
+#endif
 };
 
 void t_CrossingDevice::setDriver(t_DigitalOutDrv *a_driver) {
@@ -63,16 +81,30 @@ void t_CrossingDevice::setDriver(t_DigitalOutDrv *a_driver) {
 // blinker: Abbonerer på blinker
 // blinkHigh: Toggler blink
 // to(...): Opdaterer den ydre enheds status
+// isBusy(...): Hvid lanterne blinker når signalet viser passér
+// Med oscillatorbank følger hvid lanterne Oscillator::WHITELAMP fra første skift, så der ikke kommer korte blink ved start
 class t_RailSignal: public t_CrossingDevice {
 private:
   t_DigitalOutDrv *p_whiteDrv;
+#if defined(BrugOscillatorbank)
+public:
+  t_RailSignal(byte a_state=BLOCK) : t_CrossingDevice(a_state), p_whiteDrv(nullptr) {}
+#elif !defined(BrugKompakt)
   bool (*blinker)();
   bool blinkHigh;
 public:
   t_RailSignal(byte a_state=BLOCK) : t_CrossingDevice(a_state), p_whiteDrv(nullptr), blinker(blinkerTriggered), blinkHigh(false) {}
+#else
+  bool blinker(void) const {return blinkerTriggered();}
+public:
+  t_RailSignal(byte a_state=BLOCK) : t_CrossingDevice(a_state), p_whiteDrv(nullptr) {}
+#endif
   void setWhiteLamp(t_DigitalOutDrv *a_whiteDrv);
   void doClockCycle(void);
   void to(byte a_state);
+#ifdef BrugHaendelsesstyring
+  bool isBusy(void) const {return (state == PASS) && (p_whiteDrv != nullptr);}
+#endif
 };
 
 void t_RailSignal::setWhiteLamp(t_DigitalOutDrv *a_whiteDrv) {
@@ -83,10 +115,14 @@ void t_RailSignal::setWhiteLamp(t_DigitalOutDrv *a_whiteDrv) {
 void t_RailSignal::doClockCycle(void) {
   if (p_whiteDrv == nullptr) return;
   if (state == PASS) {
+#ifndef BrugOscillatorbank
     if (blinker() == true) {
       p_whiteDrv->write(blinkHigh);
       blinkHigh = !blinkHigh;
     }
+#else
+    if (Oscillator::hasToggled(Oscillator::WHITELAMP) == true) p_whiteDrv->write(Oscillator::level(Oscillator::WHITELAMP));
+#endif
   }
 }
 
@@ -106,23 +142,45 @@ void t_RailSignal::to(byte a_state) {
 // blinker: Abbonerer på blinker
 // blinkHigh: Toggler blink
 // to(...): Opdaterer den ydre enheds status
+// isBusy(...): Vejsignal blinker når det er spærret
+// Med oscillatorbank følger udgangen en oscillator fra første skift:
+// oscillator: Oscillator::ROADLIGHT til vejlys eller Oscillator::BELL til vejklokke
+// setOscillator(...): Vælger oscillator
 class t_RoadSignal: public t_CrossingDevice {
 private:
+#if defined(BrugOscillatorbank)
+  byte oscillator;
+public:
+  t_RoadSignal(byte a_state=BLOCK) : t_CrossingDevice(a_state), oscillator(Oscillator::ROADLIGHT) {}
+  void setOscillator(byte a_oscillator) {oscillator = a_oscillator;}
+#elif !defined(BrugKompakt)
   bool (*blinker)();
   bool blinkHigh;
 public:
   t_RoadSignal(byte a_state=BLOCK) : t_CrossingDevice(a_state), blinker(blinkerTriggered), blinkHigh(false) {}
+#else
+  bool blinker(void) const {return blinkerTriggered();}
+public:
+  t_RoadSignal(byte a_state=BLOCK) : t_CrossingDevice(a_state) {}
+#endif
   void doClockCycle(void);
   void to(byte a_state);
+#ifdef BrugHaendelsesstyring
+  bool isBusy(void) const {return (state == BLOCK) && (p_driver != nullptr);}
+#endif
 };
 
 void t_RoadSignal::doClockCycle(void) {
   if (p_driver == nullptr) return;
   if (state == BLOCK) {
+#ifndef BrugOscillatorbank
     if (blinker() == true) {
       p_driver->write(blinkHigh);
       blinkHigh = !blinkHigh;
     }
+#else
+    if (Oscillator::hasToggled(oscillator) == true) p_driver->write(Oscillator::level(oscillator));
+#endif
   }
 }
   
@@ -134,16 +192,37 @@ void t_RoadSignal::to(byte a_state) {
 
 //----------
 
+// Ansvar: Varetager melding til sikringsanlæg, for eksempel at overkørslen er sikret.
+// Meldingen kan gå til en udgang eller til en seriel forbindelse.
+// to(...): PASS giver høj melding og BLOCK giver lav melding
+class t_Report: public t_CrossingDevice {
+public:
+  t_Report(byte a_state=BLOCK) : t_CrossingDevice(a_state) {}
+  void to(byte a_state);
+};
+
+void t_Report::to(byte a_state) {
+  if (p_driver == nullptr) return;
+  state = a_state;
+  p_driver->write(state == PASS);
+}
+
+//----------
+
 #ifdef BrugVejbom
 
 // Ansvar: Varetager vejsignal
 // doClockCycle: Klokcyklus overføres til driver
 // to(...): Opdaterer den ydre enheds status
+// isBusy(...): Bomdrevet bevæger sig
 class t_Barrier: public t_CrossingDevice {
 public:
   t_Barrier(byte a_state=BLOCK) : t_CrossingDevice(a_state) {}
   void doClockCycle(void) {if (p_driver == nullptr) return; p_driver->doClockCycle();}
   void to(byte a_state);
+#ifdef BrugHaendelsesstyring
+  bool isBusy(void) const {return (p_driver != nullptr) && p_driver->isBusy();}
+#endif
 };
 
 void t_Barrier::to(byte a_state) {
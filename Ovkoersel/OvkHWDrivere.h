@@ -1,10 +1,10 @@
 /*
  * Projekt: Overkørsel st. enkeltsporet strækning
  * Produkt: Overkørsel hardware drivere
- * Version: 1.1
+ * Version: 1.14
  * Type: Bibliotek
  * Programmeret af: Jan Birch
- * Opdateret: 31-05-2021
+ * Opdateret: 17-10-2026
  * GNU General Public License version 3
  * This file is part of Overkørsel IO kerne.
  * 
@@ -24,10 +24,24 @@
  * Noter:
  * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
  * Version 1.1: Tilføjet driver til servomotor
+ * Version 1.2: Trykknap og servomotor vækker tickless klok
+ * Version 1.3: Output driver melder om den er i gang ved hændelsesstyring
+ * Version 1.4: Tilføjet portbuffer til udgange, som vælges med BrugPortbuffer
+ * Version 1.5: Tilføjet portfilter til trykknapper, som vælges med BrugPortfilter
+ * Version 1.6: Trykknap registrerer ændringer ved BrugSporing
+ * Version 1.7: Trykknap registrerer læst niveau før kontaktprel ved BrugSporing
+ * Version 1.8: Servomotor kan følge en forberegnet bomprofil med blød start og stop, som vælges med BrugBomprofil
+ * Version 1.9: Servomotorer kan få pulser fra én timer gennem OvkServoPuls.h, som vælges med BrugServoPuls
+ * Version 1.10: Trykknap og servomotor fylder mindre ved BrugKompakt
+ * Version 1.11: Grænser til servomotor er constexpr, så konfiguration kan tjekkes ved oversættelse
+ * Version 1.12: Input driver til sporsensorer med kantfangst i OvkKant.h, som vælges med BrugKantfangst
+ * Version 1.13: Lampedriver med blød tænd og sluk fra bitvinkelmodulation i OvkLysdaemper.h, som vælges med BrugLysdaemper
+ * Version 1.14: Drivere til 74HC595, 74HC165 og MCP23017 i OvkUdvidelse.h, som vælges med BrugPortudvidelse
  */
 
 #include <Arduino.h>
 #include "OvkTiming.h"
+#include "OvkTrace.h"
 
 #ifndef OvkHWDrivere_h
 #define OvkHWDrivere_h
@@ -47,6 +61,79 @@ public:
 
 //----------
 
+#ifdef BrugPortfilter
+// Ansvar: Filtrering af kontaktprel for alle trykknapper på én gang.
+// Hver hardware port bliver læst én gang per klokcyklus, og alle ben på porten filtreres parallelt med lodrette tællere.
+// Tæller bit 0, 1 og 2 for hvert ben ligger i hver sin byte, så 8 ben tælles med få bitoperationer.
+// Et ben skifter værdi når det har haft ny værdi i BounceCycles klokcyklusser i træk. Et prel nulstiller tælleren.
+// MaxNoPorts: Antal porte der kan have trykknapper. En Uno har 3 porte
+// NoPort: Ben kan ikke tilknyttes en port
+// BounceTime: Tid til kontaktprel i msek, som for en enkelt trykknap
+// BounceCycles: Antal klokcyklusser med ny værdi før benet skifter. Skal kunne tælles med 3 bit
+// t_Port: port: Arduino port. mask: Filtrerede ben. state: Filtreret værdi. count0-2: Lodrette tællere
+// attach(...): Tilknytter et ben og leverer index til port
+// doClockCycle(...): Læser alle porte og filtrerer. Kaldes én gang per klokcyklus før trykknapperne
+// read(...): Udlæser filtreret værdi af et ben
+// Med tickless klok holdes klokken vågen, mens et ben tæller
+namespace InPort {
+  const byte MaxNoPorts=4;
+  const byte NoPort=0xFF;
+  const byte BounceTime=30;
+  const byte BounceCycles=BounceTime/Clock::ClockCycle+1;
+  static_assert((BounceCycles > 0) && (BounceCycles < 8), "Kontaktprel kan ikke tælles med 3 bit");
+  struct t_Port {
+    byte port;
+    byte mask;
+    byte state;
+    byte count0;
+    byte count1;
+    byte count2;
+  };
+  t_Port ports[MaxNoPorts];
+  byte noPorts=0;
+
+  byte attach(byte pin) {
+    byte port = digitalPinToPort(pin);
+    byte index;
+    if (port == NOT_A_PIN) return NoPort;
+    for (index=0; index < noPorts; index++) if (ports[index].port == port) break;
+    if (index == noPorts) {
+      if (noPorts >= MaxNoPorts) return NoPort;
+      ports[index].port = port;
+      noPorts++;
+    }
+    t_Port &item = ports[index];
+    item.mask |= digitalPinToBitMask(pin);
+    item.state = (item.state & ~digitalPinToBitMask(pin)) | (*portInputRegister(port) & digitalPinToBitMask(pin));
+    return index;
+  }
+
+  void doClockCycle(void) {
+    for (byte index=0; index < noPorts; index++) {
+      t_Port &item = ports[index];
+      byte delta = (*portInputRegister(item.port) ^ item.state) & item.mask;
+      // Tæl op hvor benet afviger fra filtreret værdi, nulstil ellers
+      byte next0 = ~item.count0 & delta;
+      byte next1 = (item.count1 ^ item.count0) & delta;
+      byte next2 = (item.count2 ^ (item.count1 & item.count0)) & delta;
+      byte done = delta;
+      done &= (BounceCycles & 1)?next0:~next0;
+      done &= (BounceCycles & 2)?next1:~next1;
+      done &= (BounceCycles & 4)?next2:~next2;
+      item.state ^= done;
+      item.count0 = next0 & ~done;
+      item.count1 = next1 & ~done;
+      item.count2 = next2 & ~done;
+#ifdef BrugTicklessKlok
+      if ((item.count0 | item.count1 | item.count2) != 0) Clock::stayAwake();
+#endif
+    }
+  }
+
+  bool read(byte index, byte mask) {return (ports[index].state & mask) != 0;}
+}
+#endif
+
 // Ansvar: Denne klasse varetager al funktion af en trykknap. Software er et spejl af hardwarefunktion.
 // Indlæsning fra parallel hardware port. Filtrering af kontaktprel. Grænseflade til software.
 // Seqs: En knap løber igennem 2 trin, når der trykkes på den
@@ -56,47 +143,112 @@ public:
 // value: Knappen er høj eller lav
 // seq: Knappens trin
 // doClockCycle(...): Gennemløb på tid
+// Med tickless klok bliver porten overvåget, så et tryk vækker klokken
+// Med portfilter leverer InPort knappens værdi. Kan porten ikke tilknyttes, filtrerer knappen selv
+// portIndex: Index til port i portfilter
+// bitMask: Benets bit i porten
+// Med sporing bliver hver ændring af filtreret værdi registreret, og hver ændring af læst niveau før kontaktprel
+// rawValue: Seneste læste niveau
+// readPin(...): Læser benet
+// setValue(...): Sætter filtreret værdi
+// Med kompakt deler ben og trin en byte
 class t_PushButton: public t_DigitalInDrv {
 private:
   enum {STABLE, BOUNCE};
   enum {BOUNCTIME = 30};
+#ifndef BrugKompakt
   byte pin;
   t_ClockWork bounceWait;
   byte seq;
+#else
+  byte pin : 7;
+  byte seq : 1;
+  t_ClockWork bounceWait;
+#endif
+#ifdef BrugPortfilter
+  byte portIndex;
+  byte bitMask;
+#endif
+#ifdef BrugSporing
+  bool rawValue;
+#endif
+  bool readPin(void);
+  void setValue(bool a_value);
 public:
   t_PushButton(byte a_pin, byte a_contact);
   void doClockCycle(void);
 };
 
+#ifndef BrugKompakt
 t_PushButton::t_PushButton(byte a_pin, byte a_contact) : t_DigitalInDrv(), pin(a_pin), bounceWait(BOUNCTIME), seq(STABLE) {
+#else
+t_PushButton::t_PushButton(byte a_pin, byte a_contact) : t_DigitalInDrv(), pin(a_pin), seq(STABLE), bounceWait(BOUNCTIME) {
+#endif
   if (a_contact == NCLOSED) pinMode(pin, INPUT_PULLUP);
   else pinMode(pin, INPUT);
   value = digitalRead(pin);
+#ifdef BrugSporing
+  rawValue = value;
+#endif
+#ifdef BrugTicklessKlok
+  Clock::watchPin(pin);
+#endif
+#ifdef BrugPortfilter
+  portIndex = InPort::attach(pin);
+  bitMask = digitalPinToBitMask(pin);
+#endif
 }
 
 void t_PushButton::doClockCycle(void){
+#ifdef BrugPortfilter
+  if (portIndex != InPort::NoPort) {
+    setValue(InPort::read(portIndex, bitMask));
+    return;
+  }
+#endif
   switch (seq) {
     case STABLE:
-      if (value != digitalRead(pin)) {
+      if (value != readPin()) {
         bounceWait.setDuration(BOUNCTIME);
         seq = BOUNCE;
       }
     break;
     case BOUNCE:
      if (bounceWait.triggered() == true) {
-        value = digitalRead(pin);
+        setValue(readPin());
         seq = STABLE;
       }
     break;
   }
 }
 
+bool t_PushButton::readPin(void) {
+  bool level = digitalRead(pin);
+#ifdef BrugSporing
+  if (level != rawValue) Trace::record(Trace::RAW, pin | (level << 7));
+  rawValue = level;
+#endif
+  return level;
+}
+
+void t_PushButton::setValue(bool a_value) {
+#ifdef BrugSporing
+  if (a_value != value) Trace::record(Trace::BUTTON, pin | (a_value << 7));
+#endif
+  value = a_value;
+}
+
+#ifdef BrugKantfangst
+#include "OvkKant.h"
+#endif
+
 //----------
 
 // Ansvar: Er grænseflade til output hardware drivere.
 // value: Output værdi
 // write(...): Indlæser værdi. Sørger for kun at opdatere arduino port ved behov
 // sendOut(...): Sender værdi til aktuel driver
+// isBusy(...): Svarer på om driveren har brug for klokcyklus. Bruges ved hændelsesstyring
 class t_DigitalOutDrv {
 protected:
   bool value;
@@ -104,6 +256,9 @@ protected:
 public:
   t_DigitalOutDrv(bool a_value = LOW) : value(a_value) {}
   virtual void doClockCycle(void) {};
+#ifdef BrugHaendelsesstyring
+  virtual bool isBusy(void) const {return false;}
+#endif
   void write(bool a_value);
 };
 
@@ -116,14 +271,77 @@ void t_DigitalOutDrv::write(bool a_value) {
 
 //----------
 
+#ifdef BrugPortbuffer
+// Ansvar: Skyggekopi af arduino hardware porte til udgange.
+// Udgange skriver i skyggekopi i løbet af en klokcyklus. Ved afslutning af klokcyklus skrives hver ændret port én gang,
+// så udgange på samme port skifter samtidigt. Andre ben på porten bliver ikke ændret.
+// MaxNoPorts: Antal porte der kan have udgange. En Uno har 3 porte
+// NoPort: Ben kan ikke tilknyttes en port
+// t_Port: port: Arduino port. shadow: Udgangenes værdi. dirty: Ben som er ændret siden sidste flush
+// noWrites: Antal skrivninger til porte i seneste flush
+// attach(...): Tilknytter et ben og leverer index til port
+// set(...): Sætter ben i skyggekopi
+// flush(...): Skriver ændrede porte
+namespace OutPort {
+  const byte MaxNoPorts=4;
+  const byte NoPort=0xFF;
+  struct t_Port {
+    byte port;
+    byte shadow;
+    byte dirty;
+  };
+  t_Port ports[MaxNoPorts];
+  byte noPorts=0;
+  byte noWrites=0;
+
+  byte attach(byte pin) {
+    byte port = digitalPinToPort(pin);
+    byte index;
+    if (port == NOT_A_PIN) return NoPort;
+    for (index=0; index < noPorts; index++) if (ports[index].port == port) return index;
+    if (noPorts >= MaxNoPorts) return NoPort;
+    ports[noPorts].port = port;
+    return noPorts++;
+  }
+
+  void set(byte index, byte mask, bool value) {
+    if (value == HIGH) ports[index].shadow |= mask;
+    else ports[index].shadow &= ~mask;
+    ports[index].dirty |= mask;
+  }
+
+  void flush(void) {
+    noWrites = 0;
+    for (byte index=0; index < noPorts; index++) {
+      t_Port &item = ports[index];
+      if (item.dirty == 0) continue;
+      noInterrupts();   // Servo og andre interrupts kan skrive til samme port
+      *portOutputRegister(item.port) = (*portOutputRegister(item.port) & ~item.dirty) | (item.shadow & item.dirty);
+      interrupts();
+      item.dirty = 0;
+      noWrites++;
+    }
+  }
+}
+#endif
+
 // Ansvar: Denne klasse varetager al funktion af simpel tændt eller slukket udgang. Software er et spejl af hardwarefunktion.
 // Udlæsning til parallel hardware port. Grænseflade til software.
 // pin: Arduino portnr
 // sendOut(...): Sender værdi til port
+// Med portbuffer sender sendOut(...) til skyggekopi af porten. Kan porten ikke tilknyttes, sendes direkte
+// portIndex: Index til port i skyggekopi
+// bitMask: Benets bit i porten
 class t_SimpleOnOff: public t_DigitalOutDrv {
 private:
   byte pin;
+#ifndef BrugPortbuffer
   void sendOut(void) {digitalWrite(pin, value);}
+#else
+  byte portIndex;
+  byte bitMask;
+  void sendOut(void);
+#endif
 public:
   t_SimpleOnOff(byte a_pin, bool a_value);
 };
@@ -131,54 +349,119 @@ public:
 t_SimpleOnOff::t_SimpleOnOff(byte a_pin, bool a_value = LOW) : t_DigitalOutDrv(a_value), pin(a_pin) {
   pinMode(pin, OUTPUT);
   digitalWrite(pin, a_value);
+#ifdef BrugPortbuffer
+  portIndex = OutPort::attach(pin);
+  bitMask = digitalPinToBitMask(pin);
+  if (portIndex != OutPort::NoPort) OutPort::set(portIndex, bitMask, a_value);
+#endif
+}
+
+#ifdef BrugPortbuffer
+void t_SimpleOnOff::sendOut(void) {
+  if (portIndex == OutPort::NoPort) digitalWrite(pin, value);
+  else OutPort::set(portIndex, bitMask, value);
 }
+#endif
+
+//----------
+
+#ifdef BrugLysdaemper
+#include "OvkLysdaemper.h"
+#endif
+
+//----------
+
+#ifdef BrugPortudvidelse
+#include "OvkUdvidelse.h"
+#endif
 
 //----------
 
 #ifdef BrugVejbom
+#ifndef BrugServoPuls
 #include <Servo.h>
+#else
+#include "OvkServoPuls.h"
+#endif
 
-// Opsætning af maks specifikationer til servomotor
-const struct {
+// Opsætning af maks specifikationer til servomotor. Kan bruges ved oversættelse
+constexpr struct {
   int PulseWidthMin = 544;
   int PulseWidthMax = 2400;
   int AngleMin = 0;
   int AngleMax = 180;
   int AnglePmsek = 20;
   int AngleDiff = 90;
-} PWMLimits;
+} PWMLimits = {};
+
+#ifdef BrugBomprofil
+// Bomprofil: Andel af bomvandringen i 1/255 ved start af hver del. Blød start og stop efter 3t²-2t³
+// Topfarten midt i vandringen er 1,5 gange middelfarten
+const byte ProfileParts=16;
+const byte BarrierProfile[ProfileParts+1] PROGMEM = {0, 3, 11, 24, 40, 59, 81, 104, 128, 151, 174, 196, 215, 231, 244, 252, 255};
+#endif
 
 // Ansvar: Denne klasse varetager al funktion til styring af en servomotor.
 // Udlæsning til pulsbreddemoduleret hardware port. Grænseflade til software.
 // Seqs: Et bomdrev løber igennem 3 trin, når det går op eller ned
 // seq: Bomdrevets trin
-// servoPort: Portobjekt
+// servoPort: Portobjekt. Med BrugServoPuls t_ServoPulse fra OvkServoPuls.h
 // minPulseWidth: Konfigureret minimum pulsbredde
 // maxPulseWidth: Konfigureret maksimum pulsbredde
 // timeAngle: Timer til bombevægelse
 // anglePmsek: Antal msek per grad bombevægelse
 // upAngle: Vinkel når bomdrev er i oppe
 // downAngle: Vinkel når bomdrev er i nede
-// currentAngle: Vinkel på et tidspunkt
+// currentAngle: Vinkel på et tidspunkt. Med bomprofil kun yderstilling, når bomdrevet er i ro
+// Med BrugBomprofil følger bommen BarrierProfile i stedet for en grad per timeAngle:
+// upPulseWidth, downPulseWidth: Pulsbredde i yderstillinger
+// partStep: Ændring i pulsbredde per klokcyklus i 1/256 mikrosek for hver del af profilen
+// partTicks: Antal klokcyklusser per del af profilen
+// tick, part: Klokcyklus i delen og delen under bevægelse
+// pulseWidth: Aktuel pulsbredde i 1/256 mikrosek
+// setProfile(...): Beregner partStep fra pulsbredder og partTicks, når motoren startes
 // startMotor(...): Sætter PWM variable indenfor grænser og kobler motor til port
 // startMotor variant til konfiguration af alle motorparametre
-// doClockCycle(...): Gennemløb på tid
+// doClockCycle(...): Gennemløb på tid. Med tickless klok holdes klokken vågen, når bomdrevet starter
+// isBusy(...): Bomdrevet er i gang, indtil armen står i den stilling som værdien angiver
 // sendOut(...): Sender værdi til port
 // setAngleAdjust(...): Sætter justeringsvinkel og tjekker om max grænser overholdes. Sætter arm i startposition
 // setBarrierTime(...): Sætter tid for bevægelse fra yderstilling til yderstilling
 // setPWtime(...): Sætter grænser for pulsbredde
+// Med kompakt er vinkler en byte, da de ligger mellem AngleMin og AngleMax
 class t_ServoMotor: public t_DigitalOutDrv {
 private:
   enum {STABLE, GOUP, GODOWN};
   byte seq;
+#ifndef BrugServoPuls
   Servo servoPort;
+#else
+  t_ServoPulse servoPort;
+#endif
   int minPulseWidth;
   int maxPulseWidth;
+#ifndef BrugBomprofil
   t_ClockWork timeAngle;
   int anglePmsek;
+#else
+  int upPulseWidth;
+  int downPulseWidth;
+  int partStep[ProfileParts];
+  unsigned int partTicks;
+  unsigned int tick;
+  byte part;
+  long pulseWidth;
+  void setProfile(void);
+#endif
+#ifndef BrugKompakt
   int upAngle;
   int downAngle;
   int currentAngle;
+#else
+  byte upAngle;
+  byte downAngle;
+  byte currentAngle;
+#endif
   void sendOut(void);
   bool setAngleAdjust(int a_upAngle, int a_angleDiff);
   bool setBarrierTime(unsigned long barrierTime);
@@ -189,12 +472,19 @@ public:
     startMotor(pin, angleAdjust, PWMLimits.AngleDiff, barrierTime, PWMLimits.PulseWidthMin, PWMLimits.PulseWidthMax);}
   void startMotor(byte pin, int angleAdjust, int angleDiff, unsigned long barrierTime, int minPWt, int maxPWt);
   void doClockCycle(void);
+#ifdef BrugHaendelsesstyring
+  bool isBusy(void) const {return (seq != STABLE) || (currentAngle != ((value == HIGH)?upAngle:downAngle));}
+#endif
 };
 
 void t_ServoMotor::sendOut(void) {
   int currentPW;
   if (servoPort.attached() == true) {
+#ifndef BrugBomprofil
     currentPW = map(currentAngle, PWMLimits.AngleMin, PWMLimits.AngleMax, minPulseWidth, maxPulseWidth);
+#else
+    currentPW = pulseWidth >> 8;
+#endif
     servoPort.writeMicroseconds(currentPW);
   }
 }
@@ -212,6 +502,7 @@ bool t_ServoMotor::setAngleAdjust(int a_upAngle, int a_angleDiff) {
   return isValid;
 }
 
+#ifndef BrugBomprofil
 bool t_ServoMotor::setBarrierTime(unsigned long barrierTime) {
   bool isValid = false;
   anglePmsek = (downAngle > upAngle)?barrierTime/(downAngle-upAngle):PWMLimits.AnglePmsek;
@@ -219,6 +510,35 @@ bool t_ServoMotor::setBarrierTime(unsigned long barrierTime) {
   timeAngle.setDuration(anglePmsek);
   return isValid;
 }
+#else
+bool t_ServoMotor::setBarrierTime(unsigned long barrierTime) {
+  bool isValid = false;
+  int anglePmsek;
+  // Servomotoren skal kunne følge topfarten
+  anglePmsek = (downAngle > upAngle)?(barrierTime*2)/(3UL*(downAngle-upAngle)):PWMLimits.AnglePmsek;
+  isValid = (anglePmsek >= PWMLimits.AnglePmsek);
+  partTicks = barrierTime/Clock::ClockCycle/ProfileParts;
+  if (partTicks == 0) partTicks = 1;
+  return isValid;
+}
+
+void t_ServoMotor::setProfile(void) {
+  byte share, nextShare;
+  long span, divisor;
+  upPulseWidth = map(upAngle, PWMLimits.AngleMin, PWMLimits.AngleMax, minPulseWidth, maxPulseWidth);
+  downPulseWidth = map(downAngle, PWMLimits.AngleMin, PWMLimits.AngleMax, minPulseWidth, maxPulseWidth);
+  span = (long)(downPulseWidth-upPulseWidth) << 8;
+  divisor = 255L*partTicks;
+  memcpy_P(&share, &BarrierProfile[0], sizeof(share));
+  for (byte cnt=0; cnt < ProfileParts; cnt++) {
+    memcpy_P(&nextShare, &BarrierProfile[cnt+1], sizeof(nextShare));
+    partStep[cnt] = (span*(nextShare-share)+divisor/2)/divisor;
+    share = nextShare;
+  }
+  // Halv mikrosek lagt til, så afskæring giver afrunding
+  pulseWidth = ((long)((value == HIGH)?upPulseWidth:downPulseWidth) << 8)+128;
+}
+#endif
 
 bool t_ServoMotor::setPWtime(int minPWt, int maxPWt) {
   bool isValid = false;
@@ -235,16 +555,23 @@ void t_ServoMotor::startMotor(byte pin, int angleAdjust, int angleDiff, unsigned
   allowStart = allowStart && setBarrierTime(barrierTime);
   allowStart = allowStart && setPWtime(minPWt, maxPWt);
   if (allowStart == true) {
+#ifdef BrugBomprofil
+    setProfile();
+#endif
     servoPort.attach(pin);
     sendOut();  
   }
 }
 
+#ifndef BrugBomprofil
 void t_ServoMotor::doClockCycle(void){
   switch (seq) {
     case STABLE:
       if ((value == HIGH) && (currentAngle == downAngle)) seq = GOUP;
       if ((value == LOW) && (currentAngle == upAngle)) seq = GODOWN;
+#ifdef BrugTicklessKlok
+      if (seq != STABLE) Clock::stayAwake();
+#endif
     break;
     case GOUP:
       if (currentAngle > upAngle) {
@@ -266,6 +593,35 @@ void t_ServoMotor::doClockCycle(void){
     break;
   }
 }
+#else
+void t_ServoMotor::doClockCycle(void){
+  int lastPW;
+  if (seq == STABLE) {
+    if ((value == HIGH) && (currentAngle == downAngle)) seq = GOUP;
+    if ((value == LOW) && (currentAngle == upAngle)) seq = GODOWN;
+    if (seq == STABLE) return;
+    tick = 0;
+    part = 0;
+  }
+#ifdef BrugTicklessKlok
+  Clock::stayAwake();
+#endif
+  // Op gennemløber profilen baglæns
+  lastPW = pulseWidth >> 8;
+  if (seq == GODOWN) pulseWidth += partStep[part];
+  else pulseWidth -= partStep[ProfileParts-1-part];
+  if (++tick == partTicks) {
+    tick = 0;
+    if (++part == ProfileParts) {
+      // Afrundinger fjernes i yderstillingen
+      currentAngle = (seq == GODOWN)?downAngle:upAngle;
+      pulseWidth = ((long)((seq == GODOWN)?downPulseWidth:upPulseWidth) << 8)+128;
+      seq = STABLE;
+    }
+  }
+  if ((pulseWidth >> 8) != lastPW) sendOut();
+}
+#endif
   
 #endif
 #endif
@@ -0,0 +1,276 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Overkørsel kantfangst med pinskift interrupt
+ * Version: 1.2
+ * Type: Bibliotek
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel kerne komponenter.
+ *
+ * "Overkørsel kantfangst" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel kantfangst" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel kantfangst".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Inkluderes af OvkHWDrivere.h, når BrugKantfangst er defineret. Giver t_EdgeInput til sporsensorer som tændsted.
+ * Definerer interrupt for alle 3 pinskift vektorer i stedet for OvkTiming.h. Med tickless klok vækker de også klokken.
+ * Version 1.1: Tider fra micros() holdes i 32 bit, så hold af prel også virker når micros() løber rundt
+ * Version 1.2: Tællere fra interrupt læses helt med edgeCount(...) og overflowCount(...)
+ */
+
+#include <Arduino.h>
+#include "OvkTiming.h"
+#include "OvkTrace.h"
+
+#ifndef OvkKant_h
+#define OvkKant_h
+
+// Ansvar: Fanger kanter på sporsensorer i pinskift interrupt og leverer dem til klokcyklus gennem en kø.
+// Interrupt læser porten, finder de ben der har skiftet, og lægger en kant med tidsstempel fra micros() i køen.
+// Køen har én skriver (interrupt) og én læser (doClockCycle) og bruger ingen lås. Hver side ejer sit index
+// og læser det andet med acquire, så kanten er skrevet før head flyttes. På en Uno er det almindelige byte læsninger.
+// En kant skifter værdi med det samme. Kanter i HoldTime derefter er prel og flytter kun seneste niveau,
+// som værdien følger, når HoldTime er gået. Værdien skifter højst én gang per klokcyklus,
+// så en puls kortere end en klokcyklus når flipflop som lav i én klokcyklus og høj i den næste.
+// MaxNoInputs: Antal ben der kan fanges
+// NoInput: Ben kan ikke tilknyttes
+// Size: Antal pladser i køen. Skal være en potens af 2
+// HoldTime: Tid i msek efter en ændring, hvor kanter regnes for prel
+// t_Edge: atMicros: Tidsstempel. input: Index til ben. level: Niveau efter kanten. Tider fra micros() holdes i 32 bit, så forskelle løber rigtigt rundt
+// t_Input: pin, port, mask: Benet. pinLevel: Niveau interrupt sidst har set.
+//   raw, rawMicros: Seneste niveau fra køen og dets tid. value, valueMicros: Værdi og tid for seneste ændring
+//   changed: Værdien har skiftet i denne klokcyklus
+// queue, head, tail: Køen. Index til næste kant som skrives og læses
+// overflowed: Sat af interrupt når en kant ikke var plads til. Så sættes seneste niveau fra pinLevel
+// noEdges, noOverflows: Kanter fanget i interrupt og kanter tabt fordi køen var fuld. Skrives kun af interrupt.
+//   Udenfor interrupt læses de med edgeCount(...) og overflowCount(...), da en Uno læser 32 bit i 4 byte
+// maxUsed: Flest kanter i køen ved start af klokcyklus
+// attach(...): Tilknytter et ben, slår pinskift til og leverer index
+// count(...), load(...): Tæller op i interrupt og læser en tæller helt. På en Uno med interrupts slået fra
+// capture(...): Lægger en kant i køen. Kaldes af interrupt
+// onPinChange(...): Kaldes af interrupt med porten som har skiftet. Med tickless klok vækker den klokken
+// push(...), pop(...): Skriver og læser køen
+// doClockCycle(...): Tømmer køen og opdaterer værdier. Kaldes én gang per klokcyklus før input drivere
+// read(...), changedMicros(...): Udlæser værdi og tid for seneste ændring
+// edgeCount(...), overflowCount(...): Udlæser noEdges og noOverflows
+// Med tickless klok holdes klokken vågen, mens et ben venter på at HoldTime udløber
+// Med sporing bliver hvert niveau fra køen registreret
+namespace EdgeCapture {
+  const byte MaxNoInputs=4;
+  const byte NoInput=0xFF;
+  const byte Size=16;
+  const byte HoldTime=10;
+  static_assert((Size & (Size-1)) == 0, "Køens størrelse skal være en potens af 2");
+  struct t_Edge {
+    uint32_t atMicros;
+    byte input;
+    bool level;
+  };
+  struct t_Input {
+    byte pin;
+    byte port;
+    byte mask;
+    bool pinLevel;
+    bool raw;
+    bool value;
+    bool changed;
+    uint32_t rawMicros;
+    uint32_t valueMicros;
+  };
+  t_Input inputs[MaxNoInputs];
+  byte noInputs=0;
+  t_Edge queue[Size];
+  byte head=0;
+  byte tail=0;
+  bool overflowed=false;
+  unsigned long noEdges=0;
+  unsigned long noOverflows=0;
+  byte maxUsed=0;
+
+  byte attach(byte pin) {
+    byte port = digitalPinToPort(pin);
+    if ((port == NOT_A_PIN) || (noInputs >= MaxNoInputs)) return NoInput;
+#ifdef __AVR__
+    if (digitalPinToPCICR(pin) == nullptr) return NoInput;
+#endif
+    t_Input &item = inputs[noInputs];
+    item.pin = pin;
+    item.port = port;
+    item.mask = digitalPinToBitMask(pin);
+    item.pinLevel = item.raw = item.value = (*portInputRegister(port) & item.mask) != 0;
+    item.changed = false;
+    // Første kant skifter værdi med det samme
+    item.rawMicros = item.valueMicros = micros()-HoldTime*1000UL;
+#ifdef __AVR__
+    *digitalPinToPCMSK(pin) |= bit(digitalPinToPCMSKbit(pin));
+    PCIFR |= bit(digitalPinToPCICRbit(pin));
+    *digitalPinToPCICR(pin) |= bit(digitalPinToPCICRbit(pin));
+#endif
+    return noInputs++;
+  }
+
+  bool push(const t_Edge &edge) {
+    byte next = (head+1) & (Size-1);
+    if (next == __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) return false;
+    queue[head] = edge;
+    __atomic_store_n(&head, next, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  bool pop(t_Edge &edge) {
+    if (tail == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) return false;
+    edge = queue[tail];
+    __atomic_store_n(&tail, (byte)((tail+1) & (Size-1)), __ATOMIC_RELEASE);
+    return true;
+  }
+
+  void count(unsigned long &counter) {
+#ifdef __AVR__
+    counter++;
+#else
+    __atomic_store_n(&counter, counter+1, __ATOMIC_RELAXED);
+#endif
+  }
+
+  unsigned long load(const unsigned long &counter) {
+#ifdef __AVR__
+    noInterrupts();
+    unsigned long value = counter;
+    interrupts();
+    return value;
+#else
+    return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+#endif
+  }
+
+  void capture(byte input, bool level, uint32_t atMicros) {
+    __atomic_store_n(&inputs[input].pinLevel, level, __ATOMIC_RELAXED);
+    count(noEdges);
+    if (push(t_Edge{atMicros, input, level}) == true) return;
+    count(noOverflows);
+    __atomic_store_n(&overflowed, true, __ATOMIC_RELEASE);
+  }
+
+  void onPinChange(byte port) {
+    byte value = *portInputRegister(port);
+    uint32_t now = micros();
+    for (byte index=0; index < noInputs; index++) {
+      const t_Input &item = inputs[index];
+      bool level = (value & item.mask) != 0;
+      if ((item.port == port) && (level != item.pinLevel)) capture(index, level, now);
+    }
+#ifdef BrugTicklessKlok
+    Clock::wake();
+#endif
+  }
+
+  void accept(t_Input &item) {
+    item.value = item.raw;
+    item.valueMicros = item.rawMicros;
+    item.changed = true;
+  }
+
+  void doClockCycle(void) {
+    const unsigned long HoldMicros = HoldTime*1000UL;
+    t_Edge edge;
+    byte used = (__atomic_load_n(&head, __ATOMIC_ACQUIRE)-tail) & (Size-1);
+    if (used > maxUsed) maxUsed = used;
+    for (byte index=0; index < noInputs; index++) inputs[index].changed = false;
+    while (pop(edge) == true) {
+      t_Input &item = inputs[edge.input];
+#ifdef BrugSporing
+      if (edge.level != item.raw) Trace::record(Trace::RAW, item.pin | (edge.level << 7));
+#endif
+      item.raw = edge.level;
+      item.rawMicros = edge.atMicros;
+      if ((item.changed == false) && (item.raw != item.value) && (edge.atMicros-item.valueMicros >= HoldMicros)) accept(item);
+    }
+    // Kanter er tabt. Interrupt har stadig set benets niveau
+    if (__atomic_load_n(&overflowed, __ATOMIC_ACQUIRE) == true) {
+      __atomic_store_n(&overflowed, false, __ATOMIC_SEQ_CST);
+      for (byte index=0; index < noInputs; index++) {
+        t_Input &item = inputs[index];
+        bool level = __atomic_load_n(&item.pinLevel, __ATOMIC_SEQ_CST);
+        if (level != item.raw) {
+          item.raw = level;
+          item.rawMicros = micros();
+        }
+      }
+    }
+    uint32_t now = micros();
+    for (byte index=0; index < noInputs; index++) {
+      t_Input &item = inputs[index];
+      if ((item.changed == true) || (item.raw == item.value)) continue;
+      if (now-item.valueMicros >= HoldMicros) accept(item);
+#ifdef BrugTicklessKlok
+      else Clock::stayAwake();
+#endif
+    }
+  }
+
+  bool read(byte index) {return inputs[index].value;}
+  unsigned long changedMicros(byte index) {return inputs[index].valueMicros;}
+  unsigned long edgeCount(void) {return load(noEdges);}
+  unsigned long overflowCount(void) {return load(noOverflows);}
+}
+
+#ifdef __AVR__
+#ifdef PCINT0_vect
+ISR(PCINT0_vect) {EdgeCapture::onPinChange(PB);}
+#endif
+#ifdef PCINT1_vect
+ISR(PCINT1_vect) {EdgeCapture::onPinChange(PC);}
+#endif
+#ifdef PCINT2_vect
+ISR(PCINT2_vect) {EdgeCapture::onPinChange(PD);}
+#endif
+#endif
+
+// Ansvar: Input driver til sporsensorer, som leverer værdien fra EdgeCapture. Kan bruges i stedet for t_PushButton.
+// En kort puls fra reed kontakt eller lysbom bliver fanget, selv om den falder mellem to klokcyklusser.
+// pin: Arduino portnr
+// input: Index til ben i EdgeCapture
+// doClockCycle(...): Henter værdi fra EdgeCapture. Kan benet ikke tilknyttes, læses det direkte uden filtrering
+// changedMicros(...): Tidsstempel for seneste ændring af værdi
+// Med sporing bliver hver ændring af værdi registreret som for en trykknap
+class t_EdgeInput: public t_DigitalInDrv {
+private:
+  byte pin;
+  byte input;
+public:
+  t_EdgeInput(byte a_pin, byte a_contact);
+  void doClockCycle(void);
+  unsigned long changedMicros(void) const;
+};
+
+t_EdgeInput::t_EdgeInput(byte a_pin, byte a_contact) : t_DigitalInDrv(), pin(a_pin) {
+  if (a_contact == NCLOSED) pinMode(pin, INPUT_PULLUP);
+  else pinMode(pin, INPUT);
+  value = digitalRead(pin);
+  input = EdgeCapture::attach(pin);
+}
+
+void t_EdgeInput::doClockCycle(void) {
+  bool a_value = (input != EdgeCapture::NoInput)?EdgeCapture::read(input):digitalRead(pin);
+#ifdef BrugSporing
+  if (a_value != value) Trace::record(Trace::BUTTON, pin | (a_value << 7));
+#endif
+  value = a_value;
+}
+
+unsigned long t_EdgeInput::changedMicros(void) const {
+  return (input != EdgeCapture::NoInput)?EdgeCapture::changedMicros(input):0;
+}
+
+#endif
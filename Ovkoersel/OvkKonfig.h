@@ -0,0 +1,347 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Overkørsel konfiguration fra tabeller
+ * Version: 1.1
+ * Type: Bibliotek
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel kerne komponenter.
+ *
+ * "Overkørsel konfiguration" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel konfiguration" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel konfiguration".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Inkluderes af Ovkoersel.h, når BrugKonfiguration er defineret. Kan ikke bruges sammen med BrugStatiskOverkoersel.
+ * Version 1.1: Magasin oprettes i lageret også ved BrugKompakt
+ */
+
+#ifdef __AVR__
+#include <new.h>
+#else
+#include <new>
+#endif
+#include <stddef.h>
+
+#ifndef OvkKonfig_h
+#define OvkKonfig_h
+
+#ifdef BrugStatiskOverkoersel
+#error "Konfiguration fra tabeller kan ikke bruges sammen med statisk overkørsel"
+#endif
+
+// Ansvar: Beskriver overkørslens betjeningsenheder og ydre enheder som constexpr tabeller i flash i stedet for
+// globale objekter og set...(...) kald i setup(). Tabellerne tjekkes med static_assert ved oversættelse.
+// Ved start opretter build(...) drivere, magasiner og enheder i et lager af fast størrelse uden heap og kobler dem til overkørslen.
+// Flere sæt tabeller kan ligge i samme program, og et af dem vælges ved start. Se Simulator/RefOverkoerselKonfig.h
+// NoPin: Ben er ikke brugt. NoFlipFlop: Betjeningsenhed uden magasin
+// RAILSIGNAL, ROADSIGNAL, REPORT, BARRIER: Typer af ydre enheder. BARRIER kræver BrugVejbom
+// t_Ctrl: Betjeningsenhed name med trykknap på pin med kontakttype contact. flipflop er BISTABLE, ONESHOT eller NoFlipFlop.
+// Magasinet får samme kontakttype som trykknappen
+// t_Device: Ydre enhed name af typen kind med starttilstand state og udgang på pin. Banesignal kan have hvid lampe på whitePin.
+// Vejbom har servomotoren på pin
+// t_Servo: Servomotor til vejbom name med samme parametre som t_ServoMotor::startMotor(...)
+// t_Layout: Et sæt tabeller med antal rækker. Oprettes med layout(...) og lægges i flash
+// hasName(...), namesValid(...): Navn findes i tabel. Alle navne er mindre end maxNo og bruges kun én gang
+// isValid(...), itemsValid(...): Felter i en række eller alle rækker har gyldige værdier
+// pinsValid(...): Alle ben findes på kortet og bruges kun én gang
+// servosValid(...): Hver vejbom har netop én servomotor, og servomotorer overholder PWMLimits
+// Align, slot(...): Objekter lægges i lageret på adresser delelige med Align
+// bytes(...): Plads i lageret til alle objekter i et sæt tabeller
+// t_Pool: Deler lageret ud til objekter. create(...) opretter et objekt med placement new og leverer nullptr, når lageret er fuldt
+// makeCtrl(...), makeDevice(...): Opretter én enhed med driver fra en række
+// build(...): Opretter alle enheder fra et sæt tabeller og kobler dem til overkørslen. Leverer false, hvis lageret er for lille
+// t_Store<Size>: Lager til et sæt tabeller. Size findes med bytes(...), eller den største, hvis der er flere sæt
+namespace Config {
+  const byte NoPin = 0xFF;
+  const byte NoFlipFlop = 0xFF;
+  enum {RAILSIGNAL, ROADSIGNAL, REPORT, BARRIER};
+#ifdef BrugVejbom
+  const byte NoKinds = BARRIER+1;
+#else
+  const byte NoKinds = BARRIER;
+#endif
+  struct t_Ctrl {
+    byte name;
+    byte pin;
+    byte contact;
+    byte flipflop;
+  };
+  struct t_Device {
+    byte name;
+    byte kind;
+    byte state;
+    byte pin;
+    byte whitePin;
+  };
+#ifdef BrugVejbom
+  struct t_Servo {
+    byte name;
+    int angleAdjust;
+    int angleDiff;
+    unsigned long barrierTime;
+    int minPulseWidth;
+    int maxPulseWidth;
+  };
+#endif
+  struct t_Layout {
+    const t_Ctrl *ctrls;
+    byte noCtrls;
+    const t_Device *devices;
+    byte noDevices;
+#ifdef BrugVejbom
+    const t_Servo *servos;
+    byte noServos;
+#endif
+  };
+
+#ifndef BrugVejbom
+  template <size_t NC, size_t ND>
+  constexpr t_Layout layout(const t_Ctrl (&ctrls)[NC], const t_Device (&devices)[ND]) {
+    return t_Layout{ctrls, NC, devices, ND};
+  }
+#else
+  template <size_t NC, size_t ND>
+  constexpr t_Layout layout(const t_Ctrl (&ctrls)[NC], const t_Device (&devices)[ND]) {
+    return t_Layout{ctrls, NC, devices, ND, nullptr, 0};
+  }
+
+  template <size_t NC, size_t ND, size_t NS>
+  constexpr t_Layout layout(const t_Ctrl (&ctrls)[NC], const t_Device (&devices)[ND], const t_Servo (&servos)[NS]) {
+    return t_Layout{ctrls, NC, devices, ND, servos, NS};
+  }
+#endif
+
+  template <typename T, size_t N>
+  constexpr bool hasName(const T (&table)[N], byte name, size_t index = 0) {
+    return (index < N) && ((table[index].name == name) || hasName(table, name, index+1));
+  }
+
+  template <typename T, size_t N>
+  constexpr bool namesValid(const T (&table)[N], byte maxNo, size_t index = 0) {
+    return (index >= N) || ((table[index].name < maxNo) && (hasName(table, table[index].name, index+1) == false) && namesValid(table, maxNo, index+1));
+  }
+
+  constexpr bool isValid(const t_Ctrl &item) {
+    return (item.pin != NoPin) && ((item.contact == NOPEN) || (item.contact == NCLOSED)) &&
+      ((item.flipflop == NoFlipFlop) || (item.flipflop == BISTABLE) || (item.flipflop == ONESHOT));
+  }
+
+  constexpr bool isValid(const t_Device &item) {
+    return (item.pin != NoPin) && (item.kind < NoKinds) && ((item.state == BLOCK) || (item.state == PASS)) &&
+      ((item.whitePin == NoPin) || (item.kind == RAILSIGNAL));
+  }
+
+  template <typename T, size_t N>
+  constexpr bool itemsValid(const T (&table)[N], size_t index = 0) {
+    return (index >= N) || (isValid(table[index]) && itemsValid(table, index+1));
+  }
+
+  // Ben nummereres med betjeningsenheder først, derefter ydre enheder og til sidst hvide lamper
+  template <size_t NC, size_t ND>
+  constexpr byte pinAt(const t_Ctrl (&ctrls)[NC], const t_Device (&devices)[ND], size_t index) {
+    return (index < NC)?ctrls[index].pin:((index < NC+ND)?devices[index-NC].pin:devices[index-NC-ND].whitePin);
+  }
+
+  template <size_t NC, size_t ND>
+  constexpr bool pinUsed(const t_Ctrl (&ctrls)[NC], const t_Device (&devices)[ND], byte pin, size_t index) {
+    return (index < NC+2*ND) && ((pinAt(ctrls, devices, index) == pin) || pinUsed(ctrls, devices, pin, index+1));
+  }
+
+  template <size_t NC, size_t ND>
+  constexpr bool pinsValid(const t_Ctrl (&ctrls)[NC], const t_Device (&devices)[ND], size_t index = 0) {
+    return (index >= NC+2*ND) || (((pinAt(ctrls, devices, index) == NoPin) ||
+      ((pinAt(ctrls, devices, index) < NUM_DIGITAL_PINS) && (pinUsed(ctrls, devices, pinAt(ctrls, devices, index), index+1) == false))) &&
+      pinsValid(ctrls, devices, index+1));
+  }
+
+  template <size_t ND>
+  constexpr bool hasKind(const t_Device (&devices)[ND], byte kind, size_t index = 0) {
+    return (index < ND) && ((devices[index].kind == kind) || hasKind(devices, kind, index+1));
+  }
+
+  template <size_t ND>
+  constexpr bool isKind(const t_Device (&devices)[ND], byte name, byte kind, size_t index = 0) {
+    return (index < ND) && (((devices[index].name == name) && (devices[index].kind == kind)) || isKind(devices, name, kind, index+1));
+  }
+
+  template <size_t ND>
+  constexpr bool servosValid(const t_Device (&devices)[ND]) {
+    return hasKind(devices, BARRIER) == false;
+  }
+
+#ifdef BrugVejbom
+  // Samme grænser som t_ServoMotor tjekker i startMotor(...)
+  constexpr unsigned long anglePmsek(const t_Servo &item) {
+#ifndef BrugBomprofil
+    return (item.angleDiff > 0)?item.barrierTime/item.angleDiff:PWMLimits.AnglePmsek;
+#else
+    return (item.angleDiff > 0)?(item.barrierTime*2)/(3UL*item.angleDiff):PWMLimits.AnglePmsek;
+#endif
+  }
+
+  constexpr bool isValid(const t_Servo &item) {
+    return (item.angleDiff >= PWMLimits.AngleMin) && (item.angleDiff <= PWMLimits.AngleMax) &&
+      (item.angleAdjust >= PWMLimits.AngleMin) && (item.angleAdjust <= PWMLimits.AngleMax-item.angleDiff) &&
+      (anglePmsek(item) >= (unsigned long)PWMLimits.AnglePmsek) &&
+      (item.minPulseWidth >= PWMLimits.PulseWidthMin) && (item.maxPulseWidth <= PWMLimits.PulseWidthMax) && (item.minPulseWidth < item.maxPulseWidth);
+  }
+
+  template <size_t ND, size_t NS>
+  constexpr bool barriersMatch(const t_Device (&devices)[ND], const t_Servo (&servos)[NS], size_t index = 0) {
+    return (index >= ND) || (((devices[index].kind != BARRIER) || hasName(servos, devices[index].name)) && barriersMatch(devices, servos, index+1));
+  }
+
+  template <size_t ND, size_t NS>
+  constexpr bool servosMatch(const t_Device (&devices)[ND], const t_Servo (&servos)[NS], size_t index = 0) {
+    return (index >= NS) || (isKind(devices, servos[index].name, BARRIER) && servosMatch(devices, servos, index+1));
+  }
+
+  template <size_t ND, size_t NS>
+  constexpr bool servosValid(const t_Device (&devices)[ND], const t_Servo (&servos)[NS]) {
+    return itemsValid(servos) && namesValid(servos, MaxNoDevices) && barriersMatch(devices, servos) && servosMatch(devices, servos);
+  }
+#endif
+
+  const size_t Align = alignof(max_align_t);
+  constexpr size_t slot(size_t size) {return (size+Align-1)/Align*Align;}
+
+  constexpr size_t bytes(const t_Ctrl &item) {
+    return slot(sizeof(t_PushButton))+slot(sizeof(t_CrossingCtrl))+((item.flipflop != NoFlipFlop)?slot(sizeof(t_FlipFlop)):0);
+  }
+
+  constexpr size_t bytes(const t_Device &item) {
+    return (item.kind == RAILSIGNAL)?slot(sizeof(t_RailSignal))+slot(sizeof(t_SimpleOnOff))+((item.whitePin != NoPin)?slot(sizeof(t_SimpleOnOff)):0):
+      (item.kind == ROADSIGNAL)?slot(sizeof(t_RoadSignal))+slot(sizeof(t_SimpleOnOff)):
+#ifdef BrugVejbom
+      (item.kind == BARRIER)?slot(sizeof(t_Barrier))+slot(sizeof(t_ServoMotor)):
+#endif
+      slot(sizeof(t_Report))+slot(sizeof(t_SimpleOnOff));
+  }
+
+  template <typename T, size_t N>
+  constexpr size_t bytes(const T (&table)[N], size_t index = 0) {
+    return (index >= N)?0:bytes(table[index])+bytes(table, index+1);
+  }
+
+  template <size_t NC, size_t ND>
+  constexpr size_t bytes(const t_Ctrl (&ctrls)[NC], const t_Device (&devices)[ND]) {
+    return bytes(ctrls)+bytes(devices);
+  }
+
+  class t_Pool {
+  private:
+    byte *next;
+    byte *end;
+  public:
+    t_Pool(byte *data, size_t size): next(data), end(data+size) {}
+    template <typename T, typename... Args>
+    T *create(Args... args) {
+      if ((size_t)(end-next) < slot(sizeof(T))) return nullptr;
+      T *item = new (next) T(args...);
+      next += slot(sizeof(T));
+      return item;
+    }
+  };
+
+  t_CrossingCtrl *makeCtrl(t_Pool &pool, const t_Ctrl &row) {
+    t_PushButton *driver = pool.create<t_PushButton>(row.pin, row.contact);
+    t_CrossingCtrl *item = pool.create<t_CrossingCtrl>();
+    if ((driver == nullptr) || (item == nullptr)) return nullptr;
+    item->setDriver(driver);
+    if (row.flipflop != NoFlipFlop) {
+      // Magasinet lever i lageret som programmets globale flipflop, så betjeningsenheden kan pege på det
+      t_FlipFlop *flipflop = pool.create<t_FlipFlop>(row.contact);
+      if (flipflop == nullptr) return nullptr;
+      item->setFlipFlop(flipflop, row.flipflop);
+    }
+    return item;
+  }
+
+  t_CrossingDevice *makeDevice(t_Pool &pool, const t_Device &row, const t_Layout &layout) {
+    t_CrossingDevice *item = nullptr;
+    t_DigitalOutDrv *driver = nullptr;
+    t_RailSignal *signal = nullptr;
+    t_SimpleOnOff *whiteDrv = nullptr;
+    switch (row.kind) {
+      case RAILSIGNAL:
+        item = signal = pool.create<t_RailSignal>(row.state);
+        driver = pool.create<t_SimpleOnOff>(row.pin, HIGH);
+        if (row.whitePin != NoPin) {
+          whiteDrv = pool.create<t_SimpleOnOff>(row.whitePin, LOW);
+          if (whiteDrv == nullptr) return nullptr;
+        }
+      break;
+      case ROADSIGNAL:
+        item = pool.create<t_RoadSignal>(row.state);
+        driver = pool.create<t_SimpleOnOff>(row.pin, LOW);
+      break;
+      case REPORT:
+        item = pool.create<t_Report>(row.state);
+        driver = pool.create<t_SimpleOnOff>(row.pin, row.state == PASS);
+      break;
+#ifdef BrugVejbom
+      case BARRIER: {
+        t_Servo servo;
+        byte index;
+        for (index=0; index < layout.noServos; index++) {
+          memcpy_P(&servo, &layout.servos[index], sizeof(servo));
+          if (servo.name == row.name) break;
+        }
+        if (index == layout.noServos) return nullptr;
+        t_ServoMotor *motor = pool.create<t_ServoMotor>(row.state == PASS);
+        item = pool.create<t_Barrier>(row.state);
+        if (motor == nullptr) return nullptr;
+        motor->startMotor(row.pin, servo.angleAdjust, servo.angleDiff, servo.barrierTime, servo.minPulseWidth, servo.maxPulseWidth);
+        driver = motor;
+      }
+      break;
+#endif
+    }
+    if ((item == nullptr) || (driver == nullptr)) return nullptr;
+    item->setDriver(driver);
+    if (whiteDrv != nullptr) signal->setWhiteLamp(whiteDrv);
+    return item;
+  }
+
+  bool build(t_Crossing &target, const t_Layout *a_layout, byte *data, size_t size) {
+    t_Layout layout;
+    t_Ctrl ctrl;
+    t_Device device;
+    t_Pool pool(data, size);
+    memcpy_P(&layout, a_layout, sizeof(layout));
+    for (byte index=0; index < layout.noCtrls; index++) {
+      memcpy_P(&ctrl, &layout.ctrls[index], sizeof(ctrl));
+      t_CrossingCtrl *item = makeCtrl(pool, ctrl);
+      if (item == nullptr) return false;
+      target.setCtrl(ctrl.name, item);
+    }
+    for (byte index=0; index < layout.noDevices; index++) {
+      memcpy_P(&device, &layout.devices[index], sizeof(device));
+      t_CrossingDevice *item = makeDevice(pool, device, layout);
+      if (item == nullptr) return false;
+      target.setDevice(device.name, item);
+    }
+    return true;
+  }
+
+  template <size_t Size>
+  struct t_Store {
+    static_assert(Size > 0, "Konfiguration uden enheder");
+    alignas(max_align_t) byte data[Size];
+    bool build(t_Crossing &target, const t_Layout *layout) {return Config::build(target, layout, data, Size);}
+  };
+}
+
+#endif
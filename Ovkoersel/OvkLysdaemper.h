@@ -0,0 +1,266 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Overkørsel lysdæmper med bitvinkelmodulation
+ * Version: 1.1
+ * Type: Bibliotek
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel kerne komponenter.
+ *
+ * "Overkørsel lysdæmper" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel lysdæmper" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel lysdæmper".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Inkluderes af OvkHWDrivere.h, når BrugLysdaemper er defineret. Giver t_DimmedLamp til lamper i signaler.
+ * Bruger timer 2 og compare kanal A med egen interrupt. tone() og analogWrite() på ben 3 og 11 kan ikke bruges samtidig.
+ * Version 1.1: Nyt mønster meldes med release og læses med acquire i interrupt
+ */
+
+#include <Arduino.h>
+#include "OvkTiming.h"
+
+#ifndef OvkLysdaemper_h
+#define OvkLysdaemper_h
+
+// Ansvar: Dæmper lamper med bitvinkelmodulation fra én timer compare kanal.
+// En ramme er delt i Bits perioder, hvor periode k varer 2^k enheder. Ved start af hver periode skrives lampernes bit k
+// til alle porte med én skrivning per port, så en lampe med niveau n er tændt n enheder af rammen.
+// Interrupt koster det samme for alle niveauer og antal lamper: Bits interrupts per ramme og én skrivning per port i hver.
+// Timeren kører kun, mens en lampe har et niveau mellem slukket og fuldt tændt. Ellers skrives portene direkte.
+// Tænd og sluk følger FadeCurve, som ligner en glødelampe, der varmes op og køles af. Forløbet tælles frem hver klokcyklus,
+// og niveauet beregnes af den nærmeste del af kurven. Skiftes retning under forløbet, vendes det fra aktuelt niveau.
+// Mønstre for perioderne beregnes udenfor interrupt i den ledige af 2 kopier og tages i brug ved næste rammestart.
+// MaxNoLamps, MaxNoPorts: Antal lamper og porte der kan tilknyttes. En Uno har 3 porte
+// NoLamp: Ben kan ikke tilknyttes
+// Bits: Antal perioder per ramme. Giver 256 niveauer
+// TicksPerUnit: Timer 2 med forskaler 256 tæller hver 16. µsek ved 16 MHz. En enhed er 32 µsek og en ramme 8160 µsek
+// FadeOnTime, FadeOffTime: Standard tid i msek for tænd og sluk
+// FadeEnd: Forløb for fuldt tændt
+// FadeCurve: Niveau i 16 dele af forløbet
+// t_Lamp: port, mask: Port index og benets bit. target: Skal være tændt. position: Forløb fra 0 til FadeEnd
+//   stepOn, stepOff: Forløb per klokcyklus. level: Aktuelt niveau
+// t_Schedule: pattern: Ben der er tændt i hver periode per port
+// ports, portMask, noPorts: Porte med lamper og lampernes ben på hver port
+// schedule, active, pending: Kopier af mønstre, kopien interrupt bruger og om den anden er klar
+//   pending sættes med release efter mønsteret er skrevet og læses med acquire af interrupt, så mønsteret er færdigt før det tages i brug
+// running: Timeren kører. bitNo: Aktuel periode. Bruges af interrupt
+// noFrames, noCompares: Antal rammer og interrupts siden start
+// attach(...): Tilknytter et ben, sætter tider for tænd og sluk og leverer index til lampe
+// write(...): Tænder eller slukker en lampe. Forløbet tælles frem af doClockCycle(...)
+// isFading(...): Svarer på om en lampe er under tænd eller sluk
+// curve(...): Leverer niveau for et forløb
+// build(...): Beregner mønstre ud fra niveauer
+// start(...), stop(...): Starter timer, eller stopper den og skriver portene direkte
+// doClockCycle(...): Tæller forløb frem og beregner mønstre, hvis et niveau er ændret. Kaldes én gang per klokcyklus efter ydre enheder
+// onCompare(...): Kaldes af interrupt ved compare
+// Med tickless klok holdes klokken vågen, mens en lampe tændes eller slukkes
+namespace LampDimmer {
+  const byte MaxNoLamps=8;
+  const byte MaxNoPorts=3;
+  const byte NoLamp=0xFF;
+  const byte Bits=8;
+  const byte TicksPerUnit=2;
+  const unsigned int FadeOnTime=150;
+  const unsigned int FadeOffTime=250;
+  const unsigned int FadeEnd=256;
+  const byte FadeCurve[17]={0, 0, 0, 1, 4, 10, 20, 35, 55, 81, 110, 143, 175, 206, 232, 249, 255};
+  struct t_Lamp {
+    byte port;
+    byte mask;
+    bool target;
+    unsigned int position;
+    unsigned int stepOn;
+    unsigned int stepOff;
+    byte level;
+  };
+  struct t_Schedule {
+    byte pattern[Bits][MaxNoPorts];
+  };
+  t_Lamp lamps[MaxNoLamps];
+  byte noLamps=0;
+  byte ports[MaxNoPorts];
+  byte portMask[MaxNoPorts];
+  byte noPorts=0;
+  t_Schedule schedule[2];
+  byte active=0;
+  bool pending=false;
+  bool running=false;
+  byte bitNo=Bits-1;
+  volatile unsigned long noFrames=0;
+  volatile unsigned long noCompares=0;
+
+  unsigned int step(unsigned int time) {
+    if (time <= Clock::ClockCycle) return FadeEnd;
+    return ((unsigned long)FadeEnd*Clock::ClockCycle+time-1)/time;
+  }
+
+  byte curve(unsigned int position) {
+    byte part = position >> 4;
+    if (part >= 16) return FadeCurve[16];
+    return FadeCurve[part]+(((FadeCurve[part+1]-FadeCurve[part])*(position & 15)) >> 4);
+  }
+
+  void build(void) {
+    // Interrupt skifter ikke kopi, mens den ledige skrives
+    __atomic_store_n(&pending, false, __ATOMIC_SEQ_CST);
+    t_Schedule &item = schedule[__atomic_load_n(&active, __ATOMIC_SEQ_CST) ^ 1];
+    item = t_Schedule();
+    for (byte index=0; index < noLamps; index++) {
+      const t_Lamp &lamp = lamps[index];
+      for (byte bit=0; bit < Bits; bit++) if ((lamp.level & (1 << bit)) != 0) item.pattern[bit][lamp.port] |= lamp.mask;
+    }
+    __atomic_store_n(&pending, true, __ATOMIC_RELEASE);
+  }
+
+  void start(void) {
+    if (running == true) return;
+    bitNo = Bits-1;
+    running = true;
+    OCR2A = 0;
+#ifdef __AVR__
+    TCCR2A = bit(WGM21);
+    TCNT2 = 0;
+    TIFR2 = bit(OCF2A);
+    TIMSK2 |= bit(OCIE2A);
+    TCCR2B = bit(CS22) | bit(CS21);
+#endif
+  }
+
+  void stop(void) {
+#ifdef __AVR__
+    TIMSK2 &= ~bit(OCIE2A);
+    TCCR2B = 0;
+#endif
+    running = false;
+    if (__atomic_load_n(&pending, __ATOMIC_ACQUIRE) == true) {
+      __atomic_store_n(&active, (byte)(active ^ 1), __ATOMIC_RELAXED);
+      __atomic_store_n(&pending, false, __ATOMIC_RELAXED);
+    }
+    // Alle lamper er slukket eller fuldt tændt, så alle perioder har samme mønster
+    const t_Schedule &item = schedule[active];
+    for (byte port=0; port < noPorts; port++) {
+      noInterrupts();   // Servopulser og andre interrupts kan skrive til samme port
+      *portOutputRegister(ports[port]) = (*portOutputRegister(ports[port]) & ~portMask[port]) | item.pattern[0][port];
+      interrupts();
+    }
+  }
+
+  byte attach(byte pin, bool value, unsigned int fadeOnTime, unsigned int fadeOffTime) {
+    byte port = digitalPinToPort(pin);
+    byte index;
+    if ((port == NOT_A_PIN) || (noLamps >= MaxNoLamps)) return NoLamp;
+    for (index=0; index < noPorts; index++) if (ports[index] == port) break;
+    if (index == noPorts) {
+      if (noPorts >= MaxNoPorts) return NoLamp;
+      ports[noPorts++] = port;
+    }
+    t_Lamp &lamp = lamps[noLamps];
+    lamp.port = index;
+    lamp.mask = digitalPinToBitMask(pin);
+    lamp.target = value;
+    lamp.position = (value == HIGH)?FadeEnd:0;
+    lamp.stepOn = step(fadeOnTime);
+    lamp.stepOff = step(fadeOffTime);
+    lamp.level = curve(lamp.position);
+    portMask[index] |= lamp.mask;
+    noLamps++;
+    build();
+    if (running == false) stop();
+    return noLamps-1;
+  }
+
+  void write(byte index, bool value) {lamps[index].target = value;}
+
+  bool isFading(byte index) {
+    const t_Lamp &lamp = lamps[index];
+    return lamp.position != ((lamp.target == HIGH)?FadeEnd:0);
+  }
+
+  void doClockCycle(void) {
+    bool changed = false;
+    bool dimmed = false;
+    for (byte index=0; index < noLamps; index++) {
+      t_Lamp &lamp = lamps[index];
+      if ((lamp.target == HIGH) && (lamp.position < FadeEnd))
+        lamp.position = (FadeEnd-lamp.position > lamp.stepOn)?lamp.position+lamp.stepOn:FadeEnd;
+      else if ((lamp.target == LOW) && (lamp.position > 0))
+        lamp.position = (lamp.position > lamp.stepOff)?lamp.position-lamp.stepOff:0;
+      else continue;
+#ifdef BrugTicklessKlok
+      Clock::stayAwake();
+#endif
+      byte level = curve(lamp.position);
+      if (level != lamp.level) {
+        lamp.level = level;
+        changed = true;
+      }
+    }
+    if (changed == false) return;
+    for (byte index=0; index < noLamps; index++) if ((lamps[index].level != 0) && (lamps[index].level != 255)) dimmed = true;
+    build();
+    if (dimmed == true) start();
+    else stop();
+  }
+
+  void onCompare(void) {
+    noCompares++;
+    bitNo = (bitNo+1) & (Bits-1);
+    if (bitNo == 0) {
+      noFrames++;
+      if (__atomic_load_n(&pending, __ATOMIC_ACQUIRE) == true) {
+        __atomic_store_n(&active, (byte)(active ^ 1), __ATOMIC_RELAXED);
+        __atomic_store_n(&pending, false, __ATOMIC_RELAXED);
+      }
+    }
+    const t_Schedule &item = schedule[active];
+    for (byte port=0; port < noPorts; port++)
+      *portOutputRegister(ports[port]) = (*portOutputRegister(ports[port]) & ~portMask[port]) | item.pattern[bitNo][port];
+    OCR2A = (TicksPerUnit << bitNo)-1;
+  }
+}
+
+#ifdef __AVR__
+ISR(TIMER2_COMPA_vect) {LampDimmer::onCompare();}
+#endif
+
+// Ansvar: Output driver til lamper, som tænder og slukker blødt gennem LampDimmer. Kan bruges i stedet for t_SimpleOnOff.
+// pin: Arduino portnr
+// index: Lampe i LampDimmer
+// sendOut(...): Tænder eller slukker lampen. Kan benet ikke tilknyttes, skrives direkte uden dæmpning
+// isBusy(...): Lampen er under tænd eller sluk. Bruges ved hændelsesstyring
+class t_DimmedLamp: public t_DigitalOutDrv {
+private:
+  byte pin;
+  byte index;
+  void sendOut(void);
+public:
+  t_DimmedLamp(byte a_pin, bool a_value=LOW, unsigned int fadeOnTime=LampDimmer::FadeOnTime, unsigned int fadeOffTime=LampDimmer::FadeOffTime);
+#ifdef BrugHaendelsesstyring
+  bool isBusy(void) const {return (index != LampDimmer::NoLamp) && LampDimmer::isFading(index);}
+#endif
+};
+
+t_DimmedLamp::t_DimmedLamp(byte a_pin, bool a_value, unsigned int fadeOnTime, unsigned int fadeOffTime) : t_DigitalOutDrv(a_value), pin(a_pin) {
+  digitalWrite(pin, a_value);
+  pinMode(pin, OUTPUT);
+  index = LampDimmer::attach(pin, a_value, fadeOnTime, fadeOffTime);
+}
+
+void t_DimmedLamp::sendOut(void) {
+  if (index == LampDimmer::NoLamp) digitalWrite(pin, value);
+  else LampDimmer::write(index, value);
+}
+
+#endif
@@ -0,0 +1,308 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Overkørsel seriel forbindelse til sikringsanlæg
+ * Version: 1.2
+ * Type: Bibliotek
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel kerne komponenter.
+ *
+ * "Overkørsel seriel forbindelse" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel seriel forbindelse" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel seriel forbindelse".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Version 1.1: Betjeningsenhed over seriel forbindelse registrerer ændringer ved BrugSporing
+ * Version 1.2: Ringbuffer med acquire og release, og forespørgsler i kø
+ * Inkluderes af Ovkoersel.h, når BrugSeriel er defineret.
+ * Bruger UART 0 med egne interrupts og kan ikke bruges sammen med Serial.
+ */
+
+#include <Arduino.h>
+#include "OvkTiming.h"
+#include "OvkHWDrivere.h"
+
+#ifndef OvkSerial_h
+#define OvkSerial_h
+
+// Ansvar: Ringbuffer mellem interrupt og klokcyklus. Interrupt skriver og klokcyklus læser eller omvendt.
+// Bufferen bruger ingen lås. Hver side ejer sit index og læser det andet med acquire. Skriveren flytter head med release,
+// efter data er skrevet, og læseren flytter tail med release, efter data er læst, så compileren ikke kan bytte om på dem.
+// Size: Antal byte, skal være en potens af 2
+// head, tail: Index til næste byte som skrives og læses. En byte skrives og læses atomart på en Uno
+// put(...): Lægger en byte i bufferen. Svarer false når bufferen er fuld
+// get(...): Henter en byte. Svarer false når bufferen er tom
+// peek(...): Læser en byte i bufferen uden at fjerne den. Kun læseren, og kun byte som used(...) har talt med
+// drop(...): Fjerner læste byte
+// used(...), space(...): Antal byte i bufferen og antal ledige
+template <byte Size>
+struct t_RingBuffer {
+  static_assert((Size & (Size-1)) == 0, "Ringbuffer skal have en størrelse som er en potens af 2");
+  byte head = 0;
+  byte tail = 0;
+  byte data[Size];
+  bool put(byte value) {
+    byte next = (head+1) & (Size-1);
+    if (next == __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) return false;
+    data[head] = value;
+    __atomic_store_n(&head, next, __ATOMIC_RELEASE);
+    return true;
+  }
+  bool get(byte &value) {
+    if (tail == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) return false;
+    value = data[tail];
+    __atomic_store_n(&tail, (byte)((tail+1) & (Size-1)), __ATOMIC_RELEASE);
+    return true;
+  }
+  byte peek(byte offset) const {return data[(tail+offset) & (Size-1)];}
+  void drop(byte noBytes) {__atomic_store_n(&tail, (byte)((tail+noBytes) & (Size-1)), __ATOMIC_RELEASE);}
+  byte used(void) const {return (__atomic_load_n(&head, __ATOMIC_ACQUIRE)-__atomic_load_n(&tail, __ATOMIC_ACQUIRE)) & (Size-1);}
+  byte space(void) const {return Size-1-used();}
+};
+
+//----------
+
+// Ansvar: Seriel forbindelse til sikringsanlæg med meldinger i rammer og kvittering.
+// Interrupt lægger modtagne byte i rx og henter byte til afsendelse fra tx. Klokcyklus venter aldrig på UART.
+// En ramme er 6 byte: Start, type, sekvensnr, navn, værdi og CRC-8 over type til værdi.
+// Rammer bliver fortolket, mens de ligger i rx. Ved forkert CRC smides startbyte væk og næste start søges.
+// Meldinger fra sikringsanlæg:
+//   CTRL: Sætter indgang navn til værdi. Læses af t_SerialIn og derfra af crossing.status(...). Kvitteres med ACK
+//   QUERY: Spørger om crossing.status(navn). Besvares med STATUS og samme sekvensnr. Forespørgsler stilles i kø,
+//     så flere i samme klokcyklus alle bliver besvaret. Er køen fuld, tælles forespørgslen som tabt, og sikringsanlæg spørger igen
+//   ACK: Kvitterer for DEVICE med samme sekvensnr
+// Meldinger til sikringsanlæg:
+//   DEVICE: Ydre enhed navn er sat til værdi af crossing.to(...) gennem t_SerialOut. Sendes igen indtil ACK
+//   STATUS: Svar på QUERY
+//   ACK: Kvitterer for CTRL
+// Ændrer en ydre enhed sig igen før kvittering, sendes kun seneste værdi.
+// RxSize, TxSize: Størrelse af ringbuffere
+// AckCycles: Klokcyklusser før DEVICE sendes igen
+// MaxRetries: Gentagelser før forbindelsen meldes tabt. Der bliver ved med at blive sendt
+// MaxNoQueries: Forespørgsler der kan vente. Så mange som rx kan rumme, og én der venter på plads i tx
+// inLevel: Værdi sat af sikringsanlæg for hver betjeningsenhed
+// outLevel, outPending: Seneste værdi for hver ydre enhed, og om den venter på at blive sendt
+// waiting, waitingName, waitingSeq, waitingCycles, retries: Afsendt DEVICE som venter på kvittering
+// queryName, querySeq, noQueries: Forespørgsler i modtaget orden, som besvares ved afslutning af klokcyklus
+// noFrames, noErrors, noRetries, noOverruns: Antal modtagne rammer, rammer med fejl, gentagelser og tabte byte
+// noLostQueries: Forespørgsler tabt fordi køen var fuld
+// begin(...): Starter UART
+// crc8(...): Beregner CRC-8 med polynomium 0x07
+// receive(...): Modtager en byte. Kaldes af interrupt
+// transmit(...): Henter næste byte til afsendelse. Kaldes af interrupt
+// send(...): Lægger en ramme i tx. Er der ikke plads, sendes rammen ikke
+// read(...): Leverer værdi sat af sikringsanlæg
+// write(...): Melder ny værdi for en ydre enhed
+// doClockCycle(...): Fortolker modtagne rammer. Kaldes ved start af klokcyklus
+// hasQuery(...), query(...), answer(...): Besvarer ældste forespørgsel. answer(...) svarer false, når tx er fuld
+// flush(...): Sender ventende meldinger og styrer gentagelse. Kaldes ved afslutning af klokcyklus
+// isConnected(...): Svarer på om sikringsanlæg kvitterer
+namespace SerialLink {
+  const byte RxSize=32;
+  const byte TxSize=32;
+  const byte Start=0x7E;
+  const byte FrameSize=6;
+  const byte AckCycles=20;
+  const byte MaxRetries=5;
+  const byte MaxNoQueries=RxSize/FrameSize+1;
+  enum {CTRL=1, DEVICE, QUERY, STATUS, ACK};
+
+  t_RingBuffer<RxSize> rx;
+  t_RingBuffer<TxSize> tx;
+  byte inLevel[MaxNoCtrls] = {};
+  byte outLevel[MaxNoDevices] = {};
+  byte outPending[(MaxNoDevices+7)/8] = {};
+  bool waiting = false;
+  byte waitingName = 0;
+  byte waitingSeq = 0;
+  byte waitingCycles = 0;
+  byte retries = 0;
+  byte txSeq = 0;
+  byte queryName[MaxNoQueries];
+  byte querySeq[MaxNoQueries];
+  byte noQueries = 0;
+  unsigned long noFrames = 0;
+  unsigned long noErrors = 0;
+  unsigned long noRetries = 0;
+  volatile unsigned long noOverruns = 0;
+  unsigned long noLostQueries = 0;
+
+  void begin(unsigned long baud) {
+#ifdef __AVR__
+    UCSR0A = bit(U2X0);
+    UBRR0 = (F_CPU/4/baud-1)/2;
+    UCSR0C = bit(UCSZ01) | bit(UCSZ00);
+    UCSR0B = bit(RXEN0) | bit(TXEN0) | bit(RXCIE0);
+#else
+    (void)baud;
+#endif
+  }
+
+  byte crc8(const byte *data, byte length) {
+    byte crc = 0;
+    while (length-- > 0) {
+      crc ^= *data++;
+      for (byte cnt=0; cnt < 8; cnt++) crc = (crc & 0x80)?((crc << 1) ^ 0x07):(crc << 1);
+    }
+    return crc;
+  }
+
+  void receive(byte value) {
+    if (rx.put(value) == false) noOverruns++;
+#ifdef BrugTicklessKlok
+    Clock::wake();
+#endif
+  }
+
+  bool transmit(byte &value) {return tx.get(value);}
+
+  bool send(byte type, byte seq, byte name, byte value) {
+    byte frame[FrameSize] = {Start, type, seq, name, value, 0};
+    if (tx.space() < FrameSize) return false;
+    frame[FrameSize-1] = crc8(frame+1, FrameSize-2);
+    for (byte cnt=0; cnt < FrameSize; cnt++) tx.put(frame[cnt]);
+#ifdef __AVR__
+    UCSR0B |= bit(UDRIE0);
+#endif
+    return true;
+  }
+
+  byte read(byte name) {return (name < MaxNoCtrls)?inLevel[name]:OFF;}
+
+  void write(byte name, byte value) {
+    if (name >= MaxNoDevices) return;
+    outLevel[name] = value;
+    outPending[name/8] |= (1 << (name%8));
+  }
+
+  void doClockCycle(void) {
+    byte frame[FrameSize];
+    while (rx.used() >= FrameSize) {
+      if (rx.peek(0) != Start) {
+        rx.drop(1);
+        continue;
+      }
+      for (byte cnt=1; cnt < FrameSize; cnt++) frame[cnt] = rx.peek(cnt);
+      if (crc8(frame+1, FrameSize-2) != frame[FrameSize-1]) {
+        noErrors++;
+        rx.drop(1);
+        continue;
+      }
+      rx.drop(FrameSize);
+      noFrames++;
+      byte type = frame[1], seq = frame[2], name = frame[3], value = frame[4];
+      switch (type) {
+        case CTRL:
+          if (name < MaxNoCtrls) inLevel[name] = (value != OFF);
+          send(ACK, seq, name, value);
+        break;
+        case QUERY:
+          if (noQueries >= MaxNoQueries) {
+            noLostQueries++;
+            break;
+          }
+          queryName[noQueries] = name;
+          querySeq[noQueries++] = seq;
+        break;
+        case ACK:
+          if ((waiting == true) && (seq == waitingSeq)) {
+            waiting = false;
+            retries = 0;
+          }
+        break;
+      }
+    }
+  }
+
+  bool hasQuery(void) {return noQueries > 0;}
+
+  byte query(void) {return queryName[0];}
+
+  bool answer(byte value) {
+    if (send(STATUS, querySeq[0], queryName[0], value) == false) return false;
+    noQueries--;
+    for (byte pos=0; pos < noQueries; pos++) {
+      queryName[pos] = queryName[pos+1];
+      querySeq[pos] = querySeq[pos+1];
+    }
+    return true;
+  }
+
+  void flush(void) {
+    if (waiting == true) {
+      if (++waitingCycles < AckCycles) return;
+      if (send(DEVICE, waitingSeq, waitingName, outLevel[waitingName]) == false) return;
+      waitingCycles = 0;
+      noRetries++;
+      if (retries < MaxRetries) retries++;
+      return;
+    }
+    for (byte name=0; name < MaxNoDevices; name++) {
+      byte mask = 1 << (name%8);
+      if ((outPending[name/8] & mask) == 0) continue;
+      if (send(DEVICE, txSeq, name, outLevel[name]) == false) return;
+      outPending[name/8] &= ~mask;
+      waiting = true;
+      waitingName = name;
+      waitingSeq = txSeq++;
+      waitingCycles = 0;
+      return;
+    }
+  }
+
+  bool isConnected(void) {return retries < MaxRetries;}
+}
+
+#ifdef __AVR__
+ISR(USART_RX_vect) {SerialLink::receive(UDR0);}
+ISR(USART_UDRE_vect) {
+  byte value;
+  if (SerialLink::transmit(value) == true) UDR0 = value;
+  else UCSR0B &= ~bit(UDRIE0);
+}
+#endif
+
+//----------
+
+// Ansvar: Hardware driver for en betjeningsenhed, som sikringsanlægget sætter over seriel forbindelse.
+// name: Betjeningsenhedens navn i meldinger
+// doClockCycle(...): Henter værdi modtaget fra sikringsanlæg. Ændringer bliver registreret ved BrugSporing
+class t_SerialIn: public t_DigitalInDrv {
+private:
+  byte name;
+public:
+  t_SerialIn(byte a_name) : name(a_name) {value = OFF;}
+  void doClockCycle(void);
+};
+
+void t_SerialIn::doClockCycle(void) {
+  bool level = SerialLink::read(name);
+#ifdef BrugSporing
+  if (level != value) Trace::record(Trace::LINK, name | (level << 7));
+#endif
+  value = level;
+}
+
+// Ansvar: Hardware driver for en ydre enhed, som melder til sikringsanlægget over seriel forbindelse.
+// name: Den ydre enheds navn i meldinger
+// sendOut(...): Melder værdi til sikringsanlæg
+class t_SerialOut: public t_DigitalOutDrv {
+private:
+  byte name;
+  void sendOut(void) {SerialLink::write(name, value);}
+public:
+  t_SerialOut(byte a_name, bool a_value = LOW) : t_DigitalOutDrv(a_value), name(a_name) {}
+};
+
+#endif
@@ -0,0 +1,256 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Overkørsel servopulser fra én timer
+ * Version: 1.3
+ * Type: Bibliotek
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel kerne komponenter.
+ *
+ * "Overkørsel servopulser" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel servopulser" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel servopulser".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Version 1.1: Kanter der er passeret under forsinket interrupt udføres i samme interrupt, og mindste afstand mellem kanter er 20 µsek
+ * Version 1.2: Ny liste meldes med release og læses med acquire i interrupt
+ * Version 1.3: Kun samme pulsbredde deler kant. Tætte kanter ventes der på i interrupt
+ * Inkluderes af OvkHWDrivere.h, når BrugVejbom og BrugServoPuls er defineret. Erstatter Servo biblioteket for t_ServoMotor.
+ * Bruger timer 1 og compare kanal A med egen interrupt og kan ikke bruges sammen med Servo biblioteket.
+ */
+
+#include <Arduino.h>
+
+#ifndef OvkServoPuls_h
+#define OvkServoPuls_h
+
+// Ansvar: Pulser til alle servomotorer fra én timer compare kanal.
+// Ved start af en ramme sættes alle servoer høje. Derefter slår compare til ved hver kant i en sorteret liste,
+// og de servoer, hvis puls slutter der, sættes lave med én skrivning per port.
+// Kun servoer med samme pulsbredde deler kant, så hver puls får præcis sin bredde, også ved små justeringer af en bom.
+// Er næste kant under MinGapTicks ude i fremtiden, er der ikke tid til et nyt interrupt. Interrupt venter så de få µsek
+// på kanten og udfører den selv. Højst MaxNoServos+1 interrupts per ramme og højst MaxNoServos-1 ventetider på MinGapTicks.
+// Er interrupt forsinket af andre interrupts, så næste kant allerede er passeret, udføres den også i samme interrupt.
+// Ellers ville compare først slå til, når timeren er løbet rundt, og pulsen blive 32 msek for lang.
+// Listen beregnes udenfor interrupt i den ledige af 2 kopier og tages i brug ved næste rammestart.
+// MaxNoServos: 2 sæt vejbomme med op til 2 bomme hver
+// MaxNoPorts: Antal porte der kan have servoer. En Uno har 3 porte
+// NoServo: Ben kan ikke tilknyttes
+// TicksPerMicros: Timer 1 med forskaler 8 ved 16 MHz
+// FrameTicks, MinGapTicks: Rammens længde og mindste afstand til næste kant for et nyt interrupt i timer tællinger.
+//   MinGapTicks dækker forsinkelse fra millis() interrupt og tid i onCompare(...). En tættere kant ventes der på i interrupt
+// FrameStart: Næste compare er rammestart
+// t_Edge: ticks: Tid fra rammestart. mask: Ben der sættes lave per port
+// t_Schedule: raise: Ben der sættes høje per port ved rammestart. edges: Sorterede kanter
+// ports, noPorts: Porte med servoer
+// servoPort, servoMask, width: Port index, ben og pulsbredde i tællinger for hver servo
+// schedule, active, pending: Kopier af listen, kopien interrupt bruger og om den anden er klar
+//   pending sættes med release efter listen er skrevet og læses med acquire af interrupt, så listen er færdig før den tages i brug
+// next, frameStart: Kant som compare venter på og tid for rammestart. Bruges kun af interrupt
+// noFrames, noCompares, maxCompares: Antal rammer, antal interrupts og flest interrupts i en ramme
+// frameCompares: Interrupts i aktuel ramme
+// noCoalesced: Servoer med samme pulsbredde som forrige i seneste liste
+// noLate: Kanter udført i samme interrupt som forrige, fordi deres tid var passeret eller for tæt på
+// begin(...): Starter timer og første ramme
+// attach(...): Tilknytter et ben og leverer index til servo
+// write(...): Sætter pulsbredde i mikrosek. Gælder fra næste ramme
+// build(...): Sorterer servoer efter pulsbredde og beregner kanter
+// ahead(...): Leverer tællinger til tiden i OCR1A. Over FrameTicks betyder, at tiden er passeret. Forsinkelse skal være under 12 msek
+// startFrame(...): Tæller rammen og tager ny liste i brug
+// serve(...): Udfører rammestart eller næste kant og sætter OCR1A til den følgende
+// onCompare(...): Kaldes af interrupt ved compare
+namespace ServoPulse {
+  const byte MaxNoServos=4;
+  const byte MaxNoPorts=3;
+  const byte NoServo=0xFF;
+  const byte TicksPerMicros=2;
+  const unsigned int FrameTicks=20000U*TicksPerMicros;
+  const unsigned int MinGapTicks=20*TicksPerMicros;
+  const byte FrameStart=0xFF;
+  struct t_Edge {
+    unsigned int ticks;
+    byte mask[MaxNoPorts];
+  };
+  struct t_Schedule {
+    byte noEdges;
+    byte raise[MaxNoPorts];
+    t_Edge edges[MaxNoServos];
+  };
+  byte ports[MaxNoPorts];
+  byte noPorts=0;
+  byte servoPort[MaxNoServos];
+  byte servoMask[MaxNoServos];
+  unsigned int width[MaxNoServos];
+  byte noServos=0;
+  t_Schedule schedule[2];
+  byte active=0;
+  bool pending=false;
+  byte next=FrameStart;
+  unsigned int frameStart=0;
+  volatile unsigned long noFrames=0;
+  volatile unsigned long noCompares=0;
+  volatile byte maxCompares=0;
+  byte frameCompares=0;
+  byte noCoalesced=0;
+  volatile unsigned long noLate=0;
+
+  void begin(void) {
+    frameStart = TCNT1+FrameTicks;
+    OCR1A = frameStart;
+#ifdef __AVR__
+    TCCR1A = 0;
+    TCCR1B = bit(CS11);
+    TIFR1 = bit(OCF1A);
+    TIMSK1 |= bit(OCIE1A);
+#endif
+  }
+
+  void build(void) {
+    byte order[MaxNoServos];
+    byte noOrdered = 0;
+    // Interrupt skifter ikke kopi, mens den ledige skrives
+    __atomic_store_n(&pending, false, __ATOMIC_SEQ_CST);
+    t_Schedule &item = schedule[__atomic_load_n(&active, __ATOMIC_SEQ_CST) ^ 1];
+    item = t_Schedule();
+    noCoalesced = 0;
+    for (byte index=0; index < noServos; index++) {
+      byte pos = noOrdered++;
+      while ((pos > 0) && (width[order[pos-1]] > width[index])) {
+        order[pos] = order[pos-1];
+        pos--;
+      }
+      order[pos] = index;
+      item.raise[servoPort[index]] |= servoMask[index];
+    }
+    for (byte pos=0; pos < noOrdered; pos++) {
+      byte index = order[pos];
+      t_Edge *edge = (item.noEdges > 0)?&item.edges[item.noEdges-1]:nullptr;
+      if ((edge != nullptr) && (width[index] == edge->ticks)) noCoalesced++;
+      else {
+        edge = &item.edges[item.noEdges++];
+        edge->ticks = width[index];
+      }
+      edge->mask[servoPort[index]] |= servoMask[index];
+    }
+    __atomic_store_n(&pending, true, __ATOMIC_RELEASE);
+  }
+
+  byte attach(byte pin) {
+    byte port = digitalPinToPort(pin);
+    byte index;
+    if ((port == NOT_A_PIN) || (noServos >= MaxNoServos)) return NoServo;
+    for (index=0; index < noPorts; index++) if (ports[index] == port) break;
+    if (index == noPorts) {
+      if (noPorts >= MaxNoPorts) return NoServo;
+      ports[noPorts++] = port;
+    }
+    digitalWrite(pin, LOW);
+    pinMode(pin, OUTPUT);
+    servoPort[noServos] = index;
+    servoMask[noServos] = digitalPinToBitMask(pin);
+    width[noServos] = 1500*TicksPerMicros;
+    if (noServos++ == 0) begin();
+    build();
+    return noServos-1;
+  }
+
+  void write(byte index, int pulseWidth) {
+    unsigned int ticks = pulseWidth*TicksPerMicros;
+    if ((index >= noServos) || (ticks == width[index])) return;
+    width[index] = ticks;
+    build();
+  }
+
+  uint16_t ahead(void) {return OCR1A-TCNT1;}
+
+  void startFrame(void) {
+    if (frameCompares > maxCompares) maxCompares = frameCompares;
+    frameCompares = 0;
+    noFrames++;
+    if (__atomic_load_n(&pending, __ATOMIC_ACQUIRE) == true) {
+      __atomic_store_n(&active, (byte)(active ^ 1), __ATOMIC_RELAXED);
+      __atomic_store_n(&pending, false, __ATOMIC_RELAXED);
+    }
+  }
+
+  void serve(void) {
+    const t_Schedule &item = schedule[active];
+    if (next == FrameStart) {
+      for (byte port=0; port < noPorts; port++)
+        if (item.raise[port] != 0) *portOutputRegister(ports[port]) = *portOutputRegister(ports[port]) | item.raise[port];
+      next = 0;
+    }
+    else {
+      const t_Edge &edge = item.edges[next];
+      for (byte port=0; port < noPorts; port++)
+        if (edge.mask[port] != 0) *portOutputRegister(ports[port]) = *portOutputRegister(ports[port]) & ~edge.mask[port];
+      next++;
+    }
+    if (next < item.noEdges) OCR1A = frameStart+item.edges[next].ticks;
+    else {
+      next = FrameStart;
+      frameStart += FrameTicks;
+      OCR1A = frameStart;
+    }
+  }
+
+  void onCompare(void) {
+    noCompares++;
+    if (next == FrameStart) startFrame();
+    frameCompares++;
+    serve();
+    // Tid til compare er højst en ramme. Mere betyder, at tiden er passeret
+    uint16_t left = ahead();
+    while ((left < MinGapTicks) || (left > FrameTicks)) {
+      // Næste kant er for tæt på til et nyt interrupt og ventes der på her
+      while ((left != 0) && (left <= FrameTicks)) left = ahead();
+#ifdef __AVR__
+      // Kanten udføres her, så et compare der nåede at slå til, må ikke give et interrupt mere
+      TIFR1 = bit(OCF1A);
+#endif
+      noLate++;
+      if (next == FrameStart) startFrame();
+      serve();
+      left = ahead();
+    }
+  }
+}
+
+#ifdef __AVR__
+ISR(TIMER1_COMPA_vect) {ServoPulse::onCompare();}
+#endif
+
+// Ansvar: Servomotor med samme grænseflade som Servo biblioteket, så t_ServoMotor kan bruge ServoPulse.
+// index: Servo i ServoPulse
+// pulseWidth: Sidst skrevne pulsbredde i mikrosek
+class t_ServoPulse {
+private:
+  byte index;
+  int pulseWidth;
+public:
+  t_ServoPulse(void): index(ServoPulse::NoServo), pulseWidth(1500) {}
+  uint8_t attach(int pin) {
+    index = ServoPulse::attach(pin);
+    if (index != ServoPulse::NoServo) ServoPulse::write(index, pulseWidth);
+    return index;
+  }
+  bool attached(void) const {return index != ServoPulse::NoServo;}
+  void writeMicroseconds(int a_pulseWidth) {
+    pulseWidth = a_pulseWidth;
+    if (attached() == true) ServoPulse::write(index, pulseWidth);
+  }
+  int readMicroseconds(void) const {return pulseWidth;}
+};
+
+#endif
@@ -1,10 +1,10 @@
 /*
  * Projekt: Overkørsel st. enkeltsporet strækning
  * Produkt: Timing bibliotek til overkørsel
- * Version: 1.0
+ * Version: 1.9
  * Type: Bibliotek
  * Programmeret af: Jan Birch
- * Opdateret: 26-04-2021
+ * Opdateret: 17-10-2026
  * GNU General Public License version 3
  * This file is part of "Timing bibliotek til overkørsel".
  * 
@@ -23,6 +23,15 @@
  * 
  * Noter:
  * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Version 1.1: Tilføjet tickless klok, som vælges med BrugTicklessKlok
+ * Version 1.2: Tilføjet timerhjul, som vælges med BrugTimerhjul
+ * Version 1.3: Klokmåling af arbejde, overskridelser og forsinkelse, som vælges med BrugKlokmaaling
+ * Version 1.4: Urværk tæller med 16 bit ved polling, når BrugKompakt er defineret
+ * Version 1.5: Oscillatorbank med faseakkumulatorer til blink, som vælges med BrugOscillatorbank
+ * Version 1.6: Pinskift interrupt defineres af OvkKant.h ved BrugKantfangst
+ * Version 1.7: Urværk med varighed under en klokcyklus udløber efter en klokcyklus
+ * Version 1.8: Tickless klok tæller klokcyklusser frem, så urværker fortsætter når millis() løber rundt
+ * Version 1.9: Tider fra millis() og micros() holdes i 32 bit. Klokken ved polling tæller klokcyklusser frem, når millis() løber rundt
  */
 
 #include <Arduino.h>
@@ -30,32 +39,371 @@
 #ifndef OvkTiming_h
 #define OvkTiming_h
 
+#if defined(BrugTimerhjul) && defined(BrugTicklessKlok)
+#error "BrugTimerhjul og BrugTicklessKlok kan ikke bruges samtidig"
+#endif
+
+#ifdef BrugTimerhjul
+namespace TimerWheel {void advance(void);}
+#endif
+#ifdef BrugKlokmaaling
+namespace CycleStats {void stop(void); void start(unsigned long lost);}
+#endif
+
+// Tider fra millis() og micros() holdes i 32 bit, som en Uno's unsigned long, så forskelle også løber rigtigt rundt på andre platforme
 // Ansvar: Klokken varetager taktslaget til polling.
+// Med timerhjul drejer klokken hjulet 1 klokcyklus frem ved hvert taktslag.
 // Det er en ventefunktion som sørger for synkronisering med arduino klokken
 // og kompenserer for den tid det tager at gennemløbe programmet.
 // ClockCycle: Sat til msek
 // pendulum(...): Leverer takslaget
+// Med klokmåling melder klokken hvornår den slår, og hvor mange klokcyklusser den har sprunget over
+#ifndef BrugTicklessKlok
 namespace Clock {
   const byte ClockCycle=5;
   void pendulum(void) {
-    static unsigned long cycleStart=0;
-    unsigned long w_millis;     // Tiden skrider hvis millis læser flere gange
+    static uint32_t cycleStart=0;
+    uint32_t w_millis;     // Tiden skrider hvis millis læser flere gange
+    uint32_t elapsed;
+#ifdef BrugKlokmaaling
+    CycleStats::stop();
+#endif
     do w_millis = millis();
-    while (w_millis < (cycleStart+ClockCycle));
-    cycleStart = (w_millis/ClockCycle)*ClockCycle;  // Omregner til eksakt multiplum clockcykles
+    while ((w_millis-cycleStart) < ClockCycle);
+    elapsed = (w_millis-cycleStart)/ClockCycle;
+#ifdef BrugKlokmaaling
+    CycleStats::start(elapsed-1);
+#endif
+    cycleStart += elapsed*ClockCycle;  // Eksakt multiplum clockcykles, også når millis() løber rundt
+#ifdef BrugTimerhjul
+    TimerWheel::advance();
+#endif
   }
 }
+#else
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
+// Ansvar: Klokken varetager taktslaget uden at polle.
+// Komponenter melder hvornår de har brug for næste klokcyklus. Indtil da sover arduino eller udfører baggrundsarbejde.
+// Et pinskift på en overvåget indgang vækker klokken til næste klokcyklus.
+// Urværkets varighed kan blive op til 1 klokcyklus længere end ved polling, aldrig kortere.
+// ClockCycle: Sat til msek
+// MaxSleepCycles: Længste søvn i antal klokcyklus
+// cycleNo: Nummer på aktuel klokcyklus. Tælles frem med klokcyklusser siden sidst, så det ikke springer når millis() løber rundt efter 49,7 dage
+// nextDue: Første klokcyklus som en komponent har brug for
+// woken: Sat af pinskift
+// idle: Pointer til funktion der sover eller udfører baggrundsarbejde. Kaldes igen indtil næste klokcyklus
+// idleMicros, busyMicros: Akkumuleret tid i søvn og i arbejde
+// noWakeUps, sumJitter, maxJitter: Antal opvågninger og forsinkelse i µsek fra aftalt tid til opvågning
+// reportDue(...): Melder behov for en klokcyklus
+// stayAwake(...): Melder behov for næste klokcyklus, bruges når en komponent skifter trin
+// wake(...): Vækker klokken, kaldes af interrupt
+// watchPin(...): Overvåger en indgang med pinskift interrupt
+// idlePercent(...): Leverer andel af tiden i søvn
+// resetStats(...): Nulstiller målinger. Kald jævnligt, µsek tællere løber rundt efter 71 minutter
+// pendulum(...): Leverer takslaget
+namespace Clock {
+  const byte ClockCycle=5;
+  const unsigned int MaxSleepCycles=200;
+  unsigned long cycleNo=0;
+  unsigned long nextDue=0;
+  volatile bool woken=false;
+  unsigned long idleMicros=0;
+  unsigned long busyMicros=0;
+  unsigned long noWakeUps=0;
+  unsigned long sumJitter=0;
+  unsigned long maxJitter=0;
+
+  void sleep(unsigned long) {
+#ifdef __AVR__
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+#endif
+  }
+  void (*idle)(unsigned long untilMillis)=sleep;
+
+  void reportDue(unsigned long due) {if ((long)(due-nextDue) < 0) nextDue = due;}
+  void stayAwake(void) {reportDue(cycleNo+1);}
+  void wake(void) {woken = true;}
+
+  void watchPin(byte pin) {
+#ifdef __AVR__
+    if (digitalPinToPCICR(pin) == nullptr) return;
+    *digitalPinToPCMSK(pin) |= bit(digitalPinToPCMSKbit(pin));
+    PCIFR |= bit(digitalPinToPCICRbit(pin));
+    *digitalPinToPCICR(pin) |= bit(digitalPinToPCICRbit(pin));
+#endif
+  }
+
+  byte idlePercent(void) {
+    unsigned long total = idleMicros+busyMicros;
+    return (total < 100)?0:idleMicros/(total/100);
+  }
+
+  void resetStats(void) {idleMicros = busyMicros = noWakeUps = sumJitter = maxJitter = 0;}
+
+  void pendulum(void) {
+    static uint32_t leave=micros();
+    static uint32_t cycleMillis=millis();   // millis() ved start af aktuel klokcyklus
+    uint32_t enter=micros();
+    uint32_t dueMillis=cycleMillis+(int32_t)(nextDue-cycleNo)*ClockCycle;
+    uint32_t w_millis=millis();   // Tiden skrider hvis millis læser flere gange
+    uint32_t elapsed;
+    uint32_t jitter;
+#ifdef BrugKlokmaaling
+    CycleStats::stop();
+#endif
+    busyMicros += enter-leave;
+    while ((int32_t)(w_millis-dueMillis) < 0) {
+      if (woken == true) {
+        woken = false;
+        uint32_t wakeMillis = w_millis-(w_millis-cycleMillis)%ClockCycle+ClockCycle;
+        if ((int32_t)(wakeMillis-dueMillis) < 0) dueMillis = wakeMillis;
+      }
+      else idle(dueMillis);
+      w_millis = millis();
+    }
+    leave = micros();
+    idleMicros += leave-enter;
+    jitter = leave-dueMillis*1000;
+    if ((int32_t)jitter > 0) {
+      sumJitter += jitter;
+      if (jitter > maxJitter) maxJitter = jitter;
+    }
+    noWakeUps++;
+    elapsed = (w_millis-cycleMillis)/ClockCycle;   // Forskel løber rigtigt rundt med millis(), resten overføres
+    cycleNo += elapsed;
+    cycleMillis += elapsed*ClockCycle;
+    nextDue = cycleNo+MaxSleepCycles;
+#ifdef BrugKlokmaaling
+    CycleStats::start((w_millis-dueMillis)/ClockCycle);
+#endif
+  }
+}
+
+// Med kantfangst definerer OvkKant.h pinskift interrupt
+#if defined(__AVR__) && !defined(BrugKantfangst)
+#ifdef PCINT0_vect
+ISR(PCINT0_vect) {Clock::wake();}
+#endif
+#ifdef PCINT1_vect
+ISR(PCINT1_vect) {Clock::wake();}
+#endif
+#ifdef PCINT2_vect
+ISR(PCINT2_vect) {Clock::wake();}
+#endif
+#endif
+#endif
 
 //----------
 
+#ifdef BrugKlokmaaling
+// Ansvar: Måler programmets arbejde i hver klokcyklus, så overskridelser ikke bliver skjult af klokken.
+// Arbejdet måles i µsek fra klokken slår, til den bliver kaldt igen. Måling koster 6 kald til micros() per klokcyklus.
+// NoBuckets: Antal intervaller i histogram. Interval i rummer arbejde under Limit[i] µsek. Sidste interval er en hel klokcyklus eller mere
+// CTRLS, STATE, DEVICES: Dele af crossing.doClockCycle(...), som måles hver for sig
+// histogram: Antal klokcyklusser per interval
+// worstCycle, worstPart: Længste arbejde i µsek i alt og for hver del
+// noCycles: Antal klokcyklusser
+// noOverruns, lostCycles: Antal gange klokken har sprunget klokcyklusser over og hvor mange i alt
+// driftMillis: Akkumuleret forsinkelse af urværker. Ved polling tæller urværker klokcyklusser, så hver overskredet klokcyklus forsinker dem.
+//   Med tickless klok følger urværker millis(), så de bliver ikke forsinket
+// stop(...), start(...): Kaldes af klokken, når den bliver kaldt og når den slår. Et program som venter uden for klokken, kalder selv stop(...)
+// mark(...): Afslutter måling af forrige del og starter måling af næste. NoParts afslutter uden at starte ny
+// reset(...): Nulstiller målinger
+namespace CycleStats {
+  const byte NoBuckets=8;
+  const unsigned int Limit[NoBuckets-1]={250, 500, 1000, 2000, 3000, 4000, Clock::ClockCycle*1000U};
+  enum {CTRLS, STATE, DEVICES, NoParts};
+  unsigned long histogram[NoBuckets];
+  unsigned int worstCycle=0;
+  unsigned int worstPart[NoParts];
+  unsigned long noCycles=0;
+  unsigned long noOverruns=0;
+  unsigned long lostCycles=0;
+  unsigned long driftMillis=0;
+  uint32_t cycleStart=0;
+  uint32_t partStart=0;
+  byte part=NoParts;
+  bool measuring=false;
+  bool started=false;
+
+  unsigned int limited(unsigned long micros) {return (micros > 0xFFFF)?0xFFFF:micros;}
+
+  void stop(void) {
+    if (measuring == false) return;
+    measuring = false;
+    unsigned int work = limited((uint32_t)(micros()-cycleStart));
+    byte bucket=0;
+    while ((bucket < NoBuckets-1) && (work >= Limit[bucket])) bucket++;
+    histogram[bucket]++;
+    if (work > worstCycle) worstCycle = work;
+  }
+
+  void start(unsigned long lost) {
+    if ((started == true) && ((long)lost > 0)) {
+      noOverruns++;
+      lostCycles += lost;
+#ifndef BrugTicklessKlok
+      driftMillis += lost*Clock::ClockCycle;
+#endif
+    }
+    measuring = started = true;
+    noCycles++;
+    cycleStart = micros();
+  }
+
+  void mark(byte a_part) {
+    uint32_t now = micros();
+    if (part < NoParts) {
+      unsigned int work = limited(now-partStart);
+      if (work > worstPart[part]) worstPart[part] = work;
+    }
+    part = a_part;
+    partStart = now;
+  }
+
+  void reset(void) {
+    for (byte cnt=0; cnt < NoBuckets; cnt++) histogram[cnt] = 0;
+    for (byte cnt=0; cnt < NoParts; cnt++) worstPart[cnt] = 0;
+    worstCycle = 0;
+    noCycles = noOverruns = lostCycles = driftMillis = 0;
+  }
+}
+#endif
+
+#ifdef BrugTimerhjul
+// Ansvar: Timerhjul er fælles tælleværk for alle urværker.
+// Timere ligger i en kæde per plads i hjulet, valgt efter klokcyklus hvor tiden udløber.
+// Ved hvert taktslag bliver kun timere på hjulets aktuelle plads berørt.
+// En timer som ikke er blevet aflæst i en hel periode, hviler indtil den bliver aflæst igen og starter så forfra.
+// Programmet skal sætte konstanten MaxNoTimers til antal urværker, inklusiv 1 til blinker og 1 til tilstandsmaskine.
+// NoSlots: Antal pladser i hjulet. Skal være en potens af 2
+// MaxPeriod: Længste periode i antal klokcyklus
+// t_Timer: Periode, klokcyklus for udløb, næste timer på samme plads og flag
+// timer: Alle timere. Et håndtag er index+1, så 0 betyder ingen timer
+// slotHead: Første timer på hver plads
+// now: Aktuel klokcyklus
+// overflow: Sat hvis der er oprettet flere urværker end MaxNoTimers
+// noTouched: Antal timere berørt i seneste klokcyklus
+// allocate(...): Opretter timer og leverer håndtag
+// start(...): Starter timer med periode i antal klokcyklus
+// take(...): Leverer sand én gang per udløb
+// advance(...): Drejer hjulet 1 klokcyklus frem
+namespace TimerWheel {
+  const byte NoSlots=16;
+  const unsigned int MaxPeriod=0xFFFF;
+  enum {FIRED=1, RUNNING=2};
+  struct t_Timer {
+    unsigned int period;
+    unsigned int due;
+    byte next;
+    byte flags;
+  };
+  t_Timer timer[MaxNoTimers];
+  byte slotHead[NoSlots];
+  byte noTimers=0;
+  unsigned int now=0;
+  bool overflow=false;
+  byte noTouched=0;
+
+  byte allocate(void) {
+    if (noTimers >= MaxNoTimers) {
+      overflow = true;
+      return 0;
+    }
+    noTimers++;
+    return noTimers;
+  }
+
+  void link(byte handle) {
+    t_Timer &item = timer[handle-1];
+    byte &head = slotHead[item.due & (NoSlots-1)];
+    item.next = head;
+    head = handle;
+  }
+
+  void unlink(byte handle) {
+    byte *p_link = &slotHead[timer[handle-1].due & (NoSlots-1)];
+    while (*p_link != 0) {
+      if (*p_link == handle) {
+        *p_link = timer[handle-1].next;
+        return;
+      }
+      p_link = &timer[*p_link-1].next;
+    }
+  }
+
+  void start(byte handle, unsigned long a_period) {
+    if (handle == 0) return;
+    t_Timer &item = timer[handle-1];
+    if ((item.flags & RUNNING) != 0) unlink(handle);
+    item.period = constrain(a_period, 1UL, (unsigned long)MaxPeriod);
+    item.due = now+item.period;
+    item.flags = RUNNING;
+    link(handle);
+  }
+
+  bool take(byte handle) {
+    if (handle == 0) return false;
+    t_Timer &item = timer[handle-1];
+    if ((item.flags & FIRED) != 0) {
+      item.flags &= ~FIRED;
+      return true;
+    }
+    if ((item.flags & RUNNING) == 0) start(handle, item.period);
+    return false;
+  }
+
+  void advance(void) {
+    byte handle;
+    byte *p_link = &slotHead[++now & (NoSlots-1)];
+    noTouched = 0;
+    while ((handle = *p_link) != 0) {
+      t_Timer &item = timer[handle-1];
+      noTouched++;
+      if (item.due != now) {
+        p_link = &item.next;
+        continue;
+      }
+      *p_link = item.next;
+      if ((item.flags & FIRED) != 0) item.flags = 0;   // Ikke aflæst i en hel periode. Timer hviler
+      else {
+        item.flags |= FIRED;
+        item.due = now+item.period;
+        link(handle);
+      }
+    }
+  }
+}
+#endif
+
 // Ansvar: Urværk leverer en tidsperiode.
 // Det er et tælleværk styret af polling
-// Varighed duration i msek omregnes til antal cyklus
+// Varighed duration i msek omregnes til antal cyklus. Varighed under en klokcyklus giver en klokcyklus, ellers udløb tiden aldrig
 // triggered(...): Leverer sand når tiden er udløbet
+// Med tickless klok er urværket tidsstyret. due: Klokcyklus hvor tiden udløber. Urværket melder due til klokken
+// Er urværket ikke brugt i en hel periode, starter det forfra som ved polling
+// Med timerhjul er urværket et håndtag til en timer i hjulet. handle: Håndtag
+// Med kompakt tæller urværket med 16 bit ved polling. MaxCycles: Længste varighed i klokcyklusser, 327 sek.
+// Med tickless klok bruges 32 bit, da due følger Clock::cycleNo
 class t_ClockWork {
 private:
+#if defined(BrugTimerhjul)
+  byte handle;
+#elif defined(BrugTicklessKlok)
+  unsigned long noCycles;
+  unsigned long due;
+#elif !defined(BrugKompakt)
   unsigned long noCycles;
   unsigned long cycle;
+#else
+  static const unsigned int MaxCycles=0xFFFF;
+  unsigned int noCycles;
+  unsigned int cycle;
+#endif
 public:
   t_ClockWork(void);
   t_ClockWork(unsigned long a_duration);
@@ -63,15 +411,41 @@ public:
   bool triggered(void);    
 };
 
+#if defined(BrugTimerhjul)
+t_ClockWork::t_ClockWork(): handle(TimerWheel::allocate()) {
+  TimerWheel::start(handle, 1);
+};
+
+t_ClockWork::t_ClockWork(unsigned long a_duration): handle(TimerWheel::allocate()) {
+  setDuration(a_duration, false);
+}
+#else
+#ifndef BrugTicklessKlok
 t_ClockWork::t_ClockWork(): noCycles(1), cycle(1){};
+#else
+t_ClockWork::t_ClockWork(): noCycles(1), due(Clock::cycleNo+1){};
+#endif
 
 t_ClockWork::t_ClockWork(unsigned long a_duration) {
   setDuration(a_duration, false);
 }
+#endif
 
+#if defined(BrugTimerhjul)
 void t_ClockWork::setDuration(unsigned long a_duration, bool inSeconds = false) {
   a_duration=a_duration*((inSeconds==true)?1000:1);
-  noCycles=cycle=a_duration/Clock::ClockCycle;
+  TimerWheel::start(handle, a_duration/Clock::ClockCycle);
+}
+
+bool t_ClockWork::triggered(void) {return TimerWheel::take(handle);}
+#elif !defined(BrugTicklessKlok)
+void t_ClockWork::setDuration(unsigned long a_duration, bool inSeconds = false) {
+  a_duration=a_duration*((inSeconds==true)?1000:1);
+#ifndef BrugKompakt
+  noCycles=cycle=(a_duration >= Clock::ClockCycle)?a_duration/Clock::ClockCycle:1;
+#else
+  noCycles=cycle=constrain(a_duration/Clock::ClockCycle, 1UL, (unsigned long)MaxCycles);
+#endif
 }
 
 bool t_ClockWork::triggered(void) {
@@ -79,17 +453,103 @@ bool t_ClockWork::triggered(void) {
   if (cycle == 0) cycle = noCycles;
   return (cycle == noCycles);
 }
+#else
+void t_ClockWork::setDuration(unsigned long a_duration, bool inSeconds = false) {
+  a_duration=a_duration*((inSeconds==true)?1000:1);
+  noCycles=(a_duration >= Clock::ClockCycle)?a_duration/Clock::ClockCycle:1;
+  due=Clock::cycleNo+noCycles;
+  Clock::reportDue(due);
+}
+
+bool t_ClockWork::triggered(void) {
+  unsigned long late = Clock::cycleNo-due;
+  bool isDue = ((long)late >= 0);
+  if (isDue == true) {
+    isDue = (late < noCycles);   // Urværk som ikke er blevet brugt, starter forfra
+    due = Clock::cycleNo+noCycles;
+  }
+  Clock::reportDue(due);
+  return isDue;
+}
+#endif
+
+#if defined(BrugKompakt) && !defined(BrugTimerhjul) && !defined(BrugTicklessKlok)
+static_assert(sizeof(t_ClockWork) == 2*sizeof(unsigned int), "Kompakt urværk skal tælle med 16 bit");
+#endif
 
 //----------
 
+#ifdef BrugOscillatorbank
+// Ansvar: Oscillatorbank leverer blinkniveauer i fase til alle ydre enheder.
+// Hver oscillator er en faseakkumulator i msek, som tælles frem hver klokcyklus og løber rundt ved sin periode.
+// Niveauet er højt i første halvdel af perioden. Alle niveauer udgives i én bitmaske, så enheder på samme oscillator
+// altid viser samme niveau, også når de er startet på forskellige tidspunkter.
+// Med tickless klok tælles faserne frem med antal klokcyklusser siden sidst, og klokken vækkes til næste skift.
+// ROADLIGHT, WHITELAMP, BELL: Oscillatorer til vejlys, hvid lanterne og vejklokke
+// Period: Periode i msek for hver oscillator. Vejlys og hvid lanterne har samme takt som Blinker
+// phase: Faseakkumulator i msek for hver oscillator
+// levels: Bit per oscillator, som er sat i første halvdel af perioden
+// toggled: Bit per oscillator, som skiftede niveau i seneste klokcyklus
+// lastCycle: Klokcyklus ved seneste opdatering med tickless klok
+// doClockCycle(...): Tæller faserne frem. Kaldes af Blinker::doClockCycle()
+// level(...): Leverer en oscillators niveau
+// hasToggled(...): Svarer på om en oscillator skiftede niveau i seneste klokcyklus
+namespace Oscillator {
+  enum {ROADLIGHT, WHITELAMP, BELL, NoOscillators};
+  constexpr unsigned int Period[NoOscillators]={2000, 2000, 500};
+  unsigned int phase[NoOscillators];
+  byte levels=0;
+  byte toggled=0;
+#ifdef BrugTicklessKlok
+  unsigned long lastCycle=0;
+#endif
+
+  void doClockCycle(void) {
+    byte newLevels = 0;
+#ifndef BrugTicklessKlok
+    const unsigned int elapsed = Clock::ClockCycle;
+#else
+    unsigned long elapsed = (Clock::cycleNo-lastCycle)*Clock::ClockCycle;
+    lastCycle = Clock::cycleNo;
+#endif
+    for (byte osc=0; osc < NoOscillators; osc++) {
+      unsigned int half = Period[osc]/2;
+#ifndef BrugTicklessKlok
+      phase[osc] += elapsed;
+      if (phase[osc] >= Period[osc]) phase[osc] -= Period[osc];
+#else
+      phase[osc] = (phase[osc]+elapsed) % Period[osc];
+      unsigned int toEdge = ((phase[osc] < half)?half:Period[osc])-phase[osc];
+      Clock::reportDue(Clock::cycleNo+(toEdge+Clock::ClockCycle-1)/Clock::ClockCycle);
+#endif
+      if (phase[osc] < half) newLevels |= (1 << osc);
+    }
+    toggled = levels ^ newLevels;
+    levels = newLevels;
+  }
+
+  bool level(byte osc) {return (levels & (1 << osc)) != 0;}
+  bool hasToggled(byte osc) {return (toggled & (1 << osc)) != 0;}
+}
+#endif
+
 // Ansvar: Blinker leverer tidsperiode til blink.
 // Period: Sat til msek
 // triggered(...): Leverer sand når tiden er udløbet
+// Med oscillatorbank bliver Oscillator talt frem, og blinker udløser når vejlys skifter niveau
 namespace Blinker {
   const unsigned int Period=1000;
   bool triggered;
+#ifndef BrugOscillatorbank
   t_ClockWork ClockWork(Period);
   void doClockCycle(void) {triggered = ClockWork.triggered();}
+#else
+  static_assert(Oscillator::Period[Oscillator::ROADLIGHT] == 2*Period, "Vejlys skal skifte niveau med Blinker::Period");
+  void doClockCycle(void) {
+    Oscillator::doClockCycle();
+    triggered = Oscillator::hasToggled(Oscillator::ROADLIGHT);
+  }
+#endif
   bool toSubscriber(void) {return triggered;}
 }
 
@@ -0,0 +1,159 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Overkørsel sporing af hændelser
+ * Version: 1.1
+ * Type: Bibliotek
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel kerne komponenter.
+ *
+ * "Overkørsel sporing" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel sporing" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel sporing".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Version 1.1: Registrerer læste indgange og meldinger fra sikringsanlæg, så et forløb kan afspilles. drain(...) sender i bidder
+ * Indholdet bliver kun oversat, når BrugSporing er defineret. ovk_spor afkoder en udskrift på Linux.
+ */
+
+#include <Arduino.h>
+#include "OvkTiming.h"
+
+#ifndef OvkTrace_h
+#define OvkTrace_h
+
+#ifdef BrugSporing
+// Ansvar: Sporer hændelser i en ringbuffer med klokcyklus, så forløbet op til en fejl kan læses bagefter.
+// En hændelse er 2 byte: Type og antal klokcyklusser siden forrige hændelse i første byte, data i anden byte.
+// Er der LongDelta klokcyklusser eller flere siden forrige hændelse, følger antallet efter første byte med 7 bit per byte.
+// Er bufferen fuld, bliver de ældste hændelser overskrevet.
+// Size: Bufferens størrelse i byte. Index er en byte, så bufferen løber selv rundt
+// STATE: Ny tilstand. BUTTON: Trykknap ben i bit 0-6 og niveau i bit 7
+// FLIPFLOP: Flipflop nummer i bit 0-6 og bistabil værdi i bit 7. DEVICE: Ydre enhed i bit 0-6 og status i bit 7
+// RAW: Trykknap ben i bit 0-6 og læst niveau før kontaktprel i bit 7. Nok til at afspille indgange nøjagtigt
+// LINK: Betjeningsenhed i bit 0-6 og værdi sat af sikringsanlæg i bit 7
+// Magic, Version, HeaderSize: Hoved på en udskrift: "OT", version, ClockCycle, tailCycle med 4 byte og used med 2 byte
+// buffer, head, tail, used: Ringbuffer. tail peger på ældste hændelse
+// tailCycle: Klokcyklus for ældste hændelse. Dens eget antal klokcyklusser bliver ikke brugt
+// cycle, lastCycle: Aktuel klokcyklus og klokcyklus for seneste hændelse
+// noEvents, noDropped: Antal hændelser i alt og antal overskrevne
+// noFlipFlops: Tæller flipflops, så hver får et nummer i rækkefølge efter oprettelse
+// nextCycle(...): Kaldes ved start af klokcyklus. Med tickless klok følges Clock::cycleNo
+// delta(...), length(...): Antal klokcyklusser og antal byte for hændelsen ved et index
+// dropOldest(...): Fjerner ældste hændelse
+// record(...): Registrerer en hændelse
+// dump(...): Sender hoved og hændelser byte for byte til put(...), for eksempel Serial.write
+// clear(...): Tømmer bufferen
+// drain(...): Sender hændelser og tømmer bufferen, så en lang optagelse kan sendes i bidder uden at miste hændelser
+namespace Trace {
+  const unsigned int Size=256;
+  enum {STATE, BUTTON, FLIPFLOP, DEVICE, RAW, LINK};
+  const byte LongDelta=31;
+  const byte Magic[2]={'O', 'T'};
+  const byte Version=1;
+  const byte HeaderSize=10;
+  byte buffer[Size];
+  byte head=0;
+  byte tail=0;
+  unsigned int used=0;
+  unsigned long tailCycle=0;
+  unsigned long cycle=0;
+  unsigned long lastCycle=0;
+  unsigned long noEvents=0;
+  unsigned long noDropped=0;
+  byte noFlipFlops=0;
+  static_assert(Size == 256, "Sporingens index er en byte");
+
+  void nextCycle(void) {
+#ifndef BrugTicklessKlok
+    cycle++;
+#else
+    cycle = Clock::cycleNo;
+#endif
+  }
+
+  unsigned long delta(byte index) {
+    unsigned long result = buffer[index] & LongDelta;
+    if (result < LongDelta) return result;
+    result = 0;
+    byte shift = 0;
+    do {
+      index++;
+      result |= (unsigned long)(buffer[index] & 0x7F) << shift;
+      shift += 7;
+    } while ((buffer[index] & 0x80) != 0);
+    return result;
+  }
+
+  byte length(byte index) {
+    byte result = 2;
+    if ((buffer[index] & LongDelta) == LongDelta) {
+      do result++;
+      while ((buffer[++index] & 0x80) != 0);
+    }
+    return result;
+  }
+
+  void dropOldest(void) {
+    byte noBytes = length(tail);
+    tail += noBytes;
+    used -= noBytes;
+    noDropped++;
+    if (used > 0) tailCycle += delta(tail);
+  }
+
+  void record(byte type, byte data) {
+    unsigned long gap = cycle-lastCycle;
+    byte need = 2;
+    if (gap >= LongDelta) for (unsigned long rest = gap; rest != 0; rest >>= 7) need++;
+    while (Size-used < need) dropOldest();
+    if (used == 0) tailCycle = cycle;
+    if (gap < LongDelta) buffer[head++] = (type << 5) | gap;
+    else {
+      buffer[head++] = (type << 5) | LongDelta;
+      do {
+        buffer[head++] = (gap & 0x7F) | ((gap > 0x7F)?0x80:0);
+        gap >>= 7;
+      } while (gap != 0);
+    }
+    buffer[head++] = data;
+    used += need;
+    lastCycle = cycle;
+    noEvents++;
+  }
+
+  void dump(void (*put)(byte)) {
+    byte check = 0;
+    byte header[HeaderSize] = {Magic[0], Magic[1], Version, Clock::ClockCycle,
+      (byte)tailCycle, (byte)(tailCycle >> 8), (byte)(tailCycle >> 16), (byte)(tailCycle >> 24), (byte)used, (byte)(used >> 8)};
+    for (byte cnt=0; cnt < HeaderSize; cnt++) put(header[cnt]);
+    for (unsigned int cnt=0; cnt < used; cnt++) {
+      byte value = buffer[(byte)(tail+cnt)];
+      check += value;
+      put(value);
+    }
+    put(check);
+  }
+
+  void clear(void) {head = tail = 0; used = 0;}
+
+  void drain(void (*put)(byte)) {
+    if (used == 0) return;
+    dump(put);
+    clear();
+  }
+}
+#endif
+
+#endif
@@ -0,0 +1,325 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Overkørsel portudvidelse med skifteregistre og I2C
+ * Version: 1.1
+ * Type: Bibliotek
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel kerne komponenter.
+ *
+ * "Overkørsel portudvidelse" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel portudvidelse" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel portudvidelse".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Inkluderes af OvkHWDrivere.h, når BrugPortudvidelse er defineret. Giver input og output drivere på en kæde af
+ * 74HC595 og 74HC165 på SPI bussen og på MCP23017 på I2C bussen.
+ * Skifteregistre bruger ben 11, 12 og 13 til SPI samt et latch ben og et load ben. MCP23017 bruger A4 og A5.
+ * Version 1.1: Kun tilknyttede udgange sættes som udgange på MCP23017. Wire får timeout, når biblioteket har WIRE_HAS_TIMEOUT
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <Wire.h>
+#include "OvkTiming.h"
+
+#ifndef OvkUdvidelse_h
+#define OvkUdvidelse_h
+
+// Ansvar: Spejler udgange og indgange på portudvidelser og overfører dem samlet én gang per klokcyklus.
+// Drivere skriver og læser kun spejlet. flush(...) skriver ændrede udgange og læser indgange ved afslutning af klokcyklus.
+// Kæden af skifteregistre klares i én SPI transaktion: load af 74HC165, én byte per skifteregister og latch af 74HC595.
+// Latch sker kun når en udgang er ændret, og uden indgange springes transaktionen over, når intet er ændret.
+// Hver MCP23017 får én I2C transaktion til udgange, når en udgang er ændret, og én til indgange med gentaget start.
+// Indgange læses ved afslutning af klokcyklus og bruges i næste, så de er op til 1 klokcyklus forsinkede.
+// MaxNoMcps: Antal MCP23017 der kan tilknyttes
+// MaxNoChainBytes: Længste kæde af 74HC595 og af 74HC165
+// Chain: Index til kæden af skifteregistre. MCP23017 har index 0 til MaxNoMcps-1
+// NoSource, NoPin: Portudvidelse eller ben kan ikke tilknyttes
+// SpiClock, I2cClock: Busfrekvenser i Hz
+// I2cTimeout: Længste tid i µsek Wire venter på I2C bussen. En hængt bus nulstilles og tælles i noBusErrors
+// IODIRA, GPPUA, GPIOA, OLATA: Registre i MCP23017 for port A med IOCON.BANK=0. Port B har næste adresse
+// t_Source: out: Udgange. in: Seneste læste indgange. outMask, inMask: Ben der er udgange og indgange. pullUp: Indgange med pull-up i MCP23017
+//   Kun ben i outMask bliver udgange på MCP23017. Ben der ikke er tilknyttet forbliver indgange som efter reset
+//   noOut, noIn: Antal bytes med udgange og med indgange. dirty: En udgang er ændret siden seneste flush
+//   isReady: MCP23017 har fået retning og pull-up
+// sources: Kæden og MCP23017. address: I2C adresse for hver MCP23017
+// latchPin, loadPin: Ben til 74HC595 latch og 74HC165 load. isChainBegun: begin(...) er kaldt
+// noTransactions, noBytes: Bustransaktioner og bytes siden start, inklusiv I2C adressebytes
+// noSkipped: Skrivninger til udgange der blev sprunget over, fordi intet var ændret
+// noBusErrors: MCP23017 svarede ikke. Overførslen gentages i næste klokcyklus
+// attachMcp(...): Tilknytter en MCP23017 og leverer index
+// attachOut(...), attachIn(...): Tilknytter et ben som udgang eller indgang
+// set(...), read(...): Skriver og læser spejlet
+// begin(...): Sætter latch og load ben til kæden og starter SPI. Kaldes i setup(), når kæden bruges
+// flushChain(...), flushMcp(...): Overfører kæden og en MCP23017
+// flush(...): Overfører alle portudvidelser. Kaldes én gang per klokcyklus efter ydre enheder
+// Med tickless klok holdes klokken vågen, når der er indgange, da de skal polles
+namespace Expander {
+  const byte MaxNoMcps=2;
+  const byte MaxNoChainBytes=4;
+  const byte Chain=MaxNoMcps;
+  const byte NoSource=0xFF;
+  const byte NoPin=0xFF;
+  const unsigned long SpiClock=4000000;
+  const unsigned long I2cClock=400000;
+  const unsigned long I2cTimeout=1000;
+  enum {IODIRA=0x00, GPPUA=0x0C, GPIOA=0x12, OLATA=0x14};
+  struct t_Source {
+    byte out[MaxNoChainBytes];
+    byte in[MaxNoChainBytes];
+    byte outMask[MaxNoChainBytes];
+    byte inMask[MaxNoChainBytes];
+    byte pullUp[MaxNoChainBytes];
+    byte noOut;
+    byte noIn;
+    bool dirty;
+    bool isReady;
+  };
+  t_Source sources[MaxNoMcps+1];
+  byte address[MaxNoMcps];
+  byte noMcps=0;
+  byte latchPin=NoPin;
+  byte loadPin=NoPin;
+  bool isChainBegun=false;
+  bool isWireBegun=false;
+  unsigned long noTransactions=0;
+  unsigned long noBytes=0;
+  unsigned long noSkipped=0;
+  unsigned long noBusErrors=0;
+
+  byte attachMcp(byte a_address) {
+    for (byte index=0; index < noMcps; index++) if (address[index] == a_address) return index;
+    if (noMcps >= MaxNoMcps) return NoSource;
+    address[noMcps] = a_address;
+    return noMcps++;
+  }
+
+  byte maxBytes(byte source) {return (source == Chain)?MaxNoChainBytes:2;}
+
+  bool attachOut(byte source, byte bit, bool value) {
+    if ((source > Chain) || (bit/8 >= maxBytes(source))) return false;
+    t_Source &item = sources[source];
+    item.outMask[bit/8] |= (1 << (bit%8));
+    if (value == HIGH) item.out[bit/8] |= (1 << (bit%8));
+    else item.out[bit/8] &= ~(1 << (bit%8));
+    if (bit/8 >= item.noOut) item.noOut = bit/8+1;
+    item.dirty = true;
+    item.isReady = false;
+    return true;
+  }
+
+  bool attachIn(byte source, byte bit, bool pullUp) {
+    if ((source > Chain) || (bit/8 >= maxBytes(source))) return false;
+    t_Source &item = sources[source];
+    item.inMask[bit/8] |= (1 << (bit%8));
+    if (pullUp == true) {
+      item.pullUp[bit/8] |= (1 << (bit%8));
+      item.in[bit/8] |= (1 << (bit%8));
+    }
+    if (bit/8 >= item.noIn) item.noIn = bit/8+1;
+    item.isReady = false;
+    return true;
+  }
+
+  void set(byte source, byte bit, bool value) {
+    t_Source &item = sources[source];
+    byte mask = 1 << (bit%8);
+    if (((item.out[bit/8] & mask) != 0) == value) return;
+    item.out[bit/8] ^= mask;
+    item.dirty = true;
+  }
+
+  bool read(byte source, byte bit) {return (sources[source].in[bit/8] & (1 << (bit%8))) != 0;}
+
+  void begin(byte a_latchPin, byte a_loadPin) {
+    latchPin = a_latchPin;
+    loadPin = a_loadPin;
+    digitalWrite(latchPin, LOW);
+    pinMode(latchPin, OUTPUT);
+    if (loadPin != NoPin) {
+      digitalWrite(loadPin, HIGH);
+      pinMode(loadPin, OUTPUT);
+    }
+    SPI.begin();
+    isChainBegun = true;
+  }
+
+  void flushChain(void) {
+    t_Source &item = sources[Chain];
+    if ((isChainBegun == false) || ((item.noOut == 0) && (item.noIn == 0))) return;
+    if (item.dirty == false) {
+      noSkipped++;
+      if ((item.noIn == 0) || (loadPin == NoPin)) return;
+    }
+    // Første byte havner i den fjerneste 74HC595. Første byte ind kommer fra den nærmeste 74HC165
+    byte noTransfers = (item.noOut > item.noIn)?item.noOut:item.noIn;
+    SPI.beginTransaction(SPISettings(SpiClock, MSBFIRST, SPI_MODE0));
+    if ((item.noIn > 0) && (loadPin != NoPin)) {
+      digitalWrite(loadPin, LOW);
+      digitalWrite(loadPin, HIGH);
+    }
+    for (byte cnt=0; cnt < noTransfers; cnt++) {
+      byte pos = noTransfers-1-cnt;
+      byte data = SPI.transfer((pos < item.noOut)?item.out[pos]:0);
+      if (cnt < item.noIn) item.in[cnt] = data;
+    }
+    if (item.dirty == true) {
+      digitalWrite(latchPin, HIGH);
+      digitalWrite(latchPin, LOW);
+      item.dirty = false;
+    }
+    SPI.endTransaction();
+    noTransactions++;
+    noBytes += noTransfers;
+  }
+
+  bool writeMcp(byte index, byte reg, const byte *data, byte noData) {
+    Wire.beginTransmission(address[index]);
+    Wire.write(reg);
+    for (byte cnt=0; cnt < noData; cnt++) Wire.write(data[cnt]);
+    noTransactions++;
+    noBytes += 2+noData;
+    if (Wire.endTransmission() == 0) return true;
+    noBusErrors++;
+    return false;
+  }
+
+  void flushMcp(byte index) {
+    t_Source &item = sources[index];
+    if (isWireBegun == false) {
+      Wire.begin();
+      Wire.setClock(I2cClock);
+#ifdef WIRE_HAS_TIMEOUT
+      Wire.setWireTimeout(I2cTimeout, true);
+#endif
+      isWireBegun = true;
+    }
+    // Udgange skrives før retning, så de ikke blinker ved start
+    if (item.isReady == false) {
+      byte direction[2] = {(byte)~item.outMask[0], (byte)~item.outMask[1]};
+      item.isReady = writeMcp(index, OLATA, item.out, 2) && writeMcp(index, GPPUA, item.pullUp, 2) && writeMcp(index, IODIRA, direction, 2);
+      item.dirty = (item.isReady == false);
+      if (item.isReady == false) return;
+    }
+    else if ((item.dirty == true) && (item.noOut > 0)) item.dirty = (writeMcp(index, OLATA, item.out, item.noOut) == false);
+    else if (item.noOut > 0) noSkipped++;
+    if (item.noIn > 0) {
+      byte first = (item.inMask[0] != 0)?0:1;
+      byte noRead = item.noIn-first;
+      Wire.beginTransmission(address[index]);
+      Wire.write(GPIOA+first);
+      bool isOk = (Wire.endTransmission(false) == 0) && (Wire.requestFrom(address[index], noRead) == noRead);
+      for (byte pos=first; pos < item.noIn; pos++) if (Wire.available() > 0) item.in[pos] = Wire.read();
+      noTransactions++;
+      noBytes += 3+noRead;
+      if (isOk == false) noBusErrors++;
+    }
+  }
+
+  void flush(void) {
+    flushChain();
+    for (byte index=0; index < noMcps; index++) flushMcp(index);
+#ifdef BrugTicklessKlok
+    for (byte index=0; index <= Chain; index++) if (sources[index].noIn > 0) Clock::stayAwake();
+#endif
+  }
+}
+
+// Ansvar: Output driver til et ben på en portudvidelse. Software er et spejl af hardwarefunktion.
+// source: Portudvidelse i Expander
+// bit: Ben på portudvidelsen
+// sendOut(...): Sender værdi til spejlet. Den skrives ved afslutning af klokcyklus
+// t_ShiftOut: Ben på kæden af 74HC595. Ben 0-7 er nærmeste 74HC595, ben 8-15 den næste osv.
+// t_McpOut: Ben på en MCP23017. GPA0-7 er ben 0-7 og GPB0-7 er ben 8-15
+class t_ExpanderOut: public t_DigitalOutDrv {
+private:
+  byte source;
+  byte bit;
+  void sendOut(void) {if (source != Expander::NoSource) Expander::set(source, bit, value);}
+public:
+  t_ExpanderOut(byte a_source, byte a_bit, bool a_value);
+};
+
+t_ExpanderOut::t_ExpanderOut(byte a_source, byte a_bit, bool a_value) : t_DigitalOutDrv(a_value), source(a_source), bit(a_bit) {
+  if (Expander::attachOut(source, bit, a_value) == false) source = Expander::NoSource;
+}
+
+class t_ShiftOut: public t_ExpanderOut {
+public:
+  t_ShiftOut(byte a_bit, bool a_value=LOW) : t_ExpanderOut(Expander::Chain, a_bit, a_value) {}
+};
+
+class t_McpOut: public t_ExpanderOut {
+public:
+  t_McpOut(byte a_address, byte a_pin, bool a_value=LOW) : t_ExpanderOut(Expander::attachMcp(a_address), a_pin, a_value) {}
+};
+
+// Ansvar: Input driver til et ben på en portudvidelse. Filtrering af kontaktprel som trykknap. Grænseflade til software.
+// Seqs: Som trykknap løber benet igennem 2 trin ved en ændring
+// source: Portudvidelse i Expander
+// bit: Ben på portudvidelsen
+// bounceTimer: Timer til kontaktprel
+// seq: Benets trin
+// doClockCycle(...): Gennemløb på tid med seneste læste niveau fra spejlet
+// Kontakttype NCLOSED giver pull-up. På 74HC165 skal pull-up sidde på printet
+// t_ShiftIn: Ben på kæden af 74HC165. Ben 0-7 er nærmeste 74HC165, ben 8-15 den næste osv.
+// t_McpIn: Ben på en MCP23017. GPA0-7 er ben 0-7 og GPB0-7 er ben 8-15
+class t_ExpanderIn: public t_DigitalInDrv {
+private:
+  enum {STABLE, BOUNCE};
+  enum {BOUNCTIME = 30};
+  byte source;
+  byte bit;
+  t_ClockWork bounceWait;
+  byte seq;
+public:
+  t_ExpanderIn(byte a_source, byte a_bit, byte a_contact);
+  void doClockCycle(void);
+};
+
+t_ExpanderIn::t_ExpanderIn(byte a_source, byte a_bit, byte a_contact) : t_DigitalInDrv(), source(a_source), bit(a_bit), bounceWait(BOUNCTIME), seq(STABLE) {
+  if (Expander::attachIn(source, bit, a_contact == NCLOSED) == false) source = Expander::NoSource;
+  value = (source != Expander::NoSource)?Expander::read(source, bit):(a_contact == NCLOSED);
+}
+
+void t_ExpanderIn::doClockCycle(void) {
+  if (source == Expander::NoSource) return;
+  switch (seq) {
+    case STABLE:
+      if (value != Expander::read(source, bit)) {
+        bounceWait.setDuration(BOUNCTIME);
+        seq = BOUNCE;
+      }
+    break;
+    case BOUNCE:
+      if (bounceWait.triggered() == true) {
+        value = Expander::read(source, bit);
+        seq = STABLE;
+      }
+    break;
+  }
+}
+
+class t_ShiftIn: public t_ExpanderIn {
+public:
+  t_ShiftIn(byte a_bit, byte a_contact) : t_ExpanderIn(Expander::Chain, a_bit, a_contact) {}
+};
+
+class t_McpIn: public t_ExpanderIn {
+public:
+  t_McpIn(byte a_address, byte a_pin, byte a_contact) : t_ExpanderIn(Expander::attachMcp(a_address), a_pin, a_contact) {}
+};
+
+#endif
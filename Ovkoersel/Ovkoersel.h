@@ -1,10 +1,10 @@
 /*
  * Projekt: Overkørsel st. enkeltsporet strækning
  * Produkt: Overkørsel kerne komponenter
- * Version: 1.0
+ * Version: 1.19
  * Type: Bibliotek
  * Programmeret af: Jan Birch
- * Opdateret: 13-05-2021
+ * Opdateret: 17-10-2026
  * GNU General Public License version 3
  * This file is part of Overkørsel kerne komponenter.
  * 
@@ -23,6 +23,25 @@
  * 
  * Noter:
  * Se koncept og specifikation for en detaljeret beskrivelse af programmet, formål og anvendelse.
+ * Version 1.1: Transition holder tickless klok vågen til ny tilstand
+ * Version 1.2: Hændelsesstyret afvikling, som vælges med BrugHaendelsesstyring. Tæller kald per klokcyklus
+ * Version 1.3: Portbuffer bliver skrevet ved afslutning af klokcyklus
+ * Version 1.4: Portfilter bliver læst ved start af klokcyklus
+ * Version 1.5: Statisk sammensat overkørsel, som vælges med BrugStatiskOverkoersel
+ * Version 1.6: Tilstandsmaskine beskrevet i tabeller, som vælges med BrugTilstandstabel
+ * Version 1.7: Anlæg med mange overkørsler i OvkAnlaeg.h, som vælges med BrugAnlaeg
+ * Version 1.8: Flere overkørsler i samme program, som vælges med BrugFlereOverkoersler
+ * Version 1.9: Seriel forbindelse til sikringsanlæg i OvkSerial.h, som vælges med BrugSeriel
+ * Version 1.10: Klokmåling per del af klokcyklus ved BrugKlokmaaling
+ * Version 1.11: Sporing af hændelser i OvkTrace.h, som vælges med BrugSporing
+ * Version 1.12: Kompakt RAM forbrug i alle komponenter, som vælges med BrugKompakt
+ * Version 1.13: Enheder kan beskrives i tabeller i flash i OvkKonfig.h, som vælges med BrugKonfiguration
+ * Version 1.14: Kantfangst bliver tømt ved start af klokcyklus
+ * Version 1.15: Overkørsel leverer aktuel tilstand
+ * Version 1.16: Lysdæmper tæller lampernes forløb frem ved afslutning af klokcyklus
+ * Version 1.17: Portudvidelser overføres samlet ved afslutning af klokcyklus ved BrugPortudvidelse
+ * Version 1.18: Alle forespørgsler over seriel forbindelse besvares i samme klokcyklus
+ * Version 1.19: Tid i tilstandstabel tælles hver klokcyklus, også når betingelserne ikke er opfyldt
  */
 
 #include <Arduino.h>
@@ -30,29 +49,212 @@
 #include "OvkHWDrivere.h"
 #include "OvkCtrl.h"
 #include "OvkDevice.h"
+#ifdef BrugSeriel
+#include "OvkSerial.h"
+#endif
 
 #ifndef OvkCrossing_h
 #define OvkCrossing_h
 
+#ifdef BrugHaendelsesstyring
+// Ansvar: Urværk til tilstandsmaskine, som husker om tilstanden har startet tid.
+// armed: Tid er startet i aktuel tilstand
+// setDuration(...): Starter tid
+// disarm(...): Glemmer tid ved transition
+class t_StateClockWork: public t_ClockWork {
+private:
+  bool armed;
+public:
+  t_StateClockWork(void): t_ClockWork(), armed(false) {}
+  void setDuration(unsigned long a_duration, bool inSeconds = false) {armed = true; t_ClockWork::setDuration(a_duration, inSeconds);}
+  void disarm(void) {armed = false;}
+  bool isArmed(void) const {return armed;}
+};
+#endif
+
 // Ansvar: Er grænseflade til tilstandsmaskine.
 // clockwork: Bruges af tilstand, med tidsstyret overgang til næste tilstand.
+// Ved hændelsesstyring husker clockWork om tid er startet, så doCondition(...) kun kaldes ved behov.
 // onEntry(...): I den konkrete tilstand indbygges opdatering af overkørslens enheder. Tilstand initialiseres.
 // doCondition(...): Svarer på om betingelser for overgang til næste tilstand er opfyldt.
 // onExit(...): I den konkrete tilstand indbygges opdatering af overkørslens enheder. Metoden kaldes ved afslutning af en tilstand.
+// Med flere overkørsler har hver tilstand sit eget urværk, og crossing er et link til den overkørsel, som tilstanden er sat i.
+// Tilstande skrevet til den globale crossing virker dermed uændret i hver overkørsel.
+// attach(...): Kobler tilstand til overkørsel. Kaldes af setState(...)
+#ifdef BrugFlereOverkoersler
+#if defined(BrugTilstandstabel) || defined(BrugStatiskOverkoersel) || defined(BrugTicklessKlok) || defined(BrugTimerhjul) || defined(BrugSeriel) || defined(BrugSporing)
+#error "Flere overkørsler kan kun bruges med polling og hændelsesstyring uden seriel forbindelse og sporing"
+#endif
+struct t_Crossing;
+
+// Ansvar: Link fra en tilstand til dens overkørsel med samme services som t_Crossing.
+// p_crossing: Pointer til overkørsel
+// attach(...): Kobler link til overkørsel
+// status(...), reset(...), to(...): Sendes videre til overkørslen
+class t_CrossingLink {
+private:
+  t_Crossing *p_crossing;
+public:
+  t_CrossingLink(void): p_crossing(nullptr) {}
+  void attach(t_Crossing *a_crossing) {p_crossing = a_crossing;}
+  byte status(byte ctrlName);
+  void reset(byte ctrlName);
+  void to(byte deviceName, byte deviceState);
+};
+#endif
+
 class t_StateMachine {
+#ifdef BrugTilstandstabel
+  friend struct t_Crossing;
+#endif
 protected:
+#ifndef BrugFlereOverkoersler
+#ifndef BrugHaendelsesstyring
   static t_ClockWork clockWork;
+#else
+  static t_StateClockWork clockWork;
+#endif
+#else
+#ifndef BrugHaendelsesstyring
+  t_ClockWork clockWork;
+#else
+  t_StateClockWork clockWork;
+#endif
+  t_CrossingLink crossing;
+#endif
 public:
   t_StateMachine(void) {}
   virtual void onEntry(void) {}
   virtual byte doCondition(byte currentStateNo) = 0;
   virtual void onExit(void) {}  
+#ifndef BrugFlereOverkoersler
+#ifdef BrugHaendelsesstyring
+  static bool isTimed(void) {return clockWork.isArmed();}
+  static void endTime(void) {clockWork.disarm();}
+#endif
+#else
+  void attach(t_Crossing *a_crossing) {crossing.attach(a_crossing);}
+#ifdef BrugHaendelsesstyring
+  bool isTimed(void) const {return clockWork.isArmed();}
+  void endTime(void) {clockWork.disarm();}
+#endif
+#endif
 };
 
+#ifndef BrugFlereOverkoersler
+#ifndef BrugHaendelsesstyring
 t_ClockWork t_StateMachine::clockWork;
+#else
+t_StateClockWork t_StateMachine::clockWork;
+#endif
+#endif
+
+//----------
+
+#ifdef BrugTilstandstabel
+#ifdef BrugStatiskOverkoersel
+#error "Tilstandstabel kan ikke bruges sammen med statisk overkørsel"
+#endif
+// Ansvar: Beskriver tilstandsmaskinen som tabeller i flash i stedet for klasser af t_StateMachine.
+// Overgange og handlinger skrives som constexpr tabeller med PROGMEM og sorteres efter tilstand.
+// t_Transition: Overgang fra tilstand from til tilstand to, når alle betjeningsenheder i onMask er ON,
+// alle i offMask er OFF, og tid er udløbet, hvis timer er sat. Første opfyldte overgang vælges.
+// Har en tilstand en overgang med timer, tælles tiden hver klokcyklus som i en klasse med clockWork.triggered(),
+// også når betingelserne ikke er opfyldt
+// t_Action: Handling i tilstand state ved ENTRY eller EXIT. TO sætter ydre enhed name til value. RESET resetter
+// betjeningsenhed name. MSEC og SECONDS starter tilstandens tid på value
+// ctrl(...): Leverer maske for en betjeningsenhed til onMask og offMask
+// isSorted(...): Svarer på om en tabel er sorteret efter tilstand
+// reachable(...): Leverer maske over tilstande, som kan nås fra start
+// deadEnds(...): Leverer maske over tilstande uden overgang til en anden tilstand
+// makeIndex(...): Finder index til første række for hver tilstand i en sorteret tabel i flash
+// markTimed(...): Sætter en bit per tilstand med en overgang med timer fra en tabel i flash
+// isTimed(...): Svarer på om en tilstands bit er sat
+// Tabellerne tjekkes med static_assert, så fejl i tilstandsmaskinen findes ved oversættelse. Se Simulator/RefOverkoerselTabel.h
+namespace StateTable {
+  enum {ENTRY, EXIT};
+  enum {TO, RESET, MSEC, SECONDS};
+  struct t_Transition {
+    byte from;
+    unsigned int onMask;
+    unsigned int offMask;
+    bool timer;
+    byte to;
+  };
+  struct t_Action {
+    byte state;
+    byte when;
+    byte kind;
+    byte name;
+    unsigned int value;
+  };
+  static_assert(MaxNoCtrls <= 16, "Tilstandstabel kan højst bruge 16 betjeningsenheder");
+  static_assert(MaxNoStates <= 32, "Tilstandstabel kan højst bruge 32 tilstande");
+
+  constexpr unsigned int ctrl(byte ctrlName) {return 1U << ctrlName;}
+  constexpr unsigned long stateBit(byte stateNo) {return 1UL << stateNo;}
+
+  template <typename T>
+  constexpr byte stateOf(const T &item) {return item.state;}
+  constexpr byte stateOf(const t_Transition &item) {return item.from;}
+
+  template <typename T, size_t N>
+  constexpr bool isSorted(const T (&table)[N], size_t index = 1) {
+    return (index >= N) || ((stateOf(table[index-1]) <= stateOf(table[index])) && isSorted(table, index+1));
+  }
+
+  template <size_t N>
+  constexpr unsigned long step(const t_Transition (&table)[N], unsigned long reach, size_t index = 0) {
+    return (index >= N)?reach:step(table, ((reach & stateBit(table[index].from)) != 0)?(reach | stateBit(table[index].to)):reach, index+1);
+  }
+
+  template <size_t N>
+  constexpr unsigned long reachable(const t_Transition (&table)[N], byte startState, byte noSteps = MaxNoStates) {
+    return (noSteps == 0)?stateBit(startState):step(table, reachable(table, startState, noSteps-1));
+  }
+
+  template <size_t N>
+  constexpr unsigned long leaving(const t_Transition (&table)[N], size_t index = 0) {
+    return (index >= N)?0:(((table[index].from != table[index].to)?stateBit(table[index].from):0) | leaving(table, index+1));
+  }
+
+  template <size_t N>
+  constexpr unsigned long deadEnds(const t_Transition (&table)[N], byte noStates = MaxNoStates) {
+    return ((noStates >= 32)?~0UL:(stateBit(noStates)-1)) & ~leaving(table);
+  }
+
+  template <typename T, size_t N>
+  void makeIndex(const T (&table)[N], byte first[MaxNoStates+1]) {
+    static_assert(N < 256, "Tilstandstabel er for stor");
+    T item;
+    byte index = 0;
+    for (byte state=0; state <= MaxNoStates; state++) {
+      while (index < N) {
+        memcpy_P(&item, &table[index], sizeof(item));
+        if (stateOf(item) >= state) break;
+        index++;
+      }
+      first[state] = index;
+    }
+  }
+
+  template <size_t N>
+  void markTimed(const t_Transition (&table)[N], byte timed[(MaxNoStates+7)/8]) {
+    t_Transition item;
+    for (byte state=0; state < MaxNoStates; state++) timed[state/8] &= ~(1 << (state%8));
+    for (size_t index=0; index < N; index++) {
+      memcpy_P(&item, &table[index], sizeof(item));
+      if ((item.timer == true) && (item.from < MaxNoStates)) timed[item.from/8] |= (1 << (item.from%8));
+    }
+  }
+
+  inline bool isTimed(const byte timed[(MaxNoStates+7)/8], byte stateNo) {return (timed[stateNo/8] & (1 << (stateNo%8))) != 0;}
+}
+#endif
 
 //----------
 
+#ifndef BrugStatiskOverkoersel
 // Typen af komponent kan udpeges for kontrol
 enum {CTRLS, DEVICES, STATES, LASTYPE};  
 
@@ -61,21 +263,30 @@ enum {CTRLS, DEVICES, STATES, LASTYPE};
 // Strukturen leverer services, der kan bruges til at tjekke for at kun allokeret og konfigureret memory bliver brugt.
 // isValidIndex(...): Er en service, som svarer på om den plads index peger på må bruges.
 // hasConfig(...): Er en service, som svarer om der er konfigureret et objekt med den angive pointer. 
+// Med kompakt findes antal pladser fra MaxNo... konstanterne i stedet for en tabel i RAM
 struct t_Collection {
 private:
+#ifndef BrugKompakt
   byte maxNo[LASTYPE];
+#endif
 public:
   t_CrossingCtrl *ctrl[MaxNoCtrls];
   t_CrossingDevice *device[MaxNoDevices];
   t_StateMachine *state[MaxNoStates];
   void initialize(void) {
+#ifndef BrugKompakt
     maxNo[CTRLS] = MaxNoCtrls; maxNo[DEVICES] = MaxNoDevices; maxNo[STATES] = MaxNoStates;
+#endif
     for (byte cnt=0; cnt < MaxNoCtrls; cnt++) ctrl[cnt] = nullptr;
     for (byte cnt=0; cnt < MaxNoDevices; cnt++) device[cnt] = nullptr;
     for (byte cnt=0; cnt < MaxNoStates; cnt++) state[cnt] = nullptr;  
   }
   bool isValidIndex(byte itemType, byte index) {
+#ifndef BrugKompakt
     return (index >= 0 && index < maxNo[itemType]);
+#else
+    return index < ((itemType == CTRLS)?MaxNoCtrls:((itemType == DEVICES)?MaxNoDevices:MaxNoStates));
+#endif
   }
   bool hasConfig(byte itemType, byte index) {
     bool result = false;
@@ -96,64 +307,447 @@ public:
 // initState(...): Initialiserer den første tilstand, som overkørsel skal starte med.
 // doClockCycle(...): Sørger for at alle overkørslens komponenter udfører polling.
 // Desuden varetager metoden styring af overkørslens tilstand.
+// Med tickless klok holdes klokken vågen efter transition, så ny tilstand starter i næste klokcyklus.
+// Ved hændelsesstyring bliver tilstand kun kaldt ved start, når en betjeningsenhed har skiftet status eller når tid er startet.
+// Ydre enheder bliver kun kaldt, når de har fået ny status, blinker eller bevæger sig.
+// Med portbuffer skrives udgange til hardware porte samlet ved afslutning af klokcyklus.
+// Med tilstandstabel bliver tilstandsmaskinen afviklet fra tabeller i stedet for tilstandsobjekter.
+// Kun overgange fra aktuel tilstand bliver evalueret. Tilstanden bruger t_StateMachine's urværk.
+// Med flere overkørsler har hver overkørsel sin egen collection, som gives til konstruktøren.
+// items(...): Leverer overkørslens collection
+// p_collection: Pointer til overkørslens collection
+// dispatched: Antal kald til komponenter i seneste klokcyklus
+// busyDevice: Bitmaske over ydre enheder som skal kaldes
+// markBusy(...): Sætter ydre enhed til at blive kaldt
+// dispatchCount(...): Leverer antal kald til komponenter i seneste klokcyklus
+// state(...): Leverer aktuel tilstand
+// hasState(...), stateEntry(...), stateCondition(...), stateExit(...): Afvikler aktuel tilstand fra objekt eller tabel
+// stateIsTimed(...), stateEndTime(...): Tid i aktuel tilstand ved hændelsesstyring
+// setTable(...): Kobler tabeller med overgange og handlinger til overkørslen
+// firstTransition, firstAction: Index til første overgang og handling for hver tilstand
+// timed: Bit per tilstand med en overgang med timer
+// doActions(...): Udfører handlinger ved ENTRY eller EXIT
 // status(...): Er en service til et tilstandsobjekt, som leverer en betjeningsenhed eller sensorenheds status.
 // reset(...): Er en service til et tilstandsobjekt, som kan resette en betjeningsenhed eller sensorenhed.
 // to(...): Er en service til et tilstandsobjekt, som kan sende en besked til en ydre enhed.
+// Med sporing bliver klokcyklus, skift af tilstand og kald af to(...) registreret i Trace.
 struct t_Crossing {
 private:
   byte stateNo = 0;
   byte entryState = false;
+  unsigned int dispatched = 0;
+#ifdef BrugHaendelsesstyring
+  byte busyDevice[(MaxNoDevices+7)/8] = {};
+  void markBusy(byte deviceName) {busyDevice[deviceName/8] |= (1 << (deviceName%8));}
+#endif
+#ifndef BrugFlereOverkoersler
+  t_Collection &items(void) {return collection;}
+#else
+  t_Collection *p_collection;
+  t_Collection &items(void) {return *p_collection;}
+#endif
+#ifndef BrugTilstandstabel
+  bool hasState(void) {return items().hasConfig(STATES, stateNo);}
+  void stateEntry(void) {items().state[stateNo]->onEntry();}
+  byte stateCondition(void) {return items().state[stateNo]->doCondition(stateNo);}
+  void stateExit(void) {items().state[stateNo]->onExit();}
+#else
+  const StateTable::t_Transition *transitions = nullptr;
+  const StateTable::t_Action *actions = nullptr;
+  byte firstTransition[MaxNoStates+1] = {};
+  byte firstAction[MaxNoStates+1] = {};
+  byte timed[(MaxNoStates+7)/8] = {};
+  bool hasState(void) {return (transitions != nullptr) && (stateNo < MaxNoStates);}
+  void stateEntry(void) {doActions(StateTable::ENTRY);}
+  byte stateCondition(void);
+  void stateExit(void) {doActions(StateTable::EXIT);}
+  void doActions(byte when);
+#endif
+#ifdef BrugHaendelsesstyring
+#ifndef BrugFlereOverkoersler
+  bool stateIsTimed(void) {return t_StateMachine::isTimed();}
+  void stateEndTime(void) {t_StateMachine::endTime();}
+#else
+  bool stateIsTimed(void) {return (hasState() == true) && items().state[stateNo]->isTimed();}
+  void stateEndTime(void) {items().state[stateNo]->endTime();}
+#endif
+#endif
 public:
+#ifdef BrugFlereOverkoersler
+  t_Crossing(t_Collection *a_collection = &collection): p_collection(a_collection) {}
+#endif
+
   void setCtrl(byte ctrlName, t_CrossingCtrl *ctrl) {
-    if (collection.isValidIndex(CTRLS, ctrlName) == true) collection.ctrl[ctrlName] = ctrl;
+    if (items().isValidIndex(CTRLS, ctrlName) == true) items().ctrl[ctrlName] = ctrl;
   }
 
   void setDevice(byte deviceName, t_CrossingDevice *device) {
-    if (collection.isValidIndex(DEVICES, deviceName) == true) collection.device[deviceName] = device;
+    if (items().isValidIndex(DEVICES, deviceName) == true) {
+      items().device[deviceName] = device;
+#ifdef BrugHaendelsesstyring
+      markBusy(deviceName);
+#endif
+    }
   }
 
   void setState(byte stateName, t_StateMachine *state) {
-    if (collection.isValidIndex(STATES, stateName) == true) collection.state[stateName] = state;
+    if (items().isValidIndex(STATES, stateName) == true) {
+      items().state[stateName] = state;
+#ifdef BrugFlereOverkoersler
+      state->attach(this);
+#endif
+    }
   }
 
-  void initState(byte a_stateNo) {stateNo = a_stateNo; entryState = true;}
+  void initState(byte a_stateNo) {
+    stateNo = a_stateNo;
+    entryState = true;
+#ifdef BrugSporing
+    Trace::record(Trace::STATE, stateNo);
+#endif
+  }
+
+#ifdef BrugTilstandstabel
+  template <size_t NoTransitions, size_t NoActions>
+  void setTable(const StateTable::t_Transition (&a_transitions)[NoTransitions], const StateTable::t_Action (&a_actions)[NoActions]) {
+    transitions = a_transitions;
+    actions = a_actions;
+    StateTable::makeIndex(a_transitions, firstTransition);
+    StateTable::makeIndex(a_actions, firstAction);
+    StateTable::markTimed(a_transitions, timed);
+  }
+#endif
 
   void doClockCycle(void) {
     byte cnt;  // Loop tæller
     byte nextState;
+    bool hasEvent = false;
+    dispatched = 0;
+#ifdef BrugKlokmaaling
+    CycleStats::mark(CycleStats::CTRLS);
+#endif
+#ifdef BrugSporing
+    Trace::nextCycle();
+#endif
+#ifdef BrugPortfilter
+    InPort::doClockCycle();
+#endif
+#ifdef BrugKantfangst
+    EdgeCapture::doClockCycle();
+#endif
+#ifdef BrugSeriel
+    SerialLink::doClockCycle();
+#endif
     for (cnt=0; cnt < MaxNoCtrls; cnt++) {
-      if (collection.hasConfig(CTRLS, cnt) == true) collection.ctrl[cnt]->doClockCycle();
+      if (items().hasConfig(CTRLS, cnt) == true) {
+        items().ctrl[cnt]->doClockCycle();
+        dispatched++;
+#ifdef BrugHaendelsesstyring
+        if (items().ctrl[cnt]->hasChanged() == true) hasEvent = true;
+#endif
+      }
     }
-    if (collection.hasConfig(STATES, stateNo) == true) {
+#ifdef BrugKlokmaaling
+    CycleStats::mark(CycleStats::STATE);
+#endif
+#ifndef BrugHaendelsesstyring
+    hasEvent = true;
+#else
+    hasEvent = hasEvent || entryState || stateIsTimed();
+#endif
+    if ((hasEvent == true) && (hasState() == true)) {
       if (entryState == true) {
-        collection.state[stateNo]->onEntry();
+        stateEntry();
         entryState = false;
+        dispatched++;
       }
-      nextState = collection.state[stateNo]->doCondition(stateNo);
+      nextState = stateCondition();
+      dispatched++;
       if (nextState != stateNo) {
-        collection.state[stateNo]->onExit();
+        stateExit();
+        dispatched++;
+#ifdef BrugHaendelsesstyring
+        stateEndTime();
+#endif
         stateNo = nextState;
         entryState = true;
+#ifdef BrugSporing
+        Trace::record(Trace::STATE, stateNo);
+#endif
+#ifdef BrugTicklessKlok
+        Clock::stayAwake();
+#endif
       }
     }
+#ifdef BrugKlokmaaling
+    CycleStats::mark(CycleStats::DEVICES);
+#endif
+#ifndef BrugHaendelsesstyring
     for (cnt=0; cnt < MaxNoDevices; cnt++) {
-      if (collection.hasConfig(DEVICES, cnt) == true) collection.device[cnt]->doClockCycle();
+      if (items().hasConfig(DEVICES, cnt) == true) {
+        items().device[cnt]->doClockCycle();
+        dispatched++;
+      }
+    }
+#else
+    for (byte group=0; group < sizeof(busyDevice); group++) {
+      if (busyDevice[group] == 0) continue;
+      for (byte mask=1, cnt=group*8; (mask != 0) && (cnt < MaxNoDevices); mask <<= 1, cnt++) {
+        if ((busyDevice[group] & mask) == 0) continue;
+        if (items().hasConfig(DEVICES, cnt) == true) {
+          items().device[cnt]->doClockCycle();
+          dispatched++;
+          if (items().device[cnt]->isBusy() == true) continue;
+        }
+        busyDevice[group] &= ~mask;
+      }
     }
+#endif
+#ifdef BrugSeriel
+    while (SerialLink::hasQuery() == true)
+      if (SerialLink::answer(status(SerialLink::query())) == false) break;
+    SerialLink::flush();
+#endif
+#ifdef BrugPortbuffer
+    OutPort::flush();
+#endif
+#ifdef BrugLysdaemper
+    LampDimmer::doClockCycle();
+#endif
+#ifdef BrugPortudvidelse
+    Expander::flush();
+#endif
+#ifdef BrugKlokmaaling
+    CycleStats::mark(CycleStats::NoParts);
+#endif
   }
 
+  unsigned int dispatchCount(void) const {return dispatched;}
+  byte state(void) const {return stateNo;}
+
   byte status(byte ctrlName) {
     byte result = OFF;
-    if (collection.hasConfig(CTRLS, ctrlName) == true) result = collection.ctrl[ctrlName]->status();
+    if (items().hasConfig(CTRLS, ctrlName) == true) result = items().ctrl[ctrlName]->status();
     return result;
   }
 
   void reset(byte ctrlName) {
-    if (collection.hasConfig(CTRLS, ctrlName) == true) collection.ctrl[ctrlName]->reset();  
+    if (items().hasConfig(CTRLS, ctrlName) == true) items().ctrl[ctrlName]->reset();  
   }
   
   void to(byte deviceName, byte deviceState) {
-    if (collection.hasConfig(DEVICES, deviceName) == true) collection.device[deviceName]->to(deviceState);
+#ifdef BrugSporing
+    Trace::record(Trace::DEVICE, deviceName | (deviceState << 7));
+#endif
+    if (items().hasConfig(DEVICES, deviceName) == true) {
+      items().device[deviceName]->to(deviceState);
+#ifdef BrugHaendelsesstyring
+      markBusy(deviceName);
+#endif
+    }
   }
 } crossing;
 
+#ifdef BrugFlereOverkoersler
+byte t_CrossingLink::status(byte ctrlName) {return p_crossing->status(ctrlName);}
+void t_CrossingLink::reset(byte ctrlName) {p_crossing->reset(ctrlName);}
+void t_CrossingLink::to(byte deviceName, byte deviceState) {p_crossing->to(deviceName, deviceState);}
+#endif
+
+#ifdef BrugTilstandstabel
+byte t_Crossing::stateCondition(void) {
+  StateTable::t_Transition transition;
+  bool isTimedOut = false;
+  if (StateTable::isTimed(timed, stateNo) == true) isTimedOut = t_StateMachine::clockWork.triggered();
+  for (byte index=firstTransition[stateNo]; index < firstTransition[stateNo+1]; index++) {
+    memcpy_P(&transition, &transitions[index], sizeof(transition));
+    bool passed = true;
+    unsigned int mask = transition.onMask | transition.offMask;
+    for (byte cnt=0; (mask != 0) && (passed == true); cnt++, mask >>= 1) {
+      if ((mask & 1) == 0) continue;
+      bool isOn = (status(cnt) == ON);
+      if ((transition.onMask & (1U << cnt)) != 0) passed = isOn;
+      else passed = !isOn;
+    }
+    if (transition.timer == true) passed = passed && isTimedOut;
+    if (passed == true) return transition.to;
+  }
+  return stateNo;
+}
+
+void t_Crossing::doActions(byte when) {
+  StateTable::t_Action action;
+  for (byte index=firstAction[stateNo]; index < firstAction[stateNo+1]; index++) {
+    memcpy_P(&action, &actions[index], sizeof(action));
+    if (action.when != when) continue;
+    switch (action.kind) {
+      case StateTable::TO: to(action.name, action.value); break;
+      case StateTable::RESET: reset(action.name); break;
+      case StateTable::MSEC: t_StateMachine::clockWork.setDuration(action.value, false); break;
+      case StateTable::SECONDS: t_StateMachine::clockWork.setDuration(action.value, true); break;
+    }
+  }
+}
+#endif
+#else
+// Ansvar: Sammensætter overkørslen på oversættelsestidspunktet uden pointere og virtuelle kald.
+// Betjeningsenheder, ydre enheder og tilstande bliver listet som typer. Løkker og opslag på navn bliver foldet ud af oversætteren,
+// så hver klokcyklus kalder de konkrete objekter direkte. Pladser der ikke er listet, fylder hverken flash eller RAM.
+// t_Slot<Name, T, obj>: Knytter navn til et objekt af typen T. obj skal være en global variabel
+// t_StateSlot<Name, T>: Knytter navn til en tilstand af typen T. Objektet oprettes af skabelonen, så tilstande kan
+// skrives efter overkørslen og bruge crossing.status(...) og crossing.to(...)
+// t_Slots<...>: Liste af pladser. Et navn må kun bruges én gang i en liste
+// t_StaticCrossing<Ctrls, Devices, States>: Samme grænseflade som t_Crossing, dog uden set...(...)
+// Hændelsesstyring bruges ikke. Tickless klok, portfilter, kantfangst, portbuffer og sporing virker som i t_Crossing.
+template <byte Name, typename T, T &obj>
+struct t_Slot {
+  typedef T Type;
+  static const byte name = Name;
+  static T &object(void) {return obj;}
+};
+
+template <byte Name, typename T>
+struct t_StateSlot {
+  typedef T Type;
+  static const byte name = Name;
+  static T obj;
+  static T &object(void) {return obj;}
+};
+
+template <byte Name, typename T>
+T t_StateSlot<Name, T>::obj;
+
+template <typename... Slots>
+struct t_Slots;
+
+template <>
+struct t_Slots<> {
+  static const byte count = 0;
+  static constexpr bool hasName(byte) {return false;}
+  static constexpr bool isUnique(void) {return true;}
+  static void doClockCycle(void) {}
+  static byte status(byte) {return OFF;}
+  static void reset(byte) {}
+  static void to(byte, byte) {}
+  static void onEntry(byte) {}
+  static byte doCondition(byte stateNo) {return stateNo;}
+  static void onExit(byte) {}
+};
+
+template <typename Slot, typename... Rest>
+struct t_Slots<Slot, Rest...> {
+  typedef t_Slots<Rest...> Next;
+  typedef typename Slot::Type T;
+  static const byte count = Next::count+1;
+  static constexpr bool hasName(byte name) {return (Slot::name == name) || Next::hasName(name);}
+  static constexpr bool isUnique(void) {return (Next::hasName(Slot::name) == false) && Next::isUnique();}
+  static void doClockCycle(void) {Slot::object().T::doClockCycle(); Next::doClockCycle();}
+  static byte status(byte name) {return (name == Slot::name)?Slot::object().T::status():Next::status(name);}
+  static void reset(byte name) {if (name == Slot::name) Slot::object().T::reset(); else Next::reset(name);}
+  static void to(byte name, byte state) {if (name == Slot::name) Slot::object().T::to(state); else Next::to(name, state);}
+  static void onEntry(byte name) {if (name == Slot::name) Slot::object().T::onEntry(); else Next::onEntry(name);}
+  static byte doCondition(byte name) {return (name == Slot::name)?Slot::object().T::doCondition(name):Next::doCondition(name);}
+  static void onExit(byte name) {if (name == Slot::name) Slot::object().T::onExit(); else Next::onExit(name);}
+};
+
+template <typename Ctrls, typename Devices, typename States>
+struct t_StaticCrossing {
+private:
+  static_assert(Ctrls::isUnique() && Devices::isUnique() && States::isUnique(), "Et navn er brugt to gange i overkørslen");
+  byte stateNo = 0;
+  byte entryState = false;
+  unsigned int dispatched = 0;
+public:
+  void initState(byte a_stateNo) {
+    stateNo = a_stateNo;
+    entryState = true;
+#ifdef BrugSporing
+    Trace::record(Trace::STATE, stateNo);
+#endif
+  }
+
+  void doClockCycle(void) {
+    byte nextState;
+#ifdef BrugKlokmaaling
+    CycleStats::mark(CycleStats::CTRLS);
+#endif
+#ifdef BrugSporing
+    Trace::nextCycle();
+#endif
+#ifdef BrugPortfilter
+    InPort::doClockCycle();
+#endif
+#ifdef BrugKantfangst
+    EdgeCapture::doClockCycle();
+#endif
+#ifdef BrugSeriel
+    SerialLink::doClockCycle();
+#endif
+    Ctrls::doClockCycle();
+    dispatched = Ctrls::count+1;
+#ifdef BrugKlokmaaling
+    CycleStats::mark(CycleStats::STATE);
+#endif
+    if (entryState == true) {
+      States::onEntry(stateNo);
+      entryState = false;
+      dispatched++;
+    }
+    nextState = States::doCondition(stateNo);
+    if (nextState != stateNo) {
+      States::onExit(stateNo);
+      dispatched++;
+      stateNo = nextState;
+      entryState = true;
+#ifdef BrugSporing
+      Trace::record(Trace::STATE, stateNo);
+#endif
+#ifdef BrugTicklessKlok
+      Clock::stayAwake();
+#endif
+    }
+#ifdef BrugKlokmaaling
+    CycleStats::mark(CycleStats::DEVICES);
+#endif
+    Devices::doClockCycle();
+    dispatched += Devices::count;
+#ifdef BrugSeriel
+    while (SerialLink::hasQuery() == true)
+      if (SerialLink::answer(status(SerialLink::query())) == false) break;
+    SerialLink::flush();
+#endif
+#ifdef BrugPortbuffer
+    OutPort::flush();
+#endif
+#ifdef BrugLysdaemper
+    LampDimmer::doClockCycle();
+#endif
+#ifdef BrugPortudvidelse
+    Expander::flush();
+#endif
+#ifdef BrugKlokmaaling
+    CycleStats::mark(CycleStats::NoParts);
+#endif
+  }
+
+  unsigned int dispatchCount(void) const {return dispatched;}
+  byte status(byte ctrlName) {return Ctrls::status(ctrlName);}
+  void reset(byte ctrlName) {Ctrls::reset(ctrlName);}
+  void to(byte deviceName, byte deviceState) {
+#ifdef BrugSporing
+    Trace::record(Trace::DEVICE, deviceName | (deviceState << 7));
+#endif
+    Devices::to(deviceName, deviceState);
+  }
+};
+#endif
+
+#ifdef BrugAnlaeg
+#include "OvkAnlaeg.h"
+#endif
+
+#ifdef BrugKonfiguration
+#include "OvkKonfig.h"
+#endif
+
 #endif
@@ -0,0 +1,307 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Arduino stedfortræder til simulering på Linux
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Erstatter Arduino.h, så bibliotekets headerfiler kan oversættes uændret på Linux.
+ * Tiden er virtuel. Den skrider kun frem, når simulatoren kalder Sim::advanceMillis(...).
+ * millis() og micros() løber rundt ved 32 bit som på en Uno. Sim::startMillis kan starte millis() tæt på 0xFFFFFFFF.
+ * PROGMEM er tom, så tabeller ligger i RAM, og memcpy_P(...) er memcpy(...).
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define NUM_DIGITAL_PINS 20
+
+#define PROGMEM
+#define memcpy_P(D, S, N) memcpy((D), (S), (N))
+
+#define NOT_A_PIN 0
+#define NOT_A_PORT 0
+#define PB 2
+#define PC 3
+#define PD 4
+
+// Ansvar: Spejler en Arduino Uno's porte og klokke.
+// NoPins: Digitale porte D0-D13 og analoge A0-A5
+// t_Board: Tilstand for alle porte på et kort
+// t_Counters: Tæller kald til hardware. portWrites og portReads tæller skrivninger og læsninger af porte, også dem digitalWrite og digitalRead udfører
+// t_PortRegister: Spejler et output register. Skrivning opdaterer portens ben og bliver talt
+// t_PortInput: Spejler et input register. Læsning bliver talt
+// pinLevel(...): Benets niveau som digitalRead ville levere det
+// pinPort(...), pinBit(...): Uno's tilknytning af ben til port: D0-D7 PD, D8-D13 PB, A0-A5 PC
+// t_InputEvent: En tidsstyret ændring af en indgang
+// callMicros: Virtuel tid som hvert kald til hardware tager. 0 gør kald gratis
+// charge(...): Flytter tiden frem med callMicros
+// board: Pointer til det kort som Arduino funktionerne arbejder på. Hver tråd har sin egen pointer og sine egne tællere
+// clockMicros: Virtuel tid i µsek siden start. Simulatoren regner med denne tid, som ikke løber rundt
+// startMillis: Værdi af millis() ved start. Sættes tæt på 0xFFFFFFFF, så millis() løber rundt undervejs
+// onWrite, onServo: Kaldes ved hver ændring af en udgang, hvis de er sat
+// onInput: Kaldes ved hver ændring af en indgang, svarer til pinskift interrupt
+// script: Indgangsændringer, som udføres når tiden når frem
+// setInput(...): Påtrykker en indgang et niveau udefra
+// addInput(...): Lægger en indgangsændring i script, sorteret efter tid
+// advanceMicros(...), advanceMillis(...): Flytter tiden frem og udfører script
+// sleep(...): Sover som en Uno i idle mode. Vågner ved næste Timer0 interrupt (1024 µsek) eller ved en indgangsændring
+// elapsedMillis(...): Virtuel tid i msek siden start
+// reset(...): Nulstiller kort, tid, tællere og script
+namespace Sim {
+  const byte NoPins = NUM_DIGITAL_PINS;
+
+  struct t_Board {
+    byte mode[NoPins];
+    byte output[NoPins];
+    byte input[NoPins];
+    bool driven[NoPins];
+    int servoPW[NoPins];
+  };
+
+  struct t_Counters {
+    unsigned long digitalWrites;
+    unsigned long digitalReads;
+    unsigned long servoWrites;
+    unsigned long portWrites;
+    unsigned long portReads;
+  };
+
+  struct t_InputEvent {
+    unsigned long atMillis;
+    byte pin;
+    byte level;
+  };
+
+  inline t_Board defaultBoard;
+  inline thread_local t_Board *board = &defaultBoard;
+  inline unsigned long long clockMicros = 0;
+  inline uint32_t startMillis = 0;
+  inline thread_local t_Counters count;
+  inline void (*onWrite)(byte pin, byte value) = nullptr;
+  inline void (*onServo)(byte pin, int pulseWidth) = nullptr;
+  inline void (*onInput)(byte pin, byte level) = nullptr;
+  inline std::vector<t_InputEvent> script;
+  inline size_t scriptPos = 0;
+  inline unsigned int callMicros = 0;
+
+  inline bool isValidPin(byte pin) {return pin < NoPins;}
+
+  inline byte pinPort(byte pin) {
+    if (pin < 8) return PD;
+    if (pin < 14) return PB;
+    if (pin < NoPins) return PC;
+    return NOT_A_PORT;
+  }
+
+  inline byte pinBit(byte pin) {
+    if (pin < 8) return 1 << pin;
+    if (pin < 14) return 1 << (pin-8);
+    if (pin < NoPins) return 1 << (pin-14);
+    return 0;
+  }
+
+  inline void writePin(byte pin, byte value) {
+    if (board->output[pin] == value) return;
+    board->output[pin] = value;
+    if (onWrite != nullptr) onWrite(pin, value);
+  }
+
+  inline byte pinLevel(byte pin) {
+    if (board->driven[pin] == true) return board->input[pin];
+    if (board->mode[pin] == INPUT_PULLUP) return HIGH;
+    if (board->mode[pin] == OUTPUT) return board->output[pin];
+    return LOW;
+  }
+
+  inline void charge(void);
+
+  struct t_PortInput {
+    byte port;
+    operator uint8_t() const {
+      uint8_t value = 0;
+      count.portReads++;
+      charge();
+      for (byte pin=0; pin < NoPins; pin++) if ((pinPort(pin) == port) && (pinLevel(pin) == HIGH)) value |= pinBit(pin);
+      return value;
+    }
+  };
+
+  struct t_PortRegister {
+    byte port;
+    operator uint8_t() const {
+      uint8_t value = 0;
+      for (byte pin=0; pin < NoPins; pin++) if ((pinPort(pin) == port) && (board->output[pin] == HIGH)) value |= pinBit(pin);
+      return value;
+    }
+    t_PortRegister &operator=(uint8_t value) {
+      count.portWrites++;
+      charge();
+      for (byte pin=0; pin < NoPins; pin++) if (pinPort(pin) == port) writePin(pin, (value & pinBit(pin)) != 0);
+      return *this;
+    }
+  };
+
+  inline t_PortRegister portRegister[PD+1] = {{0}, {1}, {PB}, {PC}, {PD}};
+  inline t_PortInput portInput[PD+1] = {{0}, {1}, {PB}, {PC}, {PD}};
+
+  inline void setInput(byte pin, byte level) {
+    if (isValidPin(pin) == false) return;
+    level = (level != LOW);
+    byte prevLevel = (board->driven[pin] == true)?board->input[pin]:(board->mode[pin] == INPUT_PULLUP);
+    bool changed = (prevLevel != level);
+    board->input[pin] = level;
+    board->driven[pin] = true;
+    if ((changed == true) && (onInput != nullptr)) onInput(pin, level);
+  }
+
+  inline void addInput(unsigned long atMillis, byte pin, byte level) {
+    size_t pos = script.size();
+    while ((pos > scriptPos) && (script[pos-1].atMillis > atMillis)) pos--;
+    script.insert(script.begin()+pos, t_InputEvent{atMillis, pin, level});
+  }
+
+  inline void advanceMicros(unsigned long long micros) {
+    unsigned long long target = clockMicros+micros;
+    while ((scriptPos < script.size()) && (script[scriptPos].atMillis*1000ULL <= target)) {
+      if (script[scriptPos].atMillis*1000ULL > clockMicros) clockMicros = script[scriptPos].atMillis*1000ULL;
+      setInput(script[scriptPos].pin, script[scriptPos].level);
+      scriptPos++;
+    }
+    clockMicros = target;
+  }
+
+  inline void advanceMillis(unsigned long millis) {advanceMicros(millis*1000ULL);}
+
+  inline unsigned long long elapsedMillis(void) {return clockMicros/1000ULL;}
+
+  inline void charge(void) {if (callMicros > 0) advanceMicros(callMicros);}
+
+  inline void sleep(void) {
+    const unsigned long long Timer0Overflow = 1024;
+    unsigned long long wakeMicros = (clockMicros/Timer0Overflow+1)*Timer0Overflow;
+    if ((scriptPos < script.size()) && (script[scriptPos].atMillis*1000ULL < wakeMicros)) {
+      wakeMicros = script[scriptPos].atMillis*1000ULL;
+      if (wakeMicros < clockMicros) wakeMicros = clockMicros;
+    }
+    advanceMicros(wakeMicros-clockMicros);
+  }
+
+  inline void reset(void) {
+    *board = t_Board();
+    clockMicros = 0;
+    count = t_Counters();
+    script.clear();
+    scriptPos = 0;
+  }
+
+  inline void servoWrite(byte pin, int pulseWidth) {
+    count.servoWrites++;
+    charge();
+    if (isValidPin(pin) == false) return;
+    if (board->servoPW[pin] == pulseWidth) return;
+    board->servoPW[pin] = pulseWidth;
+    if (onServo != nullptr) onServo(pin, pulseWidth);
+  }
+}
+
+//----------
+
+inline void pinMode(byte pin, byte mode) {
+  if (Sim::isValidPin(pin) == false) return;
+  Sim::board->mode[pin] = mode;
+}
+
+inline void digitalWrite(byte pin, byte value) {
+  Sim::count.digitalWrites++;
+  if (Sim::isValidPin(pin) == false) return;
+  Sim::count.portWrites++;   // En Uno læser, ændrer og skriver hele porten
+  Sim::charge();
+  Sim::writePin(pin, value != LOW);
+}
+
+inline int digitalRead(byte pin) {
+  Sim::count.digitalReads++;
+  if (Sim::isValidPin(pin) == false) return LOW;
+  Sim::count.portReads++;   // En Uno læser hele porten
+  Sim::charge();
+  return Sim::pinLevel(pin);
+}
+
+#define digitalPinToPort(P) (Sim::pinPort(P))
+#define digitalPinToBitMask(P) (Sim::pinBit(P))
+#define portOutputRegister(P) (&Sim::portRegister[(P)])
+#define portInputRegister(P) (&Sim::portInput[(P)])
+
+// Timer 1 med forskaler 8 ved 16 MHz tæller 2 gange per µsek af den virtuelle tid. OCR1A er et almindeligt register.
+// Simulatoren kalder selv interrupt, når TCNT1 når OCR1A. En læsning af TCNT1 tager 1 µsek af den virtuelle tid,
+// så en løkke, der venter på timeren, når frem til sin tid
+namespace Sim {
+  struct t_Timer1 {
+    operator uint16_t() const {
+      advanceMicros(1);
+      return (uint16_t)(clockMicros*2);
+    }
+  };
+  inline t_Timer1 timer1;
+  inline volatile uint16_t ocr1a = 0;
+}
+#define TCNT1 (Sim::timer1)
+#define OCR1A (Sim::ocr1a)
+
+// Timer 2 med forskaler 256 ved 16 MHz tæller hver 16. µsek af den virtuelle tid. OCR2A er et almindeligt register.
+// Simulatoren kalder selv interrupt, når timeren når OCR2A
+namespace Sim {
+  inline volatile uint8_t ocr2a = 0;
+}
+#define OCR2A (Sim::ocr2a)
+
+inline void noInterrupts(void) {}
+inline void interrupts(void) {}
+
+// En Uno's unsigned long er 32 bit. Værdierne afkortes, så de løber rundt som millis() efter 49,7 dage og micros() efter 71 minutter
+inline unsigned long millis(void) {return (uint32_t)(Sim::startMillis+Sim::clockMicros/1000ULL);}
+inline unsigned long micros(void) {return (uint32_t)(Sim::startMillis*1000ULL+Sim::clockMicros);}
+inline void delay(unsigned long ms) {Sim::advanceMillis(ms);}
+inline void delayMicroseconds(unsigned int us) {Sim::advanceMicros(us);}
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x-in_min)*(out_max-out_min)/(in_max-in_min)+out_min;
+}
+
+template <typename T, typename L, typename H>
+inline T constrain(T x, L low, H high) {return (x < low)?low:((x > high)?high:x);}
+
+#endif
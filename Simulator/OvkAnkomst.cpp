@@ -0,0 +1,242 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Kontrol af ankomsttid og advarselstid i virtuel tid
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Kører RefOverkoerselAnkomst.h med tilfældige tog i virtuel tid.
+ * Hvert tog kører med fast hastighed fra målested til tændsted. Ved tændsted beholder halvdelen af togene hastigheden,
+ * en fjerdedel bliver hastighedsmargin procent hurtigere, og resten får en tilfældig hastighed fra halvdelen
+ * til hastighedsmargin procent over den første. Hvert 10. tog passerer ikke målestedet.
+ * Advarsel starter ved første klokcyklus i FORRING. Advarselstiden er tiden derfra til toget er i overkørslen.
+ * Kontrol: Et tog, der passerer tændsted mindst varsling plus sensorens forsinkelse før overkørslen,
+ * skal have mindst varsling advarsel, og overkørslen skal være SIKRET før toget er i overkørslen.
+ * Andre tog skal have advarsel fra tændsted som uden måling.
+ * Uden -v og -m køres alle kombinationer af Warnings og Margins, så ventetider med rest under en klokcyklus
+ * og margin uden afrunding bliver prøvet. Hver kombination køres i en proces kopieret før setup().
+ * Brug: ovk_ankomst [-n tog] [-s frø] [-v msek] [-m procent] [-l]
+ * -v: Varsling i msek. -m: Hastighedsmargin i procent. Standard er Timing.Varsling og Timing.Hastighedsmargin.
+ * -l skriver hvert tog: hastigheder, ventetid og advarselstid.
+ * Afslutter med 0 når alle tog passer og 1 ved fejl.
+ */
+
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "RefOverkoerselAnkomst.h"
+#include "SimScript.h"
+
+#ifdef BrugTicklessKlok
+void simSleep(unsigned long) {Sim::sleep();}
+#endif
+#ifdef BrugKantfangst
+void simPinChange(byte pin, byte) {EdgeCapture::onPinChange(digitalPinToPort(pin));}
+#elif defined(BrugTicklessKlok)
+void simPinChange(byte, byte) {Clock::wake();}
+#endif
+
+// Ansvar: Togplan og målinger for hvert tog.
+// SensorDelay: Længste tid fra toget passerer tændsted til advarsel starter uden måling
+// t_Train: Tider i msek for togvej, målested, tændsted og overkørsel, hastigheder i mm/sek og målte tider
+// Warnings, Margins: Kombinationer der køres uden -v og -m. Varsling med rest 0, 3, 40 og 97 msek efter hele 100 msek
+// warning, margin: Varsling og hastighedsmargin i aktuel kørsel
+// trains: Togplan
+// add(...): Danner togplanen og lægger indgange i simulatorens script
+namespace SimTrains {
+  const unsigned long SensorDelay = 30+5*Clock::ClockCycle;
+  const unsigned int Warnings[] = {Timing.Varsling, Timing.Varsling+3, Timing.Varsling+40, Timing.Varsling+97};
+  const byte Margins[] = {0, 7, Timing.Hastighedsmargin};
+  unsigned int warning = Timing.Varsling;
+  byte margin = Timing.Hastighedsmargin;
+  struct t_Train {
+    unsigned long routeMillis;
+    unsigned long measureMillis;
+    unsigned long switchOnMillis;
+    unsigned long arrivalMillis;
+    double firstSpeed;
+    double secondSpeed;
+    bool isMeasured;
+    unsigned long warningMillis;
+    unsigned long secureMillis;
+    unsigned int measuredSpeed;
+  };
+  std::vector<t_Train> trains;
+
+  unsigned long add(unsigned long noTrains, unsigned long seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> speed(40, 500);
+    std::uniform_real_distribution<double> change(0.5, 1.0+margin/100.0);
+    std::uniform_int_distribution<int> pause(2000, 20000);
+    unsigned long at = 10000;
+    for (unsigned long cnt=0; cnt < noTrains; cnt++) {
+      t_Train train = {};
+      train.firstSpeed = speed(random);
+      train.secondSpeed = train.firstSpeed;
+      if ((cnt % 4) == 1) train.secondSpeed *= 1.0+margin/100.0;
+      if ((cnt % 4) == 3) train.secondSpeed *= change(random);
+      train.isMeasured = ((cnt % 10) != 9);
+      train.routeMillis = at;
+      train.measureMillis = at+3000;
+      train.switchOnMillis = train.measureMillis+(unsigned long)(Afstand.Maalested*1000.0/train.firstSpeed);
+      train.arrivalMillis = train.switchOnMillis+(unsigned long)(Afstand.Overkoersel*1000.0/train.secondSpeed);
+      Sim::addInput(train.routeMillis, ARDPin.Togvej, HIGH);
+      if (train.isMeasured == true) SimScript::addPulse(train.measureMillis, ARDPin.Maalested, true, 300);
+      SimScript::addPulse(train.switchOnMillis, ARDPin.Taendsted, true, 300);
+      Sim::addInput(train.arrivalMillis+5000, ARDPin.Togvej, LOW);
+      trains.push_back(train);
+      at = train.arrivalMillis+5000+Timing.BarrierTime+pause(random);
+    }
+    return at;
+  }
+}
+
+// Ansvar: Kører en togplan med SimTrains::warning og SimTrains::margin og kontrollerer hvert tog.
+// isSummary: Skriver hele opgørelsen, ellers én linje for kombinationen
+// Leverer sand når alle tog passer
+bool run(unsigned long noTrains, unsigned long seed, bool isLogged, bool isSummary) {
+  unsigned long endMillis = SimTrains::add(noTrains, seed);
+#ifdef BrugTicklessKlok
+  Clock::idle = simSleep;
+#endif
+#if defined(BrugTicklessKlok) || defined(BrugKantfangst)
+  Sim::onInput = simPinChange;
+#endif
+  setup();
+  ankomst.setWarning(SimTrains::warning, SimTrains::margin);
+  // Tilstande følges efter hver klokcyklus. Et tog hører til fra dets togvej sættes
+  size_t trainNo = 0;
+  byte prevState = crossing.state();
+#ifndef BrugTicklessKlok
+  unsigned long nextCycle = Clock::ClockCycle;
+#endif
+  while (millis() < endMillis) {
+#ifndef BrugTicklessKlok
+    if (millis() < nextCycle) Sim::advanceMicros(nextCycle*1000ULL-Sim::clockMicros);
+#endif
+    loop();
+#ifndef BrugTicklessKlok
+    nextCycle = (millis()/Clock::ClockCycle+1)*Clock::ClockCycle;
+#endif
+    while ((trainNo+1 < SimTrains::trains.size()) && (millis() >= SimTrains::trains[trainNo+1].routeMillis)) trainNo++;
+    byte state = crossing.state();
+    if (state == prevState) continue;
+    SimTrains::t_Train &train = SimTrains::trains[trainNo];
+    // Tilstandens onEntry(...) udføres i næste klokcyklus
+    if ((state == FORRING) && (train.warningMillis == 0)) {
+      train.warningMillis = millis()+Clock::ClockCycle;
+      train.measuredSpeed = ankomst.speed();
+    }
+    if ((state == SIKRET) && (train.secureMillis == 0)) train.secureMillis = millis()+Clock::ClockCycle;
+    prevState = state;
+  }
+
+  const unsigned long Needed = SimTrains::warning+SimTrains::SensorDelay;
+  unsigned long noChecked = 0, noAdapted = 0, noFallback = 0, noErrors = 0;
+  unsigned long minWarning = 0xFFFFFFFF, maxWarning = 0;
+  double sumWarning = 0, sumFixed = 0;
+  for (const SimTrains::t_Train &train : SimTrains::trains) {
+    long warning = (long)(train.arrivalMillis-train.warningMillis);
+    long fixed = (long)(train.arrivalMillis-train.switchOnMillis);
+    long secure = (long)(train.arrivalMillis-train.secureMillis);
+    long sensorDelay = (long)(train.warningMillis-train.switchOnMillis);
+    bool isLong = ((unsigned long)fixed >= Needed);
+    bool isOk = (train.warningMillis != 0) && (train.secureMillis != 0);
+    if ((isLong == true) && ((warning < (long)SimTrains::warning) || (secure < 0))) isOk = false;
+    if ((train.isMeasured == false) || (isLong == false)) {
+      if ((sensorDelay < 0) || (sensorDelay > (long)SimTrains::SensorDelay)) isOk = false;
+      noFallback++;
+    }
+    else {
+      if (warning < fixed-(long)SimTrains::SensorDelay) noAdapted++;
+      if ((unsigned long)warning < minWarning) minWarning = warning;
+      if ((unsigned long)warning > maxWarning) maxWarning = warning;
+      sumWarning += warning;
+      sumFixed += fixed;
+      noChecked++;
+    }
+    if (isOk == false) {
+      if (noErrors < 10) fprintf(stderr, "Fejl: Tog ved %lu msek, %.0f/%.0f mm/sek: advarsel %ld msek, sikret %ld msek før\n",
+        train.switchOnMillis, train.firstSpeed, train.secondSpeed, warning, secure);
+      noErrors++;
+    }
+    if (isLogged == true) printf("%10lu %6.1f %6.1f mm/sek målt %4u: venter %6ld, advarsel %6ld, sikret %6ld, uden måling %6ld msek\n",
+      train.switchOnMillis, train.firstSpeed, train.secondSpeed, train.measuredSpeed, sensorDelay, warning, secure, fixed);
+  }
+
+  bool isOk = (noErrors == 0) && (noChecked > 0);
+  if (isSummary == false) {
+    printf("Varsling %5u msek, margin %2u%%: %lu tog, %3lu målt, advarsel %lu-%lu msek  %s\n", SimTrains::warning, SimTrains::margin,
+      (unsigned long)SimTrains::trains.size(), noChecked, minWarning, maxWarning, (isOk == true)?"OK":"FEJL");
+    return isOk;
+  }
+  printf("Tog:                   %lu på %lu sek, %lu målt og langsomme nok til at vente\n", (unsigned long)SimTrains::trains.size(), endMillis/1000, noChecked);
+  printf("Advarsel:              %lu-%lu msek, middel %.0f msek, krav mindst %u msek  %s\n",
+    minWarning, maxWarning, (noChecked > 0)?sumWarning/noChecked:0.0, SimTrains::warning, (noErrors == 0)?"OK":"FEJL");
+  printf("Uden måling:           middel %.0f msek fra tændsted til overkørsel\n", (noChecked > 0)?sumFixed/noChecked:0.0);
+  printf("Ventede:               %lu tog, %lu tog advaret fra tændsted\n", noAdapted, noFallback);
+  return isOk;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long noTrains = 400;
+  unsigned long seed = 1;
+  bool isLogged = false;
+  bool isSwept = true;
+  bool isValid = true;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-n") == 0) && (cnt+1 < argc)) noTrains = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-s") == 0) && (cnt+1 < argc)) seed = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-v") == 0) && (cnt+1 < argc)) {SimTrains::warning = strtoul(argv[++cnt], nullptr, 10); isSwept = false;}
+    else if ((strcmp(argv[cnt], "-m") == 0) && (cnt+1 < argc)) {SimTrains::margin = strtoul(argv[++cnt], nullptr, 10); isSwept = false;}
+    else if (strcmp(argv[cnt], "-l") == 0) isLogged = true;
+    else isValid = false;
+  }
+  if ((isValid == false) || (noTrains == 0)) {
+    fprintf(stderr, "Brug: %s [-n tog] [-s frø] [-v msek] [-m procent] [-l]\n", argv[0]);
+    return 2;
+  }
+
+  bool isOk = true;
+  if (isSwept == false) isOk = run(noTrains, seed, isLogged, true);
+  else {
+    for (unsigned int warning : SimTrains::Warnings) {
+      for (byte margin : SimTrains::Margins) {
+        SimTrains::warning = warning;
+        SimTrains::margin = margin;
+        fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+          bool isChildOk = run(noTrains, seed, isLogged, false);
+          fflush(stdout);
+          _exit((isChildOk == true)?0:1);
+        }
+        int status = 1;
+        if (child > 0) waitpid(child, &status, 0);
+        if ((child < 0) || (WIFEXITED(status) == false) || (WEXITSTATUS(status) != 0)) isOk = false;
+      }
+    }
+  }
+  printf("Resultat:              %s\n", (isOk == true)?"OK":"FEJL");
+  return (isOk == true)?0:1;
+}
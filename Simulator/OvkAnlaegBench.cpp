@@ -0,0 +1,162 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Måling af anlæg med mange overkørsler
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Kører reference overkørslen fra RefOverkoerselTabel.h som 1 til 10.000 overkørsler i t_CrossingFleet.
+ * Hver overkørsel får samme togplan som ovk_sim, forskudt i tid. Måler tid per klokcyklus og per overkørsel
+ * og sammenligner med én t_Crossing.
+ * Brug: ovk_anlaeg [-t sekunder] [-n overkørsler] [-p togperiode sekunder] [-l]
+ * -l: Logger udgange for én overkørsel i samme format som ovk_sim -l, så de kan sammenlignes.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "RefOverkoerselTabel.h"
+#include "SimScript.h"
+
+const unsigned int MaxNoFleet = 10000;
+typedef t_CrossingFleet<MaxNoFleet> t_Fleet;
+
+// Ansvar: Danner indgange til en overkørsel efter samme togplan som SimScript::addTrainSchedule(...).
+// offset: Forskydning af togplanen i msek
+namespace FleetScript {
+  const byte Idle = (1 << MANUELBETJ) | (1 << TAENDSTED);   // NCLOSED knapper er høje i hvile
+
+  byte inputs(unsigned long atMillis, unsigned long offset, unsigned long period, unsigned long untilMillis) {
+    if (atMillis < 10000+offset) return Idle;
+    unsigned long local = atMillis-10000-offset;
+    unsigned long train = local/period;
+    unsigned long phase = local%period;
+    if (10000+offset+train*period+90000 >= untilMillis) return Idle;
+    byte result = Idle;
+    if ((train % 7) == 6) {
+      if ((phase < 200) || ((phase >= 60000) && (phase < 60200))) result &= ~(1 << MANUELBETJ);
+    }
+    else {
+      if (phase < 60000) result |= (1 << TOGVEJ);
+      if ((phase >= 5000) && (phase < 5300)) result &= ~(1 << TAENDSTED);
+    }
+    return result;
+  }
+}
+
+// Ansvar: Logger ændrede udgange for en overkørsel med ARDPin numre som SimLog i ovk_sim.
+namespace FleetLog {
+  struct t_Map {byte bit; byte pin;};
+  const t_Map Pins[] = {
+    {0, ARDPin.OUSignAB}, {1, ARDPin.OUSignABHvid}, {2, ARDPin.OUSignBA}, {3, ARDPin.OUSignBAHvid},
+    {4, ARDPin.VejLys}, {6, ARDPin.VejKlokker}};
+  unsigned int last = 0;
+
+  void log(unsigned long atMillis, unsigned int output) {
+    for (const t_Map &item : Pins) {
+      unsigned int mask = 1U << item.bit;
+      if (((output ^ last) & mask) != 0) printf("%10lu D%-2u %u\n", atMillis, item.pin, (output & mask) != 0);
+    }
+    last = output;
+  }
+}
+
+void configure(t_Fleet &fleet) {
+  fleet.setTable(Overgange, Handlinger, IKKESIKRET);
+  fleet.setCtrl(MANUELBETJ, NCLOSED, BISTABLE);
+  fleet.setCtrl(TAENDSTED, NCLOSED, ONESHOT);
+  fleet.setCtrl(TOGVEJ, NOPEN);
+  fleet.setDevice(BANESIGNAB, t_Fleet::RAILSIGNAL);
+  fleet.setDevice(BANESIGNBA, t_Fleet::RAILSIGNAL);
+  fleet.setDevice(VEJSIGNAL, t_Fleet::ROADSIGNAL, PASS);
+  fleet.setDevice(VEJKLOKKE, t_Fleet::ROADSIGNAL, PASS);
+  fleet.setDevice(VEJBOM, t_Fleet::BARRIER, PASS);
+  fleet.setBarrierTime(Timing.BarrierTime);
+}
+
+// Måler én t_Crossing fra RefOverkoerselTabel.h på simulatorens kort
+double measureCrossing(unsigned long simSeconds, unsigned long period) {
+  SimScript::addTrainSchedule(simSeconds*1000, period, ARDPin.ManuelKnap, ARDPin.Taendsted, ARDPin.Togvej);
+  setup();
+  double totalNs = 0;
+  unsigned long noTicks = 0;
+  for (unsigned long atMillis = Clock::ClockCycle; atMillis < simSeconds*1000; atMillis += Clock::ClockCycle, noTicks++) {
+    Sim::advanceMicros(atMillis*1000ULL-Sim::clockMicros);
+    Blinker::doClockCycle();
+    auto t0 = std::chrono::steady_clock::now();
+    crossing.doClockCycle();
+    totalNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-t0).count();
+  }
+  return totalNs/noTicks;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long simSeconds = 600;
+  unsigned long trainPeriod = 180;
+  unsigned int maxCrossings = MaxNoFleet;
+  bool logging = false;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-t") == 0) && (cnt+1 < argc)) simSeconds = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-n") == 0) && (cnt+1 < argc)) maxCrossings = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-p") == 0) && (cnt+1 < argc)) trainPeriod = strtoul(argv[++cnt], nullptr, 10);
+    else if (strcmp(argv[cnt], "-l") == 0) logging = true;
+    else {
+      fprintf(stderr, "Brug: %s [-t sekunder] [-n overkørsler] [-p togperiode sekunder] [-l]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (maxCrossings > MaxNoFleet) maxCrossings = MaxNoFleet;
+  unsigned long period = trainPeriod*1000;
+  unsigned long untilMillis = simSeconds*1000;
+
+  if (logging == false) {
+    printf("t_Crossing:           %.1f nsek per klokcyklus\n", measureCrossing(simSeconds, period));
+    printf("RAM per overkørsel:   %u byte\n", (unsigned)(sizeof(t_CrossingFleet<2>)-sizeof(t_CrossingFleet<1>)));
+    printf("%12s %14s %16s %18s %12s\n", "Overkørsler", "nsek/klok", "nsek/overkørsel", "overkørsel-klok/s", "evalueret");
+  }
+  for (unsigned int noCrossings = 1; noCrossings <= maxCrossings; noCrossings *= 10) {
+    t_Fleet *fleet = new t_Fleet();
+    configure(*fleet);
+    for (unsigned int cnt = 0; cnt < noCrossings; cnt++) fleet->add();
+    if (logging == true) FleetLog::log(0, fleet->outputOf(0));
+    double totalNs = 0;
+    unsigned long long noEvaluated = 0;
+    unsigned long noTicks = 0;
+    for (unsigned long atMillis = Clock::ClockCycle; atMillis < untilMillis; atMillis += Clock::ClockCycle, noTicks++) {
+      for (unsigned int index = 0; index < noCrossings; index++) {
+        // Forskudte togplaner, så overkørslerne ikke skifter samtidigt
+        unsigned long offset = (index*7919UL)%period;
+        fleet->setInput(index, FleetScript::inputs(atMillis, offset, period, untilMillis));
+      }
+      Blinker::doClockCycle();
+      auto t0 = std::chrono::steady_clock::now();
+      fleet->doClockCycle();
+      totalNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-t0).count();
+      noEvaluated += fleet->dispatchCount();
+      if (logging == true) FleetLog::log(atMillis, fleet->outputOf(0));
+    }
+    delete fleet;
+    if (logging == true) return 0;
+    double perTick = totalNs/noTicks;
+    printf("%12u %14.1f %16.2f %18.3g %12.4f\n", noCrossings, perTick, perTick/noCrossings,
+           noCrossings*1e9/perTick, (double)noEvaluated/noTicks/noCrossings);
+  }
+  return 0;
+}
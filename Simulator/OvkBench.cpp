@@ -0,0 +1,484 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Mikrobenchmark af bibliotekets varme stier
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Måler tid per kald for de funktioner, som kaldes i hver klokcyklus, og for hele crossing.doClockCycle().
+ * Hver måling kalibreres til runder på 2 msek og gentages 11 gange. Medianen er det stabile tal, min og maks viser spredning.
+ * Processoren holdes i gang i 0,3 sek før første måling, så klokfrekvensen er steget.
+ * Komponenterne bliver målt på egne objekter på ben 12-16, så reference overkørslens objekter ikke bliver forstyrret.
+ * t_PushButton og udgangsdrivere bruger simulatorens digitalRead og digitalWrite, som ikke koster det samme som på en Uno.
+ * sizeof er målt på Linux, hvor pointere er 8 byte. Med -m læses et linker map, for eksempel ovk_firmware.map
+ * eller et map fra Arduino IDE med -Wl,-Map, og flash og RAM summeres per klasse.
+ * Brug: ovk_bench [-j] [-s] [-m mapfil] [-c basisfil]
+ * -j: Skriver resultatet som JSON med en måling per linje.
+ * -s: Kun størrelser fra sizeof og map, uden tidsmålinger.
+ * -c: Sammenligner med en tidligere JSON udskrift og viser ændring i procent.
+ * ovk_bench_statisk og ovk_bench_tabel måler RefOverkoerselStatisk.h og RefOverkoerselTabel.h.
+ * ovk_bench_kompakt måler RefOverkoersel.h med BrugKompakt. ovk_kompakt sammenligner størrelser per komponent med og uden.
+ * ovk_bench_oscillator måler RefOverkoersel.h med BrugOscillatorbank, hvor signaler læser niveau fra Oscillator.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cxxabi.h>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#if defined(BrugStatiskOverkoersel)
+#include "RefOverkoerselStatisk.h"
+const char SketchName[] = "RefOverkoerselStatisk";
+#elif defined(BrugTilstandstabel)
+#include "RefOverkoerselTabel.h"
+const char SketchName[] = "RefOverkoerselTabel";
+#else
+#include "RefOverkoersel.h"
+const char SketchName[] = "RefOverkoersel";
+#endif
+#include "SimScript.h"
+
+// Ansvar: Måler tid per kald.
+// Rounds: Antal runder. Medianen bliver rapporteret
+// RoundNs: Mindste varighed af en runde, så urets opløsning ikke betyder noget
+// sink: Resultater skrives hertil, så oversætteren ikke fjerner kaldene
+// t_Result: Median, min og maks i nsek per kald og antal kald per runde
+// run(...): Kalder body et antal gange og leverer nsek
+// measure(...): Kalibrerer antal kald per runde og måler
+// add(...): Tilføjer et resultat målt på anden vis
+// warmUp(...): Holder processoren i gang, indtil dens klokfrekvens er steget, før første måling
+namespace Bench {
+  const unsigned int Rounds = 11;
+  const double RoundNs = 2e6;
+  const double WarmUpNs = 3e8;
+  volatile unsigned long sink = 0;
+
+  struct t_Result {
+    std::string name;
+    double medianNs;
+    double minNs;
+    double maxNs;
+    unsigned long calls;
+  };
+  std::vector<t_Result> results;
+
+  template <typename F>
+  double run(F &body, unsigned long calls) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned long cnt = 0; cnt < calls; cnt++) body(cnt);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-t0).count();
+  }
+
+  void add(const char *name, std::vector<double> perCall, unsigned long calls) {
+    std::sort(perCall.begin(), perCall.end());
+    results.push_back(t_Result{name, perCall[perCall.size()/2], perCall.front(), perCall.back(), calls});
+  }
+
+  void warmUp(void) {
+    auto t0 = std::chrono::steady_clock::now();
+    unsigned long cnt = 0;
+    while (std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-t0).count() < WarmUpNs) sink = cnt++;
+  }
+
+  template <typename F>
+  void measure(const char *name, F body) {
+    unsigned long calls = 1;
+    while (run(body, calls) < RoundNs) calls *= 2;
+    std::vector<double> perCall;
+    for (unsigned int round = 0; round < Rounds; round++) perCall.push_back(run(body, calls)/calls);
+    add(name, perCall, calls);
+  }
+}
+
+// Blinker udløser hver blinkCycles klokcyklus. Med oscillatorbank skifter niveauerne i samme takt
+void blinkAt(unsigned long cnt, unsigned long blinkCycles) {
+#ifndef BrugOscillatorbank
+  Blinker::triggered = ((cnt % blinkCycles) == 0);
+#else
+  Oscillator::toggled = ((cnt % blinkCycles) == 0)?0xFF:0;
+  Oscillator::levels = ((cnt/blinkCycles) & 1)?0xFF:0;
+#endif
+}
+
+// Komponenterne i hver deres typiske klokcyklus
+void measureParts(void) {
+  Bench::measure("tom løkke", [](unsigned long cnt) {Bench::sink = cnt;});
+
+  static t_ClockWork clockWork(1000);
+  Bench::measure("t_ClockWork::triggered", [](unsigned long) {Bench::sink = clockWork.triggered();});
+  Bench::measure("Blinker::doClockCycle", [](unsigned long) {
+    Blinker::doClockCycle();
+    Bench::sink = Blinker::triggered;
+  });
+
+  // Et tryk per 16 kald
+  static t_FlipFlop flipFlop(NCLOSED);
+  Bench::measure("t_FlipFlop::update", [](unsigned long cnt) {
+    flipFlop.update((cnt & 15) != 0);
+    Bench::sink = flipFlop.bistable();
+  });
+
+  // Knap i hvile, som i langt de fleste klokcyklusser
+  static t_PushButton button(12, NCLOSED);
+  Bench::measure("t_PushButton::doClockCycle", [](unsigned long) {
+    button.doClockCycle();
+    Bench::sink = button.read();
+  });
+
+  static t_FlipFlop ctrlFlipFlop(NCLOSED);
+  static t_CrossingCtrl ctrl;
+  ctrl.setDriver(&button);
+  ctrl.setFlipFlop(&ctrlFlipFlop);
+  Bench::measure("t_CrossingCtrl::status", [](unsigned long) {Bench::sink = ctrl.status();});
+
+  // Blinker udløser hver 200. klokcyklus, som med Blinker::Period
+  const unsigned long BlinkCycles = Blinker::Period/Clock::ClockCycle;
+  static t_SimpleOnOff railDrv(13, HIGH);
+  static t_SimpleOnOff whiteDrv(14);
+  static t_RailSignal railSignal;
+  railSignal.setDriver(&railDrv);
+  railSignal.setWhiteLamp(&whiteDrv);
+  railSignal.to(PASS);
+  Bench::measure("t_RailSignal::doClockCycle", [BlinkCycles](unsigned long cnt) {
+    blinkAt(cnt, BlinkCycles);
+    railSignal.doClockCycle();
+  });
+
+  static t_SimpleOnOff roadDrv(15);
+  static t_RoadSignal roadSignal(PASS);
+  roadSignal.setDriver(&roadDrv);
+  roadSignal.to(BLOCK);
+  Bench::measure("t_RoadSignal::doClockCycle", [BlinkCycles](unsigned long cnt) {
+    blinkAt(cnt, BlinkCycles);
+    roadSignal.doClockCycle();
+  });
+  blinkAt(1, BlinkCycles);
+
+  // Bommen vender, når en vandring er færdig, så servoen er i gang i næsten alle kald
+  const unsigned long SweepCalls = Timing.BarrierTime/Clock::ClockCycle+2;
+  static t_ServoMotor servo(HIGH);
+  servo.startMotor(16, Timing.AngleAdjust, Timing.BarrierTime);
+  Bench::measure("t_ServoMotor::doClockCycle", [SweepCalls](unsigned long cnt) {
+    if ((cnt % SweepCalls) == 0) servo.write(((cnt/SweepCalls) & 1)?HIGH:LOW);
+    servo.doClockCycle();
+  });
+}
+
+// Hele overkørslen i simulatorens virtuelle tid. Hver klokcyklus bliver målt for sig, og urets eget forbrug trækkes fra.
+// Hvile: Klokcyklusser før første tog, i runder af 180. Togplan: Et tog per runde på 180 sek som i ovk_sim
+void measureCrossing(void) {
+  const unsigned long TrainPeriod = 180000;
+  const unsigned long FirstTrain = 10000;
+  const unsigned long IdleCycles = 180;
+  const unsigned long SimMillis = 3600000;
+  std::vector<double> overhead;
+  for (unsigned int round = 0; round < Bench::Rounds; round++) {
+    const unsigned long Calls = 100000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned long cnt = 0; cnt < Calls; cnt++) {
+      auto t1 = std::chrono::steady_clock::now();
+      Bench::sink = t1.time_since_epoch().count();
+    }
+    overhead.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-t0).count()/Calls);
+  }
+  std::sort(overhead.begin(), overhead.end());
+  double clockNs = overhead[overhead.size()/2];
+
+  SimScript::addTrainSchedule(SimMillis, TrainPeriod, ARDPin.ManuelKnap, ARDPin.Taendsted, ARDPin.Togvej);
+  setup();
+  const unsigned long TrainCycles = TrainPeriod/Clock::ClockCycle;
+  std::vector<double> idle, schedule;
+  double roundNs = 0;
+  unsigned long roundCycles = 0;
+  unsigned long noTrains = (SimMillis-FirstTrain)/TrainPeriod;
+  for (unsigned long atMillis = Clock::ClockCycle; atMillis < FirstTrain+noTrains*TrainPeriod; atMillis += Clock::ClockCycle) {
+    Sim::advanceMicros(atMillis*1000ULL-Sim::clockMicros);
+    Blinker::doClockCycle();
+    auto t0 = std::chrono::steady_clock::now();
+    crossing.doClockCycle();
+    roundNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-t0).count()-clockNs;
+    roundCycles++;
+    std::vector<double> &rounds = (atMillis < FirstTrain)?idle:schedule;
+    if ((roundCycles == ((atMillis < FirstTrain)?IdleCycles:TrainCycles)) || (atMillis+Clock::ClockCycle == FirstTrain)) {
+      // Den ufuldstændige runde lige før første tog bliver ikke brugt
+      if ((roundCycles == IdleCycles) || (atMillis >= FirstTrain)) rounds.push_back(roundNs/roundCycles);
+      roundNs = 0;
+      roundCycles = 0;
+    }
+  }
+  Bench::add("crossing.doClockCycle hvile", idle, IdleCycles);
+  Bench::add("crossing.doClockCycle togplan", schedule, TrainCycles);
+}
+
+//----------
+
+// Ansvar: Størrelse af bibliotekets klasser og af reference overkørslens objekter.
+namespace Sizes {
+  struct t_Size {
+    const char *name;
+    unsigned int bytes;
+  };
+  const t_Size List[] = {
+    {"t_ClockWork", sizeof(t_ClockWork)},
+    {"t_FlipFlop", sizeof(t_FlipFlop)},
+    {"t_PushButton", sizeof(t_PushButton)},
+    {"t_SimpleOnOff", sizeof(t_SimpleOnOff)},
+    {"t_ServoMotor", sizeof(t_ServoMotor)},
+    {"t_CrossingCtrl", sizeof(t_CrossingCtrl)},
+    {"t_RailSignal", sizeof(t_RailSignal)},
+    {"t_RoadSignal", sizeof(t_RoadSignal)},
+    {"t_Barrier", sizeof(t_Barrier)},
+    {"t_Report", sizeof(t_Report)},
+    {"crossing", sizeof(crossing)},
+#ifndef BrugStatiskOverkoersel
+    {"collection", sizeof(collection)},
+#endif
+  };
+}
+
+// Ansvar: Læser et linker map fra GNU ld og summerer flash og RAM per klasse.
+// Kræver -ffunction-sections og -fdata-sections, så hver funktion og variabel har sin egen sektion med sit navn.
+// Kun sektioner fra objektfiler tælles, ikke fra biblioteker (.a), så Arduino kernen og libc er udeladt.
+// .text, .rodata og .progmem ligger i flash, .bss i RAM og .data begge steder.
+// Klassen er navnet før sidste :: i det afkodede navn. Globale variable står under deres eget navn.
+// t_Usage: Byte i flash og RAM
+// className(...): Klasse for et sektionsnavn
+// load(...): Læser map. Leverer falsk hvis filen ikke kan læses
+namespace MapFile {
+  struct t_Usage {
+    unsigned long flash = 0;
+    unsigned long ram = 0;
+  };
+  std::map<std::string, t_Usage> classes;
+
+  std::string className(const std::string &symbol) {
+    if (symbol.compare(0, 15, "_GLOBAL__sub_I_") == 0) return "(initialisering)";
+    std::string name = symbol;
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(symbol.c_str(), nullptr, nullptr, &status);
+    if ((status == 0) && (demangled != nullptr)) name = demangled;
+    free(demangled);
+    // Typeinfo, vtable og guard hører til klassen eller variablen de beskriver
+    const char *Described[] = {"typeinfo name for ", "typeinfo for ", "vtable for ", "guard variable for "};
+    for (const char *prefix : Described) {
+      if (name.compare(0, strlen(prefix), prefix) == 0) {
+        name = name.substr(strlen(prefix));
+        break;
+      }
+    }
+    // Parametre og skabelonparametre fjernes, før sidste :: findes
+    std::string plain;
+    int depth = 0;
+    for (char ch : name) {
+      if ((ch == '(') && (depth == 0)) break;
+      if (ch == '<') depth++;
+      if ((depth == 0) && (ch != '>')) plain += ch;
+      if (ch == '>') depth--;
+    }
+    size_t pos = plain.rfind("::");
+    if (pos != std::string::npos) plain = plain.substr(0, pos);
+    return plain;
+  }
+
+  bool load(const char *fileName) {
+    FILE *file = fopen(fileName, "r");
+    if (file == nullptr) return false;
+    char line[1024];
+    bool inMap = false;
+    std::string section;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      if (strncmp(line, "Linker script and memory map", 28) == 0) inMap = true;
+      if (inMap == false) continue;
+      char name[512], objectName[512];
+      unsigned long address, size;
+      // Sektionsnavnet står alene på en linje, når det er langt, og adresse, størrelse og fil står på næste linje
+      if ((line[0] == ' ') && (line[1] == '.') && (line[2] != ' ')) {
+        if (sscanf(line, " %511s 0x%lx 0x%lx %511s", name, &address, &size, objectName) != 4) {
+          section = name;
+          continue;
+        }
+        section = name;
+      }
+      else if ((section.empty() == false) && (sscanf(line, " 0x%lx 0x%lx %511s", &address, &size, objectName) == 3)) {}
+      else {
+        section.clear();
+        continue;
+      }
+      std::string object = objectName;
+      std::string current = section;
+      section.clear();
+      if ((size == 0) || (object.find(".a(") != std::string::npos) || (object.find(".o") == std::string::npos)) continue;
+      const char *Kinds[] = {".text.", ".rodata.", ".progmem.data.", ".data.", ".bss."};
+      for (byte kind = 0; kind < 5; kind++) {
+        size_t length = strlen(Kinds[kind]);
+        if (current.compare(0, length, Kinds[kind]) != 0) continue;
+        std::string symbol = current.substr(length);
+        // Oversætteren sætter ekstra led på nogle sektioner, for eksempel .text.startup. og .data.rel.ro.local.
+        const char *Extras[] = {"startup.", "unlikely.", "hot.", "rel.ro.local.", "rel.ro.", "rel.local.", "rel."};
+        if ((symbol == "rel.ro.local") || (symbol == "rel.ro") || (symbol == "rel.local")) symbol = "(diverse)";
+        for (const char *extra : Extras) {
+          if (symbol.compare(0, strlen(extra), extra) == 0) {
+            symbol = symbol.substr(strlen(extra));
+            break;
+          }
+        }
+        t_Usage &usage = classes[(kind == 1) && (symbol.compare(0, 3, "str") == 0)?"(tekster)":className(symbol)];
+        if (kind <= 3) usage.flash += size;
+        if (kind >= 3) usage.ram += size;
+        break;
+      }
+    }
+    fclose(file);
+    return true;
+  }
+}
+
+//----------
+
+// Ansvar: Sammenligner med en tidligere JSON udskrift fra ovk_bench -j.
+// Hver linje med "name" og et tal bliver læst. Tal med samme navn og nøgle sammenlignes.
+namespace Baseline {
+  std::map<std::string, double> values;
+
+  bool number(const char *line, const char *key, double &value) {
+    const char *pos = strstr(line, key);
+    return (pos != nullptr) && (sscanf(pos+strlen(key), " : %lf", &value) == 1);
+  }
+
+  bool load(const char *fileName) {
+    FILE *file = fopen(fileName, "r");
+    if (file == nullptr) return false;
+    char line[512];
+    const char *Keys[] = {"\"median_ns\"", "\"bytes\"", "\"flash\"", "\"ram\""};
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      const char *pos = strstr(line, "\"name\": \"");
+      if (pos == nullptr) continue;
+      pos += 9;
+      const char *end = strchr(pos, '"');
+      if (end == nullptr) continue;
+      std::string name(pos, end-pos);
+      double value;
+      for (const char *key : Keys) if (number(line, key, value) == true) values[name+" "+key] = value;
+    }
+    fclose(file);
+    return true;
+  }
+
+  void compare(FILE *out, const std::string &name, const char *key, double now) {
+    auto item = values.find(name+" "+key);
+    if (item == values.end()) return;
+    double change = (item->second != 0)?(now-item->second)*100/item->second:0;
+    fprintf(out, "  %-34s %-11s %10.2f -> %10.2f  %+6.1f %%\n", name.c_str(), key, item->second, now, change);
+  }
+}
+
+//----------
+
+void printJson(bool withMap) {
+  printf("{\n  \"program\": \"ovk_bench\",\n  \"sketch\": \"%s\",\n  \"results\": [\n", SketchName);
+  for (size_t cnt = 0; cnt < Bench::results.size(); cnt++) {
+    const Bench::t_Result &item = Bench::results[cnt];
+    printf("    {\"name\": \"%s\", \"median_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f, \"calls\": %lu}%s\n", item.name.c_str(),
+           item.medianNs, item.minNs, item.maxNs, item.calls, (cnt+1 < Bench::results.size())?",":"");
+  }
+  printf("  ],\n  \"sizeof\": [\n");
+  size_t noSizes = sizeof(Sizes::List)/sizeof(Sizes::List[0]);
+  for (size_t cnt = 0; cnt < noSizes; cnt++) {
+    printf("    {\"name\": \"%s\", \"bytes\": %u}%s\n", Sizes::List[cnt].name, Sizes::List[cnt].bytes, (cnt+1 < noSizes)?",":"");
+  }
+  printf("  ]%s\n", withMap?",\n  \"map\": [":"");
+  if (withMap == true) {
+    size_t cnt = 0;
+    for (const auto &item : MapFile::classes) {
+      printf("    {\"name\": \"%s\", \"flash\": %lu, \"ram\": %lu}%s\n", item.first.c_str(), item.second.flash, item.second.ram,
+             (++cnt < MapFile::classes.size())?",":"");
+    }
+    printf("  ]\n");
+  }
+  printf("}\n");
+}
+
+void printTable(bool withMap) {
+  printf("Program: %s\n", SketchName);
+  if (Bench::results.empty() == false) {
+    printf("%-34s %10s %10s %10s %10s\n", "Måling", "median ns", "min ns", "maks ns", "kald");
+    for (const Bench::t_Result &item : Bench::results) {
+      printf("%-34s %10.2f %10.2f %10.2f %10lu\n", item.name.c_str(), item.medianNs, item.minNs, item.maxNs, item.calls);
+    }
+    printf("\n");
+  }
+  printf("sizeof på Linux:\n");
+  for (const Sizes::t_Size &item : Sizes::List) printf("  %-32s %6u byte\n", item.name, item.bytes);
+  if (withMap == true) {
+    printf("\nFra linker map:\n  %-32s %8s %8s\n", "Klasse", "flash", "RAM");
+    for (const auto &item : MapFile::classes) {
+      printf("  %-32s %8lu %8lu\n", item.first.c_str(), item.second.flash, item.second.ram);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  bool json = false;
+  bool sizesOnly = false;
+  const char *mapName = nullptr;
+  const char *baseName = nullptr;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if (strcmp(argv[cnt], "-j") == 0) json = true;
+    else if (strcmp(argv[cnt], "-s") == 0) sizesOnly = true;
+    else if ((strcmp(argv[cnt], "-m") == 0) && (cnt+1 < argc)) mapName = argv[++cnt];
+    else if ((strcmp(argv[cnt], "-c") == 0) && (cnt+1 < argc)) baseName = argv[++cnt];
+    else {
+      fprintf(stderr, "Brug: %s [-j] [-s] [-m mapfil] [-c basisfil]\n", argv[0]);
+      return 2;
+    }
+  }
+  if ((mapName != nullptr) && (MapFile::load(mapName) == false)) {
+    fprintf(stderr, "Kan ikke læse map: %s\n", mapName);
+    return 1;
+  }
+  if ((baseName != nullptr) && (Baseline::load(baseName) == false)) {
+    fprintf(stderr, "Kan ikke læse basis: %s\n", baseName);
+    return 1;
+  }
+
+  if (sizesOnly == false) {
+    Bench::warmUp();
+    measureParts();
+    measureCrossing();
+  }
+
+  if (json == true) printJson(mapName != nullptr);
+  else printTable(mapName != nullptr);
+  if (baseName != nullptr) {
+    // Med JSON skrives sammenligningen til stderr, så udskriften stadig kan læses af et program
+    FILE *out = (json == true)?stderr:stdout;
+    fprintf(out, "\nÆndring fra %s:\n", baseName);
+    for (const Bench::t_Result &item : Bench::results) Baseline::compare(out, item.name, "\"median_ns\"", item.medianNs);
+    for (const Sizes::t_Size &item : Sizes::List) Baseline::compare(out, item.name, "\"bytes\"", item.bytes);
+    for (const auto &item : MapFile::classes) {
+      Baseline::compare(out, item.first, "\"flash\"", item.second.flash);
+      Baseline::compare(out, item.first, "\"ram\"", item.second.ram);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Reference overkørsel oversat som firmware
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Svarer til Arduino kernens main(). Programmet bliver ikke kørt, kun målt med size.
+ * Oversat med BrugStatiskOverkoersel bruges RefOverkoerselStatisk.h, med BrugTilstandstabel RefOverkoerselTabel.h
+ * og med BrugKonfiguration RefOverkoerselKonfig.h.
+ */
+
+#if defined(BrugStatiskOverkoersel)
+#include "RefOverkoerselStatisk.h"
+#elif defined(BrugTilstandstabel)
+#include "RefOverkoerselTabel.h"
+#elif defined(BrugKonfiguration)
+#include "RefOverkoerselKonfig.h"
+#else
+#include "RefOverkoersel.h"
+#endif
+
+int main(void) {
+  setup();
+  for (;;) loop();
+  return 0;
+}
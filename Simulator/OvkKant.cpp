@@ -0,0 +1,268 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Kontrol af kantfangst med pinskift interrupt
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Kontrollerer EdgeCapture og t_EdgeInput fra OvkKant.h i 2 dele.
+ * Kø: En tråd spiller interrupt og lægger byger af kanter i køen med EdgeCapture::capture(), mens hovedtråden
+ * tømmer den med pauser som en klokcyklus. Hver kant der kom i køen, skal komme ud i samme rækkefølge,
+ * og kanter der ikke var plads til, skal være talt som tabt.
+ * Pulser: I virtuel tid får en t_EdgeInput og en t_PushButton samme puls på hver sit ben, hver med en flipflop.
+ * Pulserne er fra 0,2 til 40 msek og starter forskellige steder i klokcyklus, med og uden kontaktprel i begge ender.
+ * Kantfangst skal skifte flipflop præcis én gang per puls med tidsstempel lig pulsens start.
+ * Brug: ovk_kant [-b byger] [-s frø]
+ * Afslutter med 0 når alle kontroller passer og 1 ved fejl.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// Som i en .ino fil
+#include <Arduino.h>
+enum {MSEC, SECONDS};
+enum {NOPEN, NCLOSED};
+enum {BISTABLE, ONESHOT};
+enum {OFF, ON};
+enum {BLOCK, PASS};
+const byte MaxNoCtrls = 1;
+const byte MaxNoDevices = 1;
+const byte MaxNoStates = 1;
+#define BrugKantfangst
+#include <Ovkoersel.h>
+
+// Nulstiller EdgeCapture mellem delene
+void resetCapture(void) {
+  using namespace EdgeCapture;
+  noInputs = 0;
+  head = tail = 0;
+  overflowed = false;
+  noEdges = noOverflows = 0;
+  maxUsed = 0;
+}
+
+// Ansvar: Kø mellem en tråd der spiller interrupt og hovedtråden.
+// t_Logged: Kant som den blev lagt i og læst fra køen
+// produced, consumed: Kanter som kom i køen og kanter som blev læst, i rækkefølge
+// run(...): Kører et antal byger og leverer om alle kanter kom ud uændret
+namespace QueueCheck {
+  struct t_Logged {
+    unsigned long atMicros;
+    byte input;
+    bool level;
+    bool operator==(const t_Logged &other) const {return (atMicros == other.atMicros) && (input == other.input) && (level == other.level);}
+  };
+  std::vector<t_Logged> produced;
+  std::vector<t_Logged> consumed;
+
+  bool run(unsigned long noBursts, unsigned long seed) {
+    resetCapture();
+    EdgeCapture::noInputs = EdgeCapture::MaxNoInputs;
+    for (byte index=0; index < EdgeCapture::MaxNoInputs; index++) EdgeCapture::inputs[index] = EdgeCapture::t_Input();
+    std::atomic<bool> done(false);
+    auto start = std::chrono::steady_clock::now();
+
+    // Interrupt: Byger på op til 2 gange køens størrelse med kort og tilfældig pause imellem
+    std::thread isr([&]() {
+      std::mt19937 random(seed);
+      std::uniform_int_distribution<int> burstLength(1, 2*EdgeCapture::Size);
+      std::uniform_int_distribution<int> pick(0, EdgeCapture::MaxNoInputs-1);
+      std::uniform_int_distribution<int> gap(1, 50);
+      std::uniform_int_distribution<int> pause(0, 200);
+      bool level[EdgeCapture::MaxNoInputs] = {};
+      unsigned long atMicros = 0;
+      for (unsigned long burst=0; burst < noBursts; burst++) {
+        for (int cnt = burstLength(random); cnt > 0; cnt--) {
+          byte input = pick(random);
+          level[input] = !level[input];
+          atMicros += gap(random);
+          unsigned long noOverflows = EdgeCapture::overflowCount();
+          EdgeCapture::capture(input, level[input], atMicros);
+          if (EdgeCapture::overflowCount() == noOverflows) produced.push_back(t_Logged{atMicros, input, level[input]});
+        }
+        auto until = std::chrono::steady_clock::now()+std::chrono::microseconds(pause(random));
+        while (std::chrono::steady_clock::now() < until) std::this_thread::yield();
+      }
+      done = true;
+    });
+
+    // Klokcyklus: Tømmer køen og holder af og til pause, så køen kan løbe fuld
+    std::mt19937 random(seed+1);
+    std::uniform_int_distribution<int> pause(0, 300);
+    EdgeCapture::t_Edge edge;
+    bool isDone = false;
+    while (isDone == false) {
+      isDone = done;
+      while (EdgeCapture::pop(edge) == true) consumed.push_back(t_Logged{edge.atMicros, edge.input, edge.level});
+      auto until = std::chrono::steady_clock::now()+std::chrono::microseconds(pause(random));
+      while (std::chrono::steady_clock::now() < until) std::this_thread::yield();
+    }
+    isr.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    bool isOk = (produced == consumed) && (produced.size()+EdgeCapture::overflowCount() == EdgeCapture::edgeCount());
+    printf("Kø:                    %lu byger, %lu kanter på %.2f sek\n", noBursts, EdgeCapture::edgeCount(), seconds);
+    printf("  I kø og læst:        %zu af %zu i samme rækkefølge  %s\n", consumed.size(), produced.size(), (produced == consumed)?"OK":"FEJL");
+    printf("  Tabt, kø fuld:       %lu, i alt %zu  %s\n", EdgeCapture::overflowCount(), produced.size()+EdgeCapture::overflowCount(),
+      (produced.size()+EdgeCapture::overflowCount() == EdgeCapture::edgeCount())?"OK":"FEJL");
+    return isOk;
+  }
+}
+
+// Ansvar: Korte pulser på et tændsted i virtuel tid.
+// EdgePin, ButtonPin: Ben til t_EdgeInput og t_PushButton. Begge er NCLOSED, så en puls er lav
+// t_Result: Pulser, skift af flipflop og største afvigelse af tidsstempel per pulsbredde
+// pulse(...): Kører én puls fra en klokcyklus start og 200 msek frem og tæller skift af flipflop
+namespace PulseCheck {
+  const byte EdgePin = 12;
+  const byte ButtonPin = 11;
+  const unsigned long CycleMicros = Clock::ClockCycle*1000UL;
+  struct t_Result {
+    unsigned long noPulses;
+    unsigned long edgeToggles;
+    unsigned long buttonToggles;
+    unsigned long edgeErrors;
+    unsigned long maxStampError;
+  };
+
+  void onInput(byte pin, byte) {EdgeCapture::onPinChange(digitalPinToPort(pin));}
+
+  void setBoth(unsigned long long atMicros, byte level) {
+    Sim::advanceMicros(atMicros-Sim::clockMicros);
+    Sim::setInput(EdgePin, level);
+    Sim::setInput(ButtonPin, level);
+  }
+
+  void pulse(t_EdgeInput &edgeDrv, t_PushButton &buttonDrv, t_FlipFlop &edgeFF, t_FlipFlop &buttonFF,
+             unsigned long phase, unsigned long width, bool bounce, t_Result &result) {
+    unsigned long long cycleStart = (Sim::clockMicros/CycleMicros+1)*CycleMicros;
+    unsigned long long startMicros = cycleStart+phase;
+    if (width < 1000) bounce = false;
+    std::vector<std::pair<unsigned long long, byte>> edges;
+    edges.push_back({startMicros, LOW});
+    if (bounce == true) for (byte cnt=1; cnt <= 4; cnt++) edges.push_back({startMicros+cnt*100, (cnt & 1)?HIGH:LOW});
+    edges.push_back({startMicros+width, HIGH});
+    if (bounce == true) for (byte cnt=1; cnt <= 4; cnt++) edges.push_back({startMicros+width+cnt*100, (cnt & 1)?LOW:HIGH});
+    bool edgeBefore = edgeFF.bistable();
+    bool buttonBefore = buttonFF.bistable();
+    unsigned long edgeToggles = 0, buttonToggles = 0;
+    unsigned long stamp = 0;
+    bool isStamped = false;
+    size_t next = 0;
+    for (unsigned long long tick = cycleStart; tick < startMicros+width+200000; tick += CycleMicros) {
+      while ((next < edges.size()) && (edges[next].first < tick)) {
+        setBoth(edges[next].first, edges[next].second);
+        next++;
+      }
+      Sim::advanceMicros(tick-Sim::clockMicros);
+      EdgeCapture::doClockCycle();
+      edgeDrv.doClockCycle();
+      buttonDrv.doClockCycle();
+      edgeFF.update(edgeDrv.read());
+      buttonFF.update(buttonDrv.read());
+      if ((isStamped == false) && (edgeDrv.read() == LOW)) {
+        stamp = edgeDrv.changedMicros();
+        isStamped = true;
+      }
+      if (edgeFF.bistable() != edgeBefore) {
+        edgeToggles++;
+        edgeBefore = edgeFF.bistable();
+      }
+      if (buttonFF.bistable() != buttonBefore) {
+        buttonToggles++;
+        buttonBefore = buttonFF.bistable();
+      }
+    }
+    int32_t offset = stamp-startMicros;   // micros() løber rundt ved 32 bit
+    unsigned long stampError = (isStamped == true)?(unsigned long)abs(offset):CycleMicros;
+    result.noPulses++;
+    result.edgeToggles += edgeToggles;
+    result.buttonToggles += (buttonToggles > 0);
+    if ((edgeToggles != 1) || (stampError != 0)) result.edgeErrors++;
+    if (stampError > result.maxStampError) result.maxStampError = stampError;
+  }
+
+  bool run(void) {
+    const unsigned long Widths[] = {200, 500, 1000, 2000, 3000, 4000, 5000, 8000, 12000, 20000, 40000};
+    const unsigned long Phases[] = {100, 1700, 2900, 4400, 4950};
+    bool isOk = true;
+    resetCapture();
+    Sim::reset();
+    Sim::onInput = onInput;
+    t_EdgeInput edgeDrv(EdgePin, NCLOSED);
+    t_PushButton buttonDrv(ButtonPin, NCLOSED);
+    t_FlipFlop edgeFF(NCLOSED);
+    t_FlipFlop buttonFF(NCLOSED);
+    printf("Pulser:                puls msek, fanget af kantfangst og trykknap, afvigelse af tidsstempel\n");
+    for (unsigned long width: Widths) {
+      t_Result result = {};
+      for (bool bounce: {false, true})
+        for (unsigned long phase: Phases) pulse(edgeDrv, buttonDrv, edgeFF, buttonFF, phase, width, bounce, result);
+      printf("  %5.1f msek:          %lu/%lu skift, trykknap %lu/%lu, tidsstempel %lu µsek  %s\n", width/1000.0,
+        result.edgeToggles, result.noPulses, result.buttonToggles, result.noPulses, result.maxStampError, (result.edgeErrors == 0)?"OK":"FEJL");
+      if (result.edgeErrors != 0) isOk = false;
+    }
+    printf("  Kanter:              %lu fanget, %lu tabt, højst %u af %u i kø\n", EdgeCapture::edgeCount(), EdgeCapture::overflowCount(), EdgeCapture::maxUsed, EdgeCapture::Size);
+
+    // Prel med flere kanter end køen har plads til. Værdien skal følge benet, når HoldTime er gået
+    bool levels[2];
+    for (byte level: {LOW, HIGH}) {
+      unsigned long long atMicros = (Sim::clockMicros/CycleMicros+1)*CycleMicros+300;
+      for (byte cnt=0; cnt < 3*EdgeCapture::Size; cnt++) setBoth(atMicros+cnt*20, (cnt & 1)?level:!level);
+      setBoth(atMicros+3*EdgeCapture::Size*20, level);
+      for (byte cnt=0; cnt < 2*EdgeCapture::HoldTime/Clock::ClockCycle+2; cnt++) {
+        Sim::advanceMicros(CycleMicros);
+        EdgeCapture::doClockCycle();
+        edgeDrv.doClockCycle();
+      }
+      levels[level] = (edgeDrv.read() == level);
+    }
+    bool isSynced = (levels[LOW] == true) && (levels[HIGH] == true) && (EdgeCapture::overflowCount() > 0);
+    printf("Kø fuld ved prel:      %lu tabt, værdi følger benet  %s\n", EdgeCapture::overflowCount(), (isSynced == true)?"OK":"FEJL");
+    Sim::onInput = nullptr;
+    isOk = isOk && isSynced;
+    return isOk;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long noBursts = 20000;
+  unsigned long seed = 1;
+  bool isValid = true;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-b") == 0) && (cnt+1 < argc)) noBursts = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-s") == 0) && (cnt+1 < argc)) seed = strtoul(argv[++cnt], nullptr, 10);
+    else isValid = false;
+  }
+  if ((isValid == false) || (noBursts == 0)) {
+    fprintf(stderr, "Brug: %s [-b byger] [-s frø]\n", argv[0]);
+    return 2;
+  }
+  bool isOk = QueueCheck::run(noBursts, seed);
+  isOk = PulseCheck::run() && isOk;
+  printf("Resultat:              %s\n", (isOk == true)?"OK":"FEJL");
+  return (isOk == true)?0:1;
+}
@@ -0,0 +1,285 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Kontrol af lysdæmper med bitvinkelmodulation mod simuleret timer
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Kører RefOverkoersel.h med t_DimmedLamp til overkørselssignaler og vejlys og en togplan i virtuel tid.
+ * Simulatoren kalder LampDimmer::onCompare(), når timer 2 når OCR2A, og registrerer lampernes kanter.
+ * Kontrol: Hver hel ramme varer 255 enheder, og hver lampe er tændt præcis sit niveau i enheder.
+ * Hver ramme har LampDimmer::Bits interrupts. Vejklokken på samme port bliver ikke skrevet af interrupt.
+ * Niveauet bevæger sig kun mod lampens mål, og tænd og sluk er færdig inden for tiden givet til t_DimmedLamp.
+ * Interrupts, skrivninger til porte og tid i interrupt på Linux tælles per ramme.
+ * Brug: ovk_lysdaemper [-t sek] [-p togperiode sek] [-l]
+ * -l skriver niveauer for alle lamper i de første 200 klokcyklusser, hvor et niveau ændres.
+ * Afslutter med 0 når alle rammer og forløb passer og 1 ved fejl.
+ */
+
+#ifndef BrugLysdaemper
+#define BrugLysdaemper
+#endif
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "RefOverkoersel.h"
+#include "SimScript.h"
+
+#ifdef BrugTicklessKlok
+void simPinChange(byte, byte) {Clock::wake();}
+#endif
+
+// Ansvar: Følger timer 2 og lampernes ben og kontrollerer rammerne.
+// MicrosPerTick, UnitMicros, FrameMicros: Timer 2 i virtuel tid
+// Pins: Ben for lamperne i RefOverkoersel.h. lamp: Index i LampDimmer for hvert ben
+// inCompare: Interrupt kører. nextCompare: Tid for næste compare
+// wasRunning: Timeren kørte efter forrige klokcyklus. isFrameValid: Aktuel ramme startede med periode 0 og er ikke afbrudt
+// frameStart, expected: Start og forventet niveau for hver lampe i aktuel ramme
+// lastRise, onMicros: Seneste stigende kant og tændt tid i aktuel ramme for hver lampe
+// compares, portWrites, nanos: Interrupts, skrivninger til porte og tid i interrupt på Linux i aktuel ramme
+// noFrames, noFrameErrors, noLengthErrors, noCompareErrors, noForeignWrites: Kontrollerede rammer og fejl
+// maxPortWrites, sumPortWrites, sumNanos, maxNanos: Arbejde i interrupt over kontrollerede rammer
+// runMicros: Tid timeren har kørt
+// levelOf(...): Niveau for en lampe i en kopi af mønstre
+// onWrite(...): Kaldes af simulatorens kort ved ændring af et ben
+// endFrame(...): Kontrollerer en ramme og starter næste
+// compare(...): Udfører interrupt
+// advanceTo(...): Flytter tiden frem og udfører interrupt undervejs
+// afterCycle(...): Opdaterer timer efter en klokcyklus
+namespace SimFrames {
+  const unsigned long MicrosPerTick = 16;
+  const unsigned long UnitMicros = LampDimmer::TicksPerUnit*MicrosPerTick;
+  const unsigned long FrameMicros = 255*UnitMicros;
+  const byte NoLamps = 5;
+  const byte Pins[NoLamps] = {ARDPin.OUSignAB, ARDPin.OUSignBA, ARDPin.OUSignABHvid, ARDPin.OUSignBAHvid, ARDPin.VejLys};
+  byte lamp[NoLamps];
+  bool inCompare = false;
+  unsigned long long nextCompare = 0;
+  bool wasRunning = false;
+  bool isFrameValid = false;
+  unsigned long long frameStart = 0;
+  byte expected[NoLamps];
+  unsigned long long lastRise[NoLamps];
+  unsigned long onMicros[NoLamps];
+  unsigned long compares = 0, portWrites = 0;
+  double nanos = 0;
+  unsigned long noFrames = 0, noFrameErrors = 0, noLengthErrors = 0, noCompareErrors = 0, noForeignWrites = 0;
+  unsigned long maxPortWrites = 0, sumPortWrites = 0;
+  double sumNanos = 0, maxNanos = 0;
+  unsigned long long runMicros = 0;
+
+  byte levelOf(const LampDimmer::t_Schedule &item, byte index) {
+    const LampDimmer::t_Lamp &light = LampDimmer::lamps[index];
+    byte level = 0;
+    for (byte bit=0; bit < LampDimmer::Bits; bit++) if ((item.pattern[bit][light.port] & light.mask) != 0) level |= (1 << bit);
+    return level;
+  }
+
+  void onWrite(byte pin, byte value) {
+    if ((pin == ARDPin.VejKlokker) && (inCompare == true)) noForeignWrites++;
+    for (byte cnt=0; cnt < NoLamps; cnt++) {
+      if (Pins[cnt] != pin) continue;
+      if (value == HIGH) lastRise[cnt] = Sim::clockMicros;
+      else onMicros[cnt] += Sim::clockMicros-lastRise[cnt];
+    }
+  }
+
+  void endFrame(void) {
+    if (isFrameValid == true) {
+      bool isOk = true;
+      if (Sim::clockMicros-frameStart != FrameMicros) noLengthErrors++;
+      if (compares != LampDimmer::Bits) noCompareErrors++;
+      for (byte cnt=0; cnt < NoLamps; cnt++) {
+        if (Sim::board->output[Pins[cnt]] == HIGH) onMicros[cnt] += Sim::clockMicros-lastRise[cnt];
+        if (onMicros[cnt] != expected[cnt]*UnitMicros) isOk = false;
+      }
+      if ((isOk == false) && (noFrameErrors++ < 10))
+        fprintf(stderr, "Fejl: Ramme ved %llu µsek: lampe 0 tændt %lu µsek, ventet %u µsek\n", frameStart, onMicros[0], expected[0]*(unsigned int)UnitMicros);
+      if (portWrites > maxPortWrites) maxPortWrites = portWrites;
+      if (nanos > maxNanos) maxNanos = nanos;
+      sumPortWrites += portWrites;
+      sumNanos += nanos;
+      noFrames++;
+    }
+    isFrameValid = true;
+    frameStart = Sim::clockMicros;
+    compares = portWrites = 0;
+    nanos = 0;
+    for (byte cnt=0; cnt < NoLamps; cnt++) {
+      expected[cnt] = levelOf(LampDimmer::schedule[LampDimmer::active], lamp[cnt]);
+      lastRise[cnt] = Sim::clockMicros;
+      onMicros[cnt] = 0;
+    }
+  }
+
+  void compare(void) {
+    unsigned long writes = Sim::count.portWrites;
+    inCompare = true;
+    auto start = std::chrono::steady_clock::now();
+    LampDimmer::onCompare();
+    double used = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-start).count();
+    inCompare = false;
+    if (LampDimmer::bitNo == 0) endFrame();
+    compares++;
+    portWrites += Sim::count.portWrites-writes;
+    nanos += used;
+    nextCompare += (OCR2A+1)*MicrosPerTick;
+  }
+
+  void advanceTo(unsigned long long atMicros) {
+    while ((LampDimmer::running == true) && (nextCompare <= atMicros)) {
+      runMicros += nextCompare-Sim::clockMicros;
+      Sim::advanceMicros(nextCompare-Sim::clockMicros);
+      compare();
+    }
+    if (LampDimmer::running == true) runMicros += atMicros-Sim::clockMicros;
+    Sim::advanceMicros(atMicros-Sim::clockMicros);
+  }
+
+  void afterCycle(void) {
+    if ((LampDimmer::running == true) && (wasRunning == false)) nextCompare = Sim::clockMicros+(OCR2A+1)*MicrosPerTick;
+    if (LampDimmer::running == false) isFrameValid = false;
+    wasRunning = LampDimmer::running;
+  }
+}
+
+// Ansvar: Kontrollerer lampernes forløb efter hver klokcyklus.
+// target, level: Mål og niveau efter forrige klokcyklus for hver lampe
+// changeMillis: Tid målet sidst skiftede for hver lampe
+// noFades, maxOn, maxOff: Afsluttede forløb og længste tænd og sluk i msek
+// noDirectionErrors: Niveau bevæget væk fra målet
+// check(...): Kaldes efter hver klokcyklus. Leverer sand hvis et niveau er ændret
+namespace SimFades {
+  bool target[SimFrames::NoLamps];
+  byte level[SimFrames::NoLamps];
+  unsigned long changeMillis[SimFrames::NoLamps];
+  unsigned long noFades = 0, maxOn = 0, maxOff = 0, noDirectionErrors = 0;
+
+  bool check(void) {
+    bool changed = false;
+    for (byte cnt=0; cnt < SimFrames::NoLamps; cnt++) {
+      const LampDimmer::t_Lamp &item = LampDimmer::lamps[SimFrames::lamp[cnt]];
+      if (item.target != target[cnt]) {
+        target[cnt] = item.target;
+        changeMillis[cnt] = millis();
+      }
+      else if (item.level != level[cnt]) {
+        if ((item.target == HIGH) && (item.level < level[cnt])) noDirectionErrors++;
+        if ((item.target == LOW) && (item.level > level[cnt])) noDirectionErrors++;
+      }
+      if ((item.level != level[cnt]) && ((item.level == 0) || (item.level == 255))) {
+        unsigned long used = millis()-changeMillis[cnt];
+        unsigned long &longest = (item.level == 255)?maxOn:maxOff;
+        if (used > longest) longest = used;
+        noFades++;
+      }
+      if (item.level != level[cnt]) changed = true;
+      level[cnt] = item.level;
+    }
+    return changed;
+  }
+}
+
+#ifdef BrugTicklessKlok
+// Sover som Sim::sleep(...), men udfører interrupt fra timer 2 undervejs
+void simSleep(unsigned long) {
+  const unsigned long long Timer0Overflow = 1024;
+  unsigned long long wakeMicros = (Sim::clockMicros/Timer0Overflow+1)*Timer0Overflow;
+  if ((Sim::scriptPos < Sim::script.size()) && (Sim::script[Sim::scriptPos].atMillis*1000ULL < wakeMicros))
+    wakeMicros = (Sim::script[Sim::scriptPos].atMillis*1000ULL > Sim::clockMicros)?Sim::script[Sim::scriptPos].atMillis*1000ULL:Sim::clockMicros;
+  SimFrames::advanceTo(wakeMicros);
+}
+#endif
+
+int main(int argc, char *argv[]) {
+  unsigned long simSeconds = 600;
+  unsigned long trainPeriod = 120;
+  unsigned long noLogLines = 0;
+  bool isValid = true;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-t") == 0) && (cnt+1 < argc)) simSeconds = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-p") == 0) && (cnt+1 < argc)) trainPeriod = strtoul(argv[++cnt], nullptr, 10);
+    else if (strcmp(argv[cnt], "-l") == 0) noLogLines = 200;
+    else isValid = false;
+  }
+  if ((isValid == false) || (trainPeriod == 0) || (simSeconds < 100)) {
+    fprintf(stderr, "Brug: %s [-t sek] [-p togperiode sek] [-l]\n", argv[0]);
+    return 2;
+  }
+
+  using namespace SimFrames;
+  for (byte cnt=0; cnt < NoLamps; cnt++) {
+    lamp[cnt] = LampDimmer::NoLamp;
+    for (byte index=0; index < LampDimmer::noLamps; index++) {
+      const LampDimmer::t_Lamp &item = LampDimmer::lamps[index];
+      if ((LampDimmer::ports[item.port] == digitalPinToPort(Pins[cnt])) && (item.mask == digitalPinToBitMask(Pins[cnt]))) lamp[cnt] = index;
+    }
+    if (lamp[cnt] == LampDimmer::NoLamp) {
+      fprintf(stderr, "Fejl: D%u er ikke tilknyttet lysdæmper\n", Pins[cnt]);
+      return 1;
+    }
+  }
+  SimScript::addTrainSchedule(simSeconds*1000, trainPeriod*1000, ARDPin.ManuelKnap, ARDPin.Taendsted, ARDPin.Togvej);
+  Sim::onWrite = onWrite;
+#ifdef BrugTicklessKlok
+  Clock::idle = simSleep;
+  Sim::onInput = simPinChange;
+#endif
+  setup();
+  afterCycle();
+  SimFades::check();
+
+  const unsigned long endMillis = simSeconds*1000;
+#ifndef BrugTicklessKlok
+  unsigned long nextCycle = Clock::ClockCycle;
+#endif
+  while (millis() < endMillis) {
+#ifndef BrugTicklessKlok
+    advanceTo(nextCycle*1000ULL);
+#endif
+    loop();
+#ifndef BrugTicklessKlok
+    nextCycle = (millis()/Clock::ClockCycle+1)*Clock::ClockCycle;
+#endif
+    afterCycle();
+    if ((SimFades::check() == true) && (noLogLines > 0)) {
+      noLogLines--;
+      printf("%8lu", millis());
+      for (byte cnt=0; cnt < NoLamps; cnt++) printf(" D%u %3u", Pins[cnt], LampDimmer::lamps[lamp[cnt]].level);
+      printf("\n");
+    }
+  }
+
+  using namespace SimFades;
+  const unsigned long FadeLimit[2] = {LampDimmer::FadeOffTime, LampDimmer::FadeOnTime};
+  bool isFramesOk = (noFrameErrors == 0) && (noLengthErrors == 0) && (noCompareErrors == 0) && (noForeignWrites == 0) && (noFrames > 0);
+  bool isFadesOk = (noDirectionErrors == 0) && (maxOn <= FadeLimit[1]) && (maxOff <= FadeLimit[0]) && (noFades > 0);
+  printf("Simuleret:             %lu sek, %u lamper, timer kørte %.1f %% af tiden\n", simSeconds, NoLamps, runMicros/(simSeconds*10000.0));
+  printf("Rammer:                %lu á %lu µsek kontrolleret, %lu med forkert tændt tid, %lu med forkert længde  %s\n",
+    noFrames, FrameMicros, noFrameErrors, noLengthErrors, ((noFrameErrors == 0) && (noLengthErrors == 0))?"OK":"FEJL");
+  printf("Interrupts per ramme:  %u, %lu rammer afveg, %lu skrivninger til vejklokke  %s\n",
+    LampDimmer::Bits, noCompareErrors, noForeignWrites, ((noCompareErrors == 0) && (noForeignWrites == 0))?"OK":"FEJL");
+  printf("Portskrivninger:       %.2f per ramme i gennemsnit, højst %lu\n", (noFrames > 0)?(double)sumPortWrites/noFrames:0.0, maxPortWrites);
+  printf("Tid i interrupt:       %.0f nsek per ramme i gennemsnit, højst %.0f nsek på Linux\n", (noFrames > 0)?sumNanos/noFrames:0.0, maxNanos);
+  printf("Tænd og sluk:          %lu forløb, længst %lu/%lu msek, grænse %lu/%lu msek, %lu gik forkert vej  %s\n",
+    noFades, maxOn, maxOff, FadeLimit[1], FadeLimit[0], noDirectionErrors, (isFadesOk == true)?"OK":"FEJL");
+  printf("Resultat:              %s\n", ((isFramesOk == true) && (isFadesOk == true))?"OK":"FEJL");
+  return ((isFramesOk == true) && (isFadesOk == true))?0:1;
+}
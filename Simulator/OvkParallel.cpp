@@ -0,0 +1,292 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Parallel simulering af alle overkørsler på et anlæg
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Hver overkørsel er bygget af t_Crossing, tilstandene fra RefOverkoersel.h og bibliotekets drivere og ydre enheder
+ * og har sit eget simulerede kort. Overkørslerne deles mellem tråde, som kører i takt i epoker på én klokcyklus.
+ * Ved hver epoke lægger sidste tråd ved barrieren tiden frem, kører blinkeren og udgiver togenes bevægelser.
+ * Tog kører langs strækningen og passerer overkørslerne efter hinanden med samme togplan som ovk_sim.
+ * Brug: ovk_parallel [-t sekunder] [-n overkørsler] [-j tråde] [-p togperiode sekunder] [-l]
+ * Uden -j måles 1, 2, 4 ... tråde op til antal kerner, og skalering rapporteres.
+ * -l: Logger udgange for første overkørsel som ovk_sim -l og kører med 1 tråd.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "RefOverkoersel.h"
+
+// Ansvar: En komplet overkørsel som RefOverkoersel.h, men som objekt, så der kan være mange.
+// t_BoardHolder: Opretter overkørslens kort og gør det aktivt, før driverne bliver konstrueret
+// select(...): Gør overkørslens kort aktivt i tråden
+// doClockCycle(...): Gennemløber en klokcyklus
+struct t_CrossingInstance {
+  struct t_BoardHolder {
+    Sim::t_Board board;
+    t_BoardHolder(void): board() {Sim::board = &board;}
+  } holder;
+  t_PushButton manuelKnapDrv{ARDPin.ManuelKnap, NCLOSED};
+  t_PushButton taendstedDrv{ARDPin.Taendsted, NCLOSED};
+  t_PushButton togvejDrv{ARDPin.Togvej, NOPEN};
+  t_SimpleOnOff OUSignABDrv{ARDPin.OUSignAB, HIGH};
+  t_SimpleOnOff OUSignBADrv{ARDPin.OUSignBA, HIGH};
+  t_SimpleOnOff OUSignABHvidDrv{ARDPin.OUSignABHvid};
+  t_SimpleOnOff OUSignBAHvidDrv{ARDPin.OUSignBAHvid};
+  t_SimpleOnOff vejLysDrv{ARDPin.VejLys};
+  t_SimpleOnOff vejKlokkerDrv{ARDPin.VejKlokker};
+  t_ServoMotor SG90{HIGH};
+  t_CrossingCtrl manuelBetj, taendsted, togvej;
+  t_FlipFlop manFF{NCLOSED};
+  t_FlipFlop taendFF{NCLOSED};
+  t_RailSignal OUSignAB, OUSignBA;
+  t_RoadSignal vejLys{PASS};
+  t_RoadSignal vejKlokker{PASS};
+  t_Barrier vejBom{PASS};
+  t_IkkeSikretState ikkesikret;
+  t_ForringState forring;
+  t_BomNedState bomned;
+  t_SikretState sikret;
+  t_OploesState oploes;
+  t_Collection items;
+  t_Crossing crossing{&items};
+
+  // Som setup() i RefOverkoersel.h
+  t_CrossingInstance(void) {
+    select();
+    SG90.startMotor(ARDPin.ServM, Timing.AngleAdjust, Timing.BarrierTime);
+    manuelBetj.setDriver(&manuelKnapDrv);
+    taendsted.setDriver(&taendstedDrv);
+    togvej.setDriver(&togvejDrv);
+    manuelBetj.setFlipFlop(&manFF);
+    taendsted.setFlipFlop(&taendFF, ONESHOT);
+    OUSignAB.setDriver(&OUSignABDrv);
+    OUSignBA.setDriver(&OUSignBADrv);
+    OUSignAB.setWhiteLamp(&OUSignABHvidDrv);
+    OUSignBA.setWhiteLamp(&OUSignBAHvidDrv);
+    vejLys.setDriver(&vejLysDrv);
+    vejKlokker.setDriver(&vejKlokkerDrv);
+    vejBom.setDriver(&SG90);
+    items.initialize();
+    crossing.setCtrl(MANUELBETJ, &manuelBetj);
+    crossing.setCtrl(TAENDSTED, &taendsted);
+    crossing.setCtrl(TOGVEJ, &togvej);
+    crossing.setDevice(BANESIGNAB, &OUSignAB);
+    crossing.setDevice(BANESIGNBA, &OUSignBA);
+    crossing.setDevice(VEJSIGNAL, &vejLys);
+    crossing.setDevice(VEJKLOKKE, &vejKlokker);
+    crossing.setDevice(VEJBOM, &vejBom);
+    crossing.setState(IKKESIKRET, &ikkesikret);
+    crossing.setState(FORRING, &forring);
+    crossing.setState(BOMNED, &bomned);
+    crossing.setState(SIKRET, &sikret);
+    crossing.setState(OPLOES, &oploes);
+    crossing.initState(IKKESIKRET);
+  }
+  void select(void) {Sim::board = &holder.board;}
+  void doClockCycle(void) {select(); crossing.doClockCycle();}
+};
+
+// Ansvar: Togenes bevægelser langs strækningen som indgangsændringer per overkørsel, sorteret efter tid.
+// Et tog passerer overkørsel n forskudt med n*Spacing msek, så alle overkørsler får samme togplan som ovk_sim.
+// t_Event: Ændring af en indgang på en overkørsel
+// build(...): Danner alle bevægelser
+// epochEnd(...): Index efter sidste bevægelse til og med et tidspunkt
+namespace Trains {
+  const unsigned long Spacing = 7919;
+  struct t_Event {
+    unsigned long atMillis;
+    unsigned int crossingNo;
+    byte pin;
+    byte level;
+  };
+  std::vector<t_Event> events;
+
+  void add(unsigned long atMillis, unsigned int crossingNo, byte pin, byte level) {events.push_back(t_Event{atMillis, crossingNo, pin, level});}
+
+  void build(unsigned int noCrossings, unsigned long untilMillis, unsigned long period) {
+    events.clear();
+    for (unsigned int crossingNo = 0; crossingNo < noCrossings; crossingNo++) {
+      unsigned long offset = (crossingNo*Spacing)%period;
+      unsigned long train = 0;
+      for (unsigned long at = 10000+offset; at+90000 < untilMillis; at += period, train++) {
+        if ((train % 7) == 6) {
+          add(at, crossingNo, ARDPin.ManuelKnap, LOW); add(at+200, crossingNo, ARDPin.ManuelKnap, HIGH);
+          add(at+60000, crossingNo, ARDPin.ManuelKnap, LOW); add(at+60200, crossingNo, ARDPin.ManuelKnap, HIGH);
+        }
+        else {
+          add(at, crossingNo, ARDPin.Togvej, HIGH);
+          add(at+5000, crossingNo, ARDPin.Taendsted, LOW); add(at+5300, crossingNo, ARDPin.Taendsted, HIGH);
+          add(at+60000, crossingNo, ARDPin.Togvej, LOW);
+        }
+      }
+    }
+    std::stable_sort(events.begin(), events.end(), [](const t_Event &a, const t_Event &b) {return a.atMillis < b.atMillis;});
+  }
+}
+
+// Ansvar: Barriere hvor tråde venter aktivt på hinanden. Sidste tråd udfører epokens fælles trin, før alle slippes fri.
+// noThreads: Antal tråde
+// waiting: Antal tråde ved barrieren
+// generation: Tæller epoker. En tråd venter til den skifter
+// wait(...): Venter på alle tråde. Leverer sand hvis simuleringen skal fortsætte
+struct t_EpochBarrier {
+  unsigned int noThreads;
+  std::atomic<unsigned int> waiting{0};
+  std::atomic<unsigned long> generation{0};
+  std::atomic<bool> running{true};
+  template <typename F>
+  bool wait(F &&serialStep) {
+    unsigned long myGeneration = generation.load(std::memory_order_acquire);
+    if (waiting.fetch_add(1, std::memory_order_acq_rel)+1 == noThreads) {
+      waiting.store(0, std::memory_order_relaxed);
+      running.store(serialStep(), std::memory_order_relaxed);
+      generation.store(myGeneration+1, std::memory_order_release);
+    }
+    else {
+      unsigned int spins = 0;
+      while (generation.load(std::memory_order_acquire) == myGeneration) {
+        if (++spins > 1000) std::this_thread::yield();
+      }
+    }
+    return running.load(std::memory_order_relaxed);
+  }
+};
+
+// Ansvar: Logger ændrede udgange på første overkørsels kort som SimLog i ovk_sim.
+namespace ParallelLog {
+  Sim::t_Board last;
+  void log(const Sim::t_Board &board) {
+    for (byte pin = 0; pin < Sim::NoPins; pin++) {
+      if (board.output[pin] != last.output[pin]) printf("%10lu D%-2u %u\n", millis(), pin, board.output[pin]);
+      if (board.servoPW[pin] != last.servoPW[pin]) printf("%10lu S%-2u %d\n", millis(), pin, board.servoPW[pin]);
+    }
+    last = board;
+  }
+}
+
+struct t_Result {
+  double wallSeconds;
+  unsigned long noTicks;
+};
+
+t_Result run(unsigned int noCrossings, unsigned int noThreads, unsigned long untilMillis, bool logging) {
+  std::vector<std::vector<std::unique_ptr<t_CrossingInstance>>> partitions(noThreads);
+  std::vector<unsigned int> firstNo(noThreads+1);
+  for (unsigned int thread = 0; thread <= noThreads; thread++) firstNo[thread] = (unsigned long)noCrossings*thread/noThreads;
+  t_EpochBarrier barrier;
+  barrier.noThreads = noThreads;
+  size_t epochBegin = 0, epochEnd = 0;
+  unsigned long noTicks = 0;
+  Sim::clockMicros = 0;
+
+  // Epokens fælles trin: Tiden flyttes frem, blinker kører og togbevægelser til og med tiden bliver udgivet
+  auto serialStep = [&]() -> bool {
+    if (logging == true) ParallelLog::log(partitions[0][0]->holder.board);
+    unsigned long nextMillis = millis()+Clock::ClockCycle;
+    if (nextMillis >= untilMillis) return false;
+    Sim::clockMicros = nextMillis*1000ULL;
+    Blinker::doClockCycle();
+    epochBegin = epochEnd;
+    while ((epochEnd < Trains::events.size()) && (Trains::events[epochEnd].atMillis <= nextMillis)) epochEnd++;
+    noTicks++;
+    return true;
+  };
+
+  auto worker = [&](unsigned int thread) {
+    // Overkørslerne oprettes i den tråd, som kører dem
+    for (unsigned int crossingNo = firstNo[thread]; crossingNo < firstNo[thread+1]; crossingNo++) {
+      partitions[thread].emplace_back(new t_CrossingInstance());
+    }
+    while (barrier.wait(serialStep) == true) {
+      for (size_t index = epochBegin; index < epochEnd; index++) {
+        const Trains::t_Event &event = Trains::events[index];
+        if ((event.crossingNo < firstNo[thread]) || (event.crossingNo >= firstNo[thread+1])) continue;
+        partitions[thread][event.crossingNo-firstNo[thread]]->select();
+        Sim::setInput(event.pin, event.level);
+      }
+      for (auto &instance : partitions[thread]) instance->doClockCycle();
+    }
+  };
+
+  auto wallStart = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned int thread = 1; thread < noThreads; thread++) threads.emplace_back(worker, thread);
+  worker(0);
+  for (auto &item : threads) item.join();
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-wallStart).count();
+  return t_Result{wallSeconds, noTicks};
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long simSeconds = 600;
+  unsigned long trainPeriod = 180;
+  unsigned int noCrossings = 1000;
+  unsigned int noThreads = 0;
+  bool logging = false;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-t") == 0) && (cnt+1 < argc)) simSeconds = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-n") == 0) && (cnt+1 < argc)) noCrossings = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-j") == 0) && (cnt+1 < argc)) noThreads = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-p") == 0) && (cnt+1 < argc)) trainPeriod = strtoul(argv[++cnt], nullptr, 10);
+    else if (strcmp(argv[cnt], "-l") == 0) logging = true;
+    else {
+      fprintf(stderr, "Brug: %s [-t sekunder] [-n overkørsler] [-j tråde] [-p togperiode sekunder] [-l]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (noCrossings == 0) noCrossings = 1;
+  Trains::build(noCrossings, simSeconds*1000, trainPeriod*1000);
+  if (logging == true) {
+    run(noCrossings, 1, simSeconds*1000, true);
+    return 0;
+  }
+
+  std::vector<unsigned int> threadCounts;
+  if (noThreads > 0) threadCounts.push_back(noThreads);
+  else {
+    unsigned int noCores = std::thread::hardware_concurrency();
+    if (noCores == 0) noCores = 1;
+    for (unsigned int count = 1; count < noCores; count *= 2) threadCounts.push_back(count);
+    threadCounts.push_back(noCores);
+  }
+  printf("Overkørsler:          %u\n", noCrossings);
+  printf("Simuleret tid:        %lu sek\n", simSeconds);
+  printf("Togbevægelser:        %zu\n", Trains::events.size());
+  printf("%8s %12s %16s %14s %12s\n", "Tråde", "Realtid sek", "klokcykl/sek", "x realtid", "Skalering");
+  double singleRate = 0;
+  for (unsigned int count : threadCounts) {
+    if (count > noCrossings) break;
+    t_Result result = run(noCrossings, count, simSeconds*1000, false);
+    // Simulerede klokcyklusser per sekund for alle overkørsler tilsammen
+    double rate = (double)result.noTicks*noCrossings/result.wallSeconds;
+    if (count == threadCounts.front()) singleRate = rate/count;
+    printf("%8u %12.3f %16.3g %14.1f %11.0f%%\n", count, result.wallSeconds, rate,
+           simSeconds/result.wallSeconds, 100.0*rate/(singleRate*count));
+  }
+  return 0;
+}
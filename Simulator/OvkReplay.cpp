@@ -0,0 +1,345 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Afspilning af optaget forløb med kontrol af tider
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Afspiller en optagelse fra Trace::drain(...) mod reference overkørsel i virtuel tid.
+ * Læste indgange (RAW) bliver lagt på benene i den klokcyklus, hvor de blev læst, og meldinger fra sikringsanlæg (LINK)
+ * bliver sat i samme klokcyklus. Overkørslen læser derfor præcis det samme som ved optagelsen.
+ * Afspilningen bliver sporet igen og skal give de samme hændelser i de samme klokcyklusser som optagelsen.
+ * Udgangenes kanter bliver kontrolleret mod tiderne i programmet: Blinkperiode fra Blinker::Period,
+ * bomvandring og tilstandenes varighed fra Timing. Med -g sammenlignes kanterne med en reference skrevet med -w.
+ * Brug: ovk_replay [-t sekunder] [-l] [-w referencefil] [-g referencefil] optagelse
+ * Optagelsen kan komme fra en arduino over seriel forbindelse eller fra ovk_sim_spor -d fil.
+ * ovk_replay_seriel er oversat med BrugSeriel og afspiller RefOverkoersel.h, hvor togvej kommer fra sikringsanlæg.
+ * Oversat med BrugKantfangst afspilles en optagelse fra ovk_sim_kant med sporing. Et pinskift kalder så interrupt.
+ * Afslutter med 0 når alt passer og 1 ved fejl, så afspilningen kan bruges i et script.
+ */
+
+#define BrugSporing
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "RefOverkoersel.h"
+#include "SimSpor.h"
+
+// Ansvar: Opsamler udgangenes kanter under afspilning.
+// t_Edge: En ændring af en udgang. servo er sand for pulsbredde til servo
+// line(...): Kanten som tekst i samme format som ovk_sim -l
+namespace SimEdges {
+  struct t_Edge {
+    unsigned long atMillis;
+    bool servo;
+    byte pin;
+    int value;
+  };
+  std::vector<t_Edge> edges;
+  bool enabled = false;
+
+  std::string line(const t_Edge &edge) {
+    char text[40];
+    snprintf(text, sizeof(text), "%10lu %c%-2u %d", edge.atMillis, edge.servo?'S':'D', edge.pin, edge.value);
+    return text;
+  }
+  void add(const t_Edge &edge) {
+    edges.push_back(edge);
+    if (enabled == true) printf("%s\n", line(edge).c_str());
+  }
+  void onWrite(byte pin, byte value) {add(t_Edge{millis(), false, pin, value});}
+  void onServo(byte pin, int pulseWidth) {add(t_Edge{millis(), true, pin, pulseWidth});}
+}
+
+// Ansvar: Opsamler sporingen af afspilningen, så den kan sammenlignes med optagelsen.
+namespace SimReplay {
+  std::vector<byte> dump;
+  void put(byte value) {dump.push_back(value);}
+}
+
+// Ansvar: Kontrol af en tid mod en grænse.
+// low, high: Tilladt interval i msek
+// count, min, max: Antal målinger og mindste og største måling
+// firstFail: Tidspunkt for første måling udenfor grænsen
+struct t_Check {
+  const char *name;
+  long low;
+  long high;
+  unsigned long count = 0;
+  unsigned long noFails = 0;
+  long min = 0;
+  long max = 0;
+  unsigned long firstFail = 0;
+  t_Check(const char *a_name, long a_low, long a_high) : name(a_name), low(a_low), high(a_high) {}
+  void add(long value, unsigned long atMillis) {
+    if ((count == 0) || (value < min)) min = value;
+    if ((count == 0) || (value > max)) max = value;
+    count++;
+    if ((value < low) || (value > high)) {
+      if (noFails == 0) firstFail = atMillis;
+      noFails++;
+    }
+  }
+  bool report(void) const {
+    printf("%-22s %lu målinger, %ld-%ld msek, krav %ld-%ld msek", name, count, min, max, low, high);
+    if (noFails > 0) printf("  FEJL %lu gange, første ved %lu msek\n", noFails, firstFail);
+    else printf("  OK\n");
+    return noFails == 0;
+  }
+};
+
+// Blink: En lampe blinker når den skifter igen indenfor 2 perioder. Alle skift undtagen det sidste i et blink skal
+// komme efter en periode. Det sidste kan komme tidligere, når lampen bliver slukket af tilstandsmaskinen.
+void checkBlink(t_Check &check) {
+  const unsigned long Period = Blinker::Period;
+  for (byte pin=0; pin < Sim::NoPins; pin++) {
+    std::vector<unsigned long> run;
+    auto endRun = [&]() {
+      for (size_t cnt=1; cnt+1 < run.size(); cnt++) check.add(run[cnt]-run[cnt-1], run[cnt]);
+      run.clear();
+    };
+    for (const SimEdges::t_Edge &edge : SimEdges::edges) {
+      if ((edge.servo == true) || (edge.pin != pin)) continue;
+      if ((run.empty() == false) && (edge.atMillis-run.back() > 2*Period)) endRun();
+      run.push_back(edge.atMillis);
+    }
+    endRun();
+  }
+}
+
+// Bomvandring: Fra bommen får besked til servoen har fået sin sidste pulsbredde. En vandring er skrivninger til
+// servoen uden pause. Bommen skal være færdig indenfor BarrierTime og må højst være 10 % hurtigere.
+void checkBarrier(t_Check &check, const std::vector<SimSpor::t_Event> &events, unsigned long endMillis) {
+  const unsigned long Pause = 500;
+  std::vector<unsigned long> commands;
+  for (const SimSpor::t_Event &event : events) {
+    if ((event.type == Trace::DEVICE) && ((event.data & 0x7F) == VEJBOM)) commands.push_back(event.cycle*Clock::ClockCycle);
+  }
+  size_t next = 0;
+  unsigned long first = 0, last = 0;
+  bool inSweep = false;
+  auto endSweep = [&]() {
+    if (inSweep == false) return;
+    inSweep = false;
+    // Seneste besked før vandringen startede
+    unsigned long command = 0;
+    bool found = false;
+    for (; (next < commands.size()) && (commands[next] <= first); next++) {
+      command = commands[next];
+      found = true;
+    }
+    if ((found == true) && (command+Timing.BarrierTime < endMillis)) check.add(last-command, command);
+  };
+  for (const SimEdges::t_Edge &edge : SimEdges::edges) {
+    if (edge.servo == false) continue;
+    if ((inSweep == true) && (edge.atMillis-last > Pause)) endSweep();
+    if (inSweep == false) first = edge.atMillis;
+    last = edge.atMillis;
+    inSweep = true;
+  }
+  endSweep();
+}
+
+// Tilstande: Varighed fra en tilstand startes til næste startes. Urværket udløser i klokcyklussen efter udløb.
+void checkStates(t_Check *checks, const byte *states, byte noStates, const std::vector<SimSpor::t_Event> &events) {
+  const SimSpor::t_Event *previous = nullptr;
+  for (const SimSpor::t_Event &event : events) {
+    if (event.type != Trace::STATE) continue;
+    if (previous != nullptr) {
+      for (byte cnt=0; cnt < noStates; cnt++) {
+        if (previous->data == states[cnt]) checks[cnt].add((event.cycle-previous->cycle)*Clock::ClockCycle, previous->cycle*Clock::ClockCycle);
+      }
+    }
+    previous = &event;
+  }
+}
+
+// Reference: Sammenligner kanterne med en fil linje for linje
+bool checkGolden(const char *fileName) {
+  FILE *file = fopen(fileName, "r");
+  if (file == nullptr) {
+    printf("%-22s kan ikke læse %s  FEJL\n", "Reference:", fileName);
+    return false;
+  }
+  char text[80];
+  size_t lineNo = 0;
+  bool result = true;
+  while (fgets(text, sizeof(text), file) != nullptr) {
+    text[strcspn(text, "\r\n")] = '\0';
+    if (lineNo >= SimEdges::edges.size()) {
+      printf("%-22s linje %zu mangler: %s  FEJL\n", "Reference:", lineNo+1, text);
+      result = false;
+      break;
+    }
+    std::string actual = SimEdges::line(SimEdges::edges[lineNo]);
+    if (actual != text) {
+      printf("%-22s linje %zu er \"%s\", forventet \"%s\"  FEJL\n", "Reference:", lineNo+1, actual.c_str(), text);
+      result = false;
+      break;
+    }
+    lineNo++;
+  }
+  fclose(file);
+  if ((result == true) && (lineNo < SimEdges::edges.size())) {
+    printf("%-22s %zu kanter mere end reference, første: %s  FEJL\n", "Reference:", SimEdges::edges.size()-lineNo,
+           SimEdges::line(SimEdges::edges[lineNo]).c_str());
+    result = false;
+  }
+  if (result == true) printf("%-22s %zu kanter ens  OK\n", "Reference:", lineNo);
+  return result;
+}
+
+bool writeGolden(const char *fileName) {
+  FILE *file = fopen(fileName, "w");
+  if (file == nullptr) {
+    fprintf(stderr, "Kan ikke skrive: %s\n", fileName);
+    return false;
+  }
+  for (const SimEdges::t_Edge &edge : SimEdges::edges) fprintf(file, "%s\n", SimEdges::line(edge).c_str());
+  fclose(file);
+  return true;
+}
+
+#ifdef BrugKantfangst
+// Et pinskift kalder interrupt for benets port
+void simPinChange(byte pin, byte) {EdgeCapture::onPinChange(digitalPinToPort(pin));}
+#endif
+
+int main(int argc, char *argv[]) {
+  unsigned long simSeconds = 0;
+  const char *fileName = nullptr;
+  const char *writeName = nullptr;
+  const char *goldenName = nullptr;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-t") == 0) && (cnt+1 < argc)) simSeconds = strtoul(argv[++cnt], nullptr, 10);
+    else if (strcmp(argv[cnt], "-l") == 0) SimEdges::enabled = true;
+    else if ((strcmp(argv[cnt], "-w") == 0) && (cnt+1 < argc)) writeName = argv[++cnt];
+    else if ((strcmp(argv[cnt], "-g") == 0) && (cnt+1 < argc)) goldenName = argv[++cnt];
+    else if ((argv[cnt][0] != '-') && (fileName == nullptr)) fileName = argv[cnt];
+    else fileName = nullptr, cnt = argc;
+  }
+  if (fileName == nullptr) {
+    fprintf(stderr, "Brug: %s [-t sekunder] [-l] [-w referencefil] [-g referencefil] optagelse\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<SimSpor::t_Event> recorded;
+  if (SimSpor::loadFile(fileName, recorded) == false) {
+    fprintf(stderr, "%s\n", SimSpor::error.c_str());
+    return 1;
+  }
+  if (SimSpor::badChecks > 0) fprintf(stderr, "Advarsel: Kontrolsum passer ikke i %lu af %lu udskrifter\n", SimSpor::badChecks, SimSpor::noDumps);
+  unsigned long noDumps = SimSpor::noDumps;
+  if (recorded.empty() == true) {
+    fprintf(stderr, "Optagelsen er tom\n");
+    return 1;
+  }
+  if (SimSpor::clockCycle != Clock::ClockCycle) {
+    fprintf(stderr, "Optaget med klokcyklus %u msek, programmet bruger %u msek\n", SimSpor::clockCycle, Clock::ClockCycle);
+    return 1;
+  }
+
+  // Indgange lægges på benene, når tiden når frem til klokcyklussen. Meldinger sættes lige før klokcyklussen
+  std::vector<SimSpor::t_Event> links;
+  for (const SimSpor::t_Event &event : recorded) {
+    if (event.type == Trace::RAW) Sim::addInput(event.cycle*Clock::ClockCycle, event.data & 0x7F, event.data >> 7);
+    if (event.type == Trace::LINK) links.push_back(event);
+  }
+#ifndef BrugSeriel
+  if (links.empty() == false) {
+    fprintf(stderr, "Optagelsen har meldinger fra sikringsanlæg og skal afspilles med ovk_replay_seriel\n");
+    return 1;
+  }
+#endif
+  unsigned long lastCycle = recorded.back().cycle;
+  unsigned long endMillis = (simSeconds > 0)?simSeconds*1000:(lastCycle+1)*Clock::ClockCycle;
+
+  Sim::onWrite = SimEdges::onWrite;
+  Sim::onServo = SimEdges::onServo;
+#ifdef BrugKantfangst
+  Sim::onInput = simPinChange;
+#endif
+  setup();
+  Trace::drain(SimReplay::put);
+
+  size_t linkPos = 0;
+  unsigned long nextCycle = Clock::ClockCycle;
+  auto wallStart = std::chrono::steady_clock::now();
+  while (millis() < endMillis) {
+    if (millis() < nextCycle) Sim::advanceMicros(nextCycle*1000ULL-Sim::clockMicros);
+    for (; (linkPos < links.size()) && (links[linkPos].cycle <= Trace::cycle+1); linkPos++) {
+#ifdef BrugSeriel
+      SerialLink::inLevel[links[linkPos].data & 0x7F] = links[linkPos].data >> 7;
+#endif
+    }
+    loop();
+    nextCycle = (millis()/Clock::ClockCycle+1)*Clock::ClockCycle;
+    Trace::drain(SimReplay::put);
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-wallStart).count();
+
+  std::vector<SimSpor::t_Event> replayed;
+  if (SimSpor::decode(SimReplay::dump, replayed) == false) {
+    fprintf(stderr, "Afspilningens sporing: %s\n", SimSpor::error.c_str());
+    return 1;
+  }
+
+  bool result = true;
+  printf("%-22s %zu hændelser i %lu udskrifter, %lu klokcyklusser\n", "Optagelse:", recorded.size(), noDumps, lastCycle);
+  printf("%-22s %.1f sek på %.3f sek (%.0f x realtid)\n", "Afspillet:", endMillis/1000.0, wallSeconds, endMillis/1000.0/wallSeconds);
+
+  // Optagelsen begynder ikke nødvendigvis ved start. Hændelser efter optagelsens slutning sammenlignes ikke
+  size_t offset = 0;
+  while ((offset < replayed.size()) && (replayed[offset].cycle < recorded.front().cycle)) offset++;
+  size_t noSame = 0;
+  while ((noSame < recorded.size()) && (offset+noSame < replayed.size()) && (recorded[noSame] == replayed[offset+noSame])) noSame++;
+  if (noSame == recorded.size()) printf("%-22s %zu hændelser ens med optagelsen  OK\n", "Afspilning:", noSame);
+  else {
+    const SimSpor::t_Event &want = recorded[noSame];
+    printf("%-22s afviger efter %zu hændelser: optaget type %u data 0x%02X i klokcyklus %lu", "Afspilning:", noSame, want.type, want.data, want.cycle);
+    if (offset+noSame < replayed.size()) {
+      const SimSpor::t_Event &got = replayed[offset+noSame];
+      printf(", afspillet type %u data 0x%02X i klokcyklus %lu", got.type, got.data, got.cycle);
+    }
+    printf("  FEJL\n");
+    result = false;
+  }
+
+  t_Check blink("Blinkperiode:", Blinker::Period-Clock::ClockCycle, Blinker::Period+Clock::ClockCycle);
+  checkBlink(blink);
+  result = blink.report() && result;
+  t_Check barrier("Bomvandring:", Timing.BarrierTime*9/10, Timing.BarrierTime);
+  checkBarrier(barrier, replayed, endMillis);
+  result = barrier.report() && result;
+  const byte States[] = {FORRING, BOMNED, OPLOES};
+  t_Check durations[] = {
+    t_Check("Tilstand FORRING:", Timing.Forring*1000, Timing.Forring*1000+Clock::ClockCycle),
+    t_Check("Tilstand BOMNED:", Timing.BarrierTime, Timing.BarrierTime+Clock::ClockCycle),
+    t_Check("Tilstand OPLOES:", Timing.BarrierTime, Timing.BarrierTime+Clock::ClockCycle)};
+  checkStates(durations, States, sizeof(States), replayed);
+  for (const t_Check &check : durations) result = check.report() && result;
+
+  if (goldenName != nullptr) result = checkGolden(goldenName) && result;
+  if ((writeName != nullptr) && (writeGolden(writeName) == false)) return 1;
+  printf("%-22s %s\n", "Resultat:", (result == true)?"OK":"FEJL");
+  return (result == true)?0:1;
+}
@@ -0,0 +1,372 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Seriel forbindelse til sikringsanlæg på pty
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Kører RefOverkoersel.h med BrugSeriel i realtid. Overkørslens UART er slave siden af en pty,
+ * og en stedfortræder for sikringsanlægget kører på master siden.
+ * For hvert tog sætter sikringsanlægget togvej, toget passerer tændsted, overkørslen melder sikret,
+ * og sikringsanlægget opløser togvej. Imens spørger sikringsanlægget jævnligt om togvejs og tændsteds status
+ * med 2 forespørgsler i træk, som begge skal besvares.
+ * Måler tid fra en melding bliver skrevet på pty til kvittering, til svar, til udgang skifter og til melding om sikret.
+ * Brug: ovk_seriel [-n tog] [-b baud] [-f bitfejl promille]
+ */
+
+#include <chrono>
+#include <deque>
+#include <random>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#ifndef BrugSeriel
+#define BrugSeriel
+#endif
+#include "RefOverkoersel.h"
+
+typedef std::chrono::steady_clock t_Wall;
+const t_Wall::time_point WallStart = t_Wall::now();
+
+double wallMillis(void) {return std::chrono::duration<double, std::milli>(t_Wall::now()-WallStart).count();}
+
+// Ansvar: Samler målinger af latens i msek.
+struct t_Latency {
+  const char *name;
+  unsigned long noSamples = 0;
+  double sum = 0, min = 0, max = 0;
+  void add(double ms) {
+    if ((noSamples == 0) || (ms < min)) min = ms;
+    if (ms > max) max = ms;
+    sum += ms;
+    noSamples++;
+  }
+  void print(void) const {
+    if (noSamples == 0) printf("%-22s ingen målinger\n", name);
+    else printf("%-22s %6.2f / %6.2f / %6.2f msek (%lu)\n", name, min, sum/noSamples, max, noSamples);
+  }
+};
+
+// Ansvar: Overkørslens UART på slave siden af pty.
+// Byte bliver leveret til SerialLink::receive(...) og hentet fra SerialLink::transmit(...) som af interrupt,
+// højst så mange som baudrate tillader. Med fejlrate bliver tilfældige bit vendt i begge retninger.
+namespace Uart {
+  int fd = -1;
+  unsigned long baud = 19200;
+  unsigned int errorPromille = 0;
+  std::mt19937 random(1);
+  std::deque<byte> wire;
+  double rxCredit = 0, txCredit = 0, lastMillis = 0;
+  unsigned long noCorrupted = 0;
+
+  byte corrupt(byte value) {
+    if ((errorPromille == 0) || (random()%1000 >= errorPromille)) return value;
+    noCorrupted++;
+    return value ^ (1 << (random()%8));
+  }
+
+  bool hasBacklog(void) {return (wire.empty() == false) || (SerialLink::tx.used() > 0);}
+
+  void pump(void) {
+    byte buffer[64];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) wire.insert(wire.end(), buffer, buffer+length);
+    double now = wallMillis();
+    double bytesPerMilli = baud/10000.0;
+    rxCredit += (now-lastMillis)*bytesPerMilli;
+    txCredit += (now-lastMillis)*bytesPerMilli;
+    lastMillis = now;
+    if (rxCredit > 2) rxCredit = 2;
+    if (txCredit > 2) txCredit = 2;
+    while ((rxCredit >= 1) && (wire.empty() == false)) {
+      SerialLink::receive(corrupt(wire.front()));
+      wire.pop_front();
+      rxCredit -= 1;
+    }
+    byte value;
+    while ((txCredit >= 1) && (SerialLink::transmit(value) == true)) {
+      value = corrupt(value);
+      if (write(fd, &value, 1) != 1) break;
+      txCredit -= 1;
+    }
+  }
+}
+
+// Ansvar: Stedfortræder for sikringsanlægget på master siden af pty.
+// Sender CTRL og QUERY, kvitterer for DEVICE og gentager CTRL indtil kvittering.
+// ctrl...: CTRL som venter på kvittering. ctrlSent er første afsendelse og ctrlResent seneste
+// Queries, t_Query, queries: QUERY som venter på svar for hver navn. sent er afsendelse
+// noUnanswered: Forespørgsler uden svar, når der spørges igen
+// ackedTogvej: Togvej som overkørslen har kvitteret for. Et senere svar skal stemme
+// sikret: Seneste melding om sikret
+// outputArmed, offMillis: Måling fra opløsning af togvej til banesignal skifter og til melding om sikret slukker
+namespace Interlocking {
+  const double RetryMillis = 100;
+  int fd = -1;
+  std::vector<byte> input;
+  byte nextSeq = 0;
+  bool ctrlWaiting = false;
+  byte ctrlSeq, ctrlName, ctrlValue;
+  double ctrlSent, ctrlResent;
+  const byte Queries[] = {TOGVEJ, TAENDSTED};
+  struct t_Query {
+    bool waiting;
+    byte seq;
+    double sent;
+  };
+  t_Query queries[sizeof(Queries)] = {};
+  double queryDue = 0;
+  unsigned long noUnanswered = 0;
+  byte ackedTogvej = OFF;
+  double ackedMillis = 0;
+  byte sikret = OFF;
+  double sikretMillis = 0;
+  unsigned long noSikret = 0, noMismatch = 0, noResent = 0;
+  bool outputArmed = false;
+  double offMillis = 0;
+  t_Latency ack{"Kvittering:"};
+  t_Latency answer{"Forespørgsel:"};
+  t_Latency output{"Togvej til udgang:"};
+  t_Latency report{"Togvej til melding:"};
+
+  void sendFrame(byte type, byte seq, byte name, byte value) {
+    byte frame[SerialLink::FrameSize] = {SerialLink::Start, type, seq, name, value, 0};
+    frame[SerialLink::FrameSize-1] = SerialLink::crc8(frame+1, SerialLink::FrameSize-2);
+    if (write(fd, frame, sizeof(frame)) != sizeof(frame)) fprintf(stderr, "Kan ikke skrive til pty\n");
+  }
+
+  void sendCtrl(byte name, byte value) {
+    ctrlWaiting = true;
+    ctrlSeq = nextSeq++;
+    ctrlName = name;
+    ctrlValue = value;
+    ctrlSent = ctrlResent = wallMillis();
+    sendFrame(SerialLink::CTRL, ctrlSeq, name, value);
+  }
+
+  void sendQueries(void) {
+    for (byte pos=0; pos < sizeof(Queries); pos++) {
+      t_Query &item = queries[pos];
+      if (item.waiting == true) noUnanswered++;
+      item.waiting = true;
+      item.seq = nextSeq++;
+      item.sent = wallMillis();
+      sendFrame(SerialLink::QUERY, item.seq, Queries[pos], 0);
+    }
+  }
+
+  void onFrame(byte type, byte seq, byte name, byte value) {
+    double now = wallMillis();
+    switch (type) {
+      case SerialLink::ACK:
+        if ((ctrlWaiting == true) && (seq == ctrlSeq)) {
+          ctrlWaiting = false;
+          ack.add(now-ctrlSent);
+          if (ctrlName == TOGVEJ) {
+            ackedTogvej = ctrlValue;
+            ackedMillis = now;
+          }
+        }
+      break;
+      case SerialLink::STATUS:
+        for (byte pos=0; pos < sizeof(Queries); pos++) {
+          t_Query &item = queries[pos];
+          if ((item.waiting == false) || (seq != item.seq) || (name != Queries[pos])) continue;
+          item.waiting = false;
+          answer.add(now-item.sent);
+          // Forespørgsel sendt efter kvittering skal se den kvitterede togvej
+          if ((name == TOGVEJ) && (item.sent > ackedMillis) && (value != ackedTogvej)) noMismatch++;
+        }
+      break;
+      case SerialLink::DEVICE:
+        sendFrame(SerialLink::ACK, seq, name, value);
+        if ((name == SIKRETMELD) && (value != sikret)) {
+          sikret = value;
+          sikretMillis = now;
+          if (sikret == ON) noSikret++;
+          else if (offMillis > 0) report.add(now-offMillis);
+        }
+      break;
+    }
+  }
+
+  void poll(void) {
+    byte buffer[64];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) input.insert(input.end(), buffer, buffer+length);
+    size_t pos = 0;
+    while (input.size()-pos >= SerialLink::FrameSize) {
+      const byte *frame = input.data()+pos;
+      if ((frame[0] != SerialLink::Start) || (SerialLink::crc8(frame+1, SerialLink::FrameSize-2) != frame[SerialLink::FrameSize-1])) {
+        pos++;
+        continue;
+      }
+      onFrame(frame[1], frame[2], frame[3], frame[4]);
+      pos += SerialLink::FrameSize;
+    }
+    input.erase(input.begin(), input.begin()+pos);
+    double now = wallMillis();
+    if ((ctrlWaiting == true) && (now-ctrlResent > RetryMillis)) {
+      ctrlResent = now;
+      noResent++;
+      sendFrame(SerialLink::CTRL, ctrlSeq, ctrlName, ctrlValue);
+    }
+    if (now >= queryDue) {
+      queryDue = now+250;
+      sendQueries();
+    }
+  }
+
+  void onWrite(byte pin, byte value) {
+    if ((outputArmed == true) && (pin == ARDPin.OUSignAB) && (value == HIGH)) {
+      output.add(wallMillis()-offMillis);
+      outputArmed = false;
+    }
+  }
+}
+
+// Ansvar: Togplan i realtid. Hvert tog gennemløber trinene i rækkefølge.
+namespace Scenario {
+  enum {TOGVEJSAT, TRYK, SLIP, SIKRET, OPLOEST, SLUKKET, FAERDIG};
+  byte step = TOGVEJSAT;
+  double due = 500;
+  unsigned long train = 0;
+  bool failed = false;
+
+  void doStep(unsigned long noTrains) {
+    double now = wallMillis();
+    if (now < due) return;
+    switch (step) {
+      case TOGVEJSAT:
+        Interlocking::sendCtrl(TOGVEJ, ON);
+        step = TRYK; due = now+200;
+      break;
+      case TRYK:
+        Sim::setInput(ARDPin.Taendsted, LOW);
+        step = SLIP; due = now+300;
+      break;
+      case SLIP:
+        Sim::setInput(ARDPin.Taendsted, HIGH);
+        step = SIKRET; due = now+20000;
+      break;
+      case SIKRET:
+        // Sikret melding skal komme inden tidsgrænsen, ellers er det en fejl
+        if (Interlocking::sikret == OFF) {
+          fprintf(stderr, "Tog %lu: Ingen melding om sikret\n", train+1);
+          failed = true;
+          step = FAERDIG;
+          break;
+        }
+        step = OPLOEST; due = Interlocking::sikretMillis+500;
+      break;
+      case OPLOEST:
+        Interlocking::offMillis = now;
+        Interlocking::outputArmed = true;
+        Interlocking::sendCtrl(TOGVEJ, OFF);
+        step = SLUKKET; due = now+Timing.BarrierTime+500;
+      break;
+      case SLUKKET:
+        train++;
+        step = (train < noTrains)?TOGVEJSAT:FAERDIG;
+        due = now+500;
+      break;
+    }
+  }
+
+  void onSikret(void) {if ((step == SIKRET) && (Interlocking::sikret == ON)) due = 0;}
+}
+
+int openPty(int &slave) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0)) return -1;
+  slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (slave < 0) return -1;
+  struct termios mode;
+  tcgetattr(slave, &mode);
+  cfmakeraw(&mode);
+  tcsetattr(slave, TCSANOW, &mode);
+  fcntl(master, F_SETFL, O_NONBLOCK);
+  fcntl(slave, F_SETFL, O_NONBLOCK);
+  return master;
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long noTrains = 2;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-n") == 0) && (cnt+1 < argc)) noTrains = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-b") == 0) && (cnt+1 < argc)) Uart::baud = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-f") == 0) && (cnt+1 < argc)) Uart::errorPromille = strtoul(argv[++cnt], nullptr, 10);
+    else {
+      fprintf(stderr, "Brug: %s [-n tog] [-b baud] [-f bitfejl promille]\n", argv[0]);
+      return 2;
+    }
+  }
+  Interlocking::fd = openPty(Uart::fd);
+  if (Interlocking::fd < 0) {
+    fprintf(stderr, "Kan ikke åbne pty\n");
+    return 1;
+  }
+  printf("Seriel forbindelse:   %s, %lu baud, bitfejl %u promille\n", ptsname(Interlocking::fd), Uart::baud, Uart::errorPromille);
+  fflush(stdout);
+
+  Sim::onWrite = Interlocking::onWrite;
+  setup();
+  unsigned long nextCycle = Clock::ClockCycle;
+  while (Scenario::step != Scenario::FAERDIG) {
+    struct pollfd fds[2] = {{Interlocking::fd, POLLIN, 0}, {Uart::fd, POLLIN, 0}};
+    int timeout = (Uart::hasBacklog() == true)?1:(int)(nextCycle-(unsigned long)wallMillis());
+    if (timeout < 0) timeout = 0;
+    if (timeout > Clock::ClockCycle) timeout = Clock::ClockCycle;
+    poll(fds, 2, timeout);
+    // Virtuel tid følger væguret
+    unsigned long long wallMicros = (unsigned long long)(wallMillis()*1000);
+    if (wallMicros > Sim::clockMicros) Sim::advanceMicros(wallMicros-Sim::clockMicros);
+    Uart::pump();
+    if (millis() >= nextCycle) {
+      Clock::pendulum();
+      nextCycle = (millis()/Clock::ClockCycle+1)*Clock::ClockCycle;
+      Blinker::doClockCycle();
+      crossing.doClockCycle();
+      Uart::pump();
+    }
+    Interlocking::poll();
+    Scenario::onSikret();
+    Scenario::doStep(noTrains);
+  }
+
+  printf("Tog:                  %lu, sikret meldt %lu gange\n", Scenario::train, Interlocking::noSikret);
+  printf("%-22s %6s / %6s / %6s\n", "Latens:", "min", "middel", "maks");
+  Interlocking::ack.print();
+  Interlocking::answer.print();
+  Interlocking::output.print();
+  Interlocking::report.print();
+  printf("Rammer modtaget:      %lu, med fejl %lu, tabte byte %lu\n", SerialLink::noFrames, SerialLink::noErrors, SerialLink::noOverruns);
+  printf("Gentagelser:          %lu til sikringsanlæg, %lu fra sikringsanlæg\n", SerialLink::noRetries, Interlocking::noResent);
+  printf("Vendte bit:           %lu\n", Uart::noCorrupted);
+  printf("Forkert status:       %lu\n", Interlocking::noMismatch);
+  printf("Ubesvarede:           %lu forespørgsler, %lu tabt i fuld kø\n", Interlocking::noUnanswered, SerialLink::noLostQueries);
+  // Med bitfejl kan en forespørgsel eller et svar gå tabt på vejen
+  bool ok = (Scenario::failed == false) && (Interlocking::noSikret == noTrains) && (Interlocking::noMismatch == 0) &&
+            ((Interlocking::noUnanswered == 0) || (Uart::errorPromille > 0));
+  return (ok == true)?0:1;
+}
@@ -0,0 +1,217 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Kontrol af servopulser fra én timer mod simuleret timer
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Kører ServoPulse fra OvkServoPuls.h mod timer 1 i Arduino.h. Simulatoren kalder ServoPulse::onCompare(),
+ * når TCNT1 når OCR1A, og registrerer benenes kanter i virtuel tid.
+ * 2 sæt vejbomme med 2 bomme hver bevæger sig uafhængigt mellem 544 og 2400 µsek. Pulsbredder skrives midt i rammer.
+ * Hver puls kontrolleres mod seneste skrevne pulsbredde før rammestart og skal have præcis den bredde,
+ * også når bommene i et sæt er justeret få µsek fra hinanden. Rammeperioden skal være 20 msek.
+ * Hvert interrupt forsinkes tilfældigt op til en grænse, som når millis() interrupt kører først.
+ * Pulser og rammeperiode må afvige op til grænsen, men en overset compare giver en puls, der er 32 msek for lang.
+ * Med -i 0 kommer interrupt til tiden, og alle pulser skal være præcise.
+ * Interrupts, skrivninger til porte og tid i interrupt på Linux tælles per ramme.
+ * Brug: ovk_servopuls [-f rammer] [-a justering µsek] [-i forsinkelse µsek] [-s frø] [-l]
+ * -a lægger justeringen til anden bom i hvert sæt. Uden -a har bommene i et sæt samme pulsbredde og deler kant.
+ * -i: Længste forsinkelse af interrupt, standard 30 µsek. -i 0 giver interrupt til tiden.
+ * Afslutter med 0 når alle pulser passer og 1 ved fejl.
+ */
+
+#define BrugServoPuls
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "OvkServoPuls.h"
+
+// Ansvar: Opsamler kanter på servoernes ben og kontrollerer pulserne.
+// Pins: Ben for de 4 servoer. Sæt 1 på port B og sæt 2 på port D
+// t_Write: Pulsbredde skrevet til en servo på et tidspunkt
+// writes: Skrevne pulsbredder for hver servo i tidsorden
+// lastRise: Tid for seneste stigende kant for hver servo
+// latency: Længste forsinkelse af interrupt i µsek
+// noPulses, noExact, noDelayed, noErrors, noPeriodErrors: Optalte pulser. noDelayed afviger højst latency af forsinket interrupt
+// logFrames: Antal rammer der logges med -l
+// expected(...): Seneste pulsbredde skrevet før et tidspunkt
+// onWrite(...): Kaldes af simulatorens kort ved ændring af et ben
+namespace SimPulses {
+  const byte Pins[ServoPulse::MaxNoServos] = {9, 10, 5, 6};
+  const unsigned long FrameMicros = ServoPulse::FrameTicks/ServoPulse::TicksPerMicros;
+  struct t_Write {
+    unsigned long long atMicros;
+    int pulseWidth;
+  };
+  std::vector<t_Write> writes[ServoPulse::MaxNoServos];
+  unsigned long long lastRise[ServoPulse::MaxNoServos] = {};
+  unsigned int latency = 30;
+  unsigned long noPulses = 0;
+  unsigned long noExact = 0;
+  unsigned long noDelayed = 0;
+  unsigned long noErrors = 0;
+  unsigned long noPeriodErrors = 0;
+  unsigned long logFrames = 0;
+
+  int expected(byte servo, unsigned long long atMicros) {
+    int result = 1500;
+    for (const t_Write &item: writes[servo]) {
+      if (item.atMicros >= atMicros) break;
+      result = item.pulseWidth;
+    }
+    return result;
+  }
+
+  void onWrite(byte pin, byte value) {
+    byte servo;
+    for (servo=0; servo < ServoPulse::MaxNoServos; servo++) if (Pins[servo] == pin) break;
+    if (servo == ServoPulse::MaxNoServos) return;
+    if (ServoPulse::noFrames <= logFrames) printf("%12llu D%u %u\n", Sim::clockMicros, pin, value);
+    if (value == HIGH) {
+      long period = (long)(Sim::clockMicros-lastRise[servo]);
+      if ((lastRise[servo] != 0) && (labs(period-(long)FrameMicros) > (long)latency)) noPeriodErrors++;
+      lastRise[servo] = Sim::clockMicros;
+      return;
+    }
+    int measured = Sim::clockMicros-lastRise[servo];
+    int wanted = expected(servo, lastRise[servo]);
+    noPulses++;
+    if (measured == wanted) noExact++;
+    else if (abs(measured-wanted) <= (int)latency) noDelayed++;
+    else {
+      if (noErrors < 10) fprintf(stderr, "Fejl: D%u ved %llu µsek: puls %d µsek, ventet %d µsek\n", pin, lastRise[servo], measured, wanted);
+      noErrors++;
+    }
+  }
+}
+
+// Ansvar: Arbejde i interrupt per ramme.
+// compares, portWrites, nanos: Interrupts, skrivninger til porte og tid i interrupt på Linux i aktuel ramme
+// maxCompares, maxPortWrites: Største antal i en ramme. sum...: Sum over afsluttede rammer
+// noFrames: Afsluttede rammer
+// endFrame(...): Afslutter en ramme
+namespace SimWork {
+  unsigned long compares = 0, portWrites = 0;
+  double nanos = 0;
+  unsigned long maxCompares = 0, maxPortWrites = 0;
+  unsigned long sumCompares = 0, sumPortWrites = 0;
+  double sumNanos = 0;
+  unsigned long noFrames = 0;
+
+  void endFrame(void) {
+    if (compares > maxCompares) maxCompares = compares;
+    if (portWrites > maxPortWrites) maxPortWrites = portWrites;
+    sumCompares += compares;
+    sumPortWrites += portWrites;
+    sumNanos += nanos;
+    noFrames++;
+    compares = portWrites = 0;
+    nanos = 0;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long noFrames = 10000;
+  int adjust = 0;
+  unsigned long seed = 1;
+  bool isValid = true;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-f") == 0) && (cnt+1 < argc)) noFrames = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-a") == 0) && (cnt+1 < argc)) adjust = atoi(argv[++cnt]);
+    else if ((strcmp(argv[cnt], "-i") == 0) && (cnt+1 < argc)) SimPulses::latency = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-s") == 0) && (cnt+1 < argc)) seed = strtoul(argv[++cnt], nullptr, 10);
+    else if (strcmp(argv[cnt], "-l") == 0) SimPulses::logFrames = 3;
+    else isValid = false;
+  }
+  if ((isValid == false) || (noFrames == 0) || (adjust < 0) || (adjust > 100) || (SimPulses::latency > 1000)) {
+    fprintf(stderr, "Brug: %s [-f rammer] [-a justering µsek] [-i forsinkelse µsek] [-s frø] [-l]\n", argv[0]);
+    return 2;
+  }
+
+  std::mt19937 random(seed);
+  const int PulseMin = 544;
+  const int PulseMax = 2400-adjust;
+  t_ServoPulse servos[ServoPulse::MaxNoServos];
+  int position[2] = {PulseMin, PulseMax};
+  int target[2] = {PulseMax, PulseMin};
+  Sim::onWrite = SimPulses::onWrite;
+  for (byte servo=0; servo < ServoPulse::MaxNoServos; servo++) {
+    servos[servo].attach(SimPulses::Pins[servo]);
+    SimPulses::writes[servo].push_back(SimPulses::t_Write{Sim::clockMicros, servos[servo].readMicroseconds()});
+  }
+
+  // Nye pulsbredder et tilfældigt sted i hver ramme, så de falder før og efter rammestart
+  std::uniform_int_distribution<unsigned long> writeGap(1, 2*SimPulses::FrameMicros-1);
+  std::uniform_int_distribution<int> step(0, 12);
+  std::uniform_int_distribution<int> newTarget(PulseMin, PulseMax);
+  std::uniform_int_distribution<unsigned int> delay(0, SimPulses::latency);
+  unsigned long long nextWrite = writeGap(random);
+  while (SimWork::noFrames < noFrames) {
+    // Simulatoren læser tiden direkte, da en læsning af TCNT1 flytter tiden
+    unsigned int ticks = (uint16_t)(OCR1A-(uint16_t)(Sim::clockMicros*ServoPulse::TicksPerMicros));
+    if (ticks == 0) ticks = 0x10000;
+    unsigned long long compareAt = Sim::clockMicros+ticks/ServoPulse::TicksPerMicros;
+    if (nextWrite < compareAt) {
+      // En skrivning der faldt under et forsinket interrupt, sker når interrupt er færdigt
+      if (nextWrite > Sim::clockMicros) Sim::advanceMicros(nextWrite-Sim::clockMicros);
+      for (byte set=0; set < 2; set++) {
+        if (position[set] == target[set]) target[set] = newTarget(random);
+        int delta = step(random);
+        if (position[set] < target[set]) position[set] = std::min(position[set]+delta, target[set]);
+        else position[set] = std::max(position[set]-delta, target[set]);
+        for (byte cnt=0; cnt < 2; cnt++) {
+          byte servo = 2*set+cnt;
+          int pulseWidth = position[set]+cnt*adjust;
+          if (pulseWidth == servos[servo].readMicroseconds()) continue;
+          servos[servo].writeMicroseconds(pulseWidth);
+          SimPulses::writes[servo].push_back(SimPulses::t_Write{Sim::clockMicros, pulseWidth});
+        }
+      }
+      nextWrite += writeGap(random);
+      continue;
+    }
+    Sim::advanceMicros(compareAt-Sim::clockMicros+delay(random));
+    if ((ServoPulse::next == ServoPulse::FrameStart) && (ServoPulse::noFrames > 0)) SimWork::endFrame();
+    unsigned long portWrites = Sim::count.portWrites;
+    auto start = std::chrono::steady_clock::now();
+    ServoPulse::onCompare();
+    SimWork::nanos += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-start).count();
+    SimWork::compares++;
+    SimWork::portWrites += Sim::count.portWrites-portWrites;
+  }
+
+  using namespace SimPulses;
+  const unsigned long MaxCompares = ServoPulse::MaxNoServos+1;
+  bool isOk = (noErrors == 0) && (noPeriodErrors == 0) && (SimWork::maxCompares <= MaxCompares) && (noPulses > 0);
+  printf("Rammer:                %lu á %lu µsek, %u servoer, justering %d µsek, forsinkelse op til %u µsek\n",
+    SimWork::noFrames, FrameMicros, ServoPulse::MaxNoServos, adjust, latency);
+  printf("Pulser:                %lu, %lu præcise, %lu forsinket  %s\n", noPulses, noExact, noDelayed, (noErrors == 0)?"OK":"FEJL");
+  printf("Tætte og sene kanter:  %lu udført i samme interrupt som forrige kant\n", ServoPulse::noLate);
+  printf("Rammeperiode:          %lu afvigelser over %u µsek fra %lu µsek  %s\n", noPeriodErrors, latency, FrameMicros, (noPeriodErrors == 0)?"OK":"FEJL");
+  printf("Interrupts per ramme:  %.2f i gennemsnit, højst %lu, grænse %lu  %s\n",
+    (double)SimWork::sumCompares/SimWork::noFrames, SimWork::maxCompares, MaxCompares, (SimWork::maxCompares <= MaxCompares)?"OK":"FEJL");
+  printf("Portskrivninger:       %.2f per ramme i gennemsnit, højst %lu\n", (double)SimWork::sumPortWrites/SimWork::noFrames, SimWork::maxPortWrites);
+  printf("Tid i interrupt:       %.0f nsek per ramme i gennemsnit på Linux\n", SimWork::sumNanos/SimWork::noFrames);
+  printf("Resultat:              %s\n", (isOk == true)?"OK":"FEJL");
+  return (isOk == true)?0:1;
+}
@@ -0,0 +1,249 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Simulator til overkørsel
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Kører reference overkørsel hurtigere end realtid i virtuel tid.
+ * Brug: ovk_sim [-t sekunder] [-s scriptfil] [-p togperiode sekunder] [-b µsek] [-c µsek] [-o n:µsek] [-l] [-d fil]
+ * Uden script bliver der dannet en togplan.
+ * -b: Tid i µsek som en klokcyklus belaster arduino med i virtuel tid.
+ * -c: Tid i µsek som hvert kald til hardware tager i virtuel tid.
+ * -o: Hver n'te klokcyklus belaster arduino med yderligere µsek, for eksempel -o 1000:12000.
+ * ovk_sim_tickless er oversat med BrugTicklessKlok og rapporterer søvn og forsinkelse ved opvågning.
+ * ovk_sim_event er oversat med BrugHaendelsesstyring. Antal kald per klokcyklus kan sammenlignes med ovk_sim.
+ * ovk_sim_hjul er oversat med BrugTimerhjul og rapporterer antal timere berørt per klokcyklus.
+ * ovk_sim_port er oversat med BrugPortbuffer. Skrivninger til porte per klokcyklus kan sammenlignes med ovk_sim.
+ * ovk_sim_filter er oversat med BrugPortfilter. Læsninger af porte per klokcyklus kan sammenlignes med ovk_sim.
+ * ovk_sim_statisk kører RefOverkoerselStatisk.h, som er sammensat med t_StaticCrossing.
+ * ovk_sim_tabel kører RefOverkoerselTabel.h, hvor tilstandsmaskinen er beskrevet i tabeller.
+ * ovk_sim_maaling er oversat med BrugKlokmaaling og rapporterer arbejde per klokcyklus, overskridelser og forsinkelse.
+ * ovk_sim_spor er oversat med BrugSporing. -d fil skriver sporingens udskrift, som ovk_spor afkoder og ovk_replay afspiller.
+ * ovk_sim_kant er oversat med BrugKantfangst. Tændsted fanges med pinskift interrupt, og kanter i køen rapporteres.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#if defined(BrugStatiskOverkoersel)
+#include "RefOverkoerselStatisk.h"
+#elif defined(BrugTilstandstabel)
+#include "RefOverkoerselTabel.h"
+#elif defined(BrugKonfiguration)
+#include "RefOverkoerselKonfig.h"
+#else
+#include "RefOverkoersel.h"
+#endif
+#include "SimScript.h"
+
+// Ansvar: Logger ændringer af udgange med tidsstempel.
+namespace SimLog {
+  unsigned long noEdges = 0;
+  bool enabled = false;
+  void onWrite(byte pin, byte value) {
+    noEdges++;
+    if (enabled == true) printf("%10lu D%-2u %u\n", millis(), pin, value);
+  }
+  void onServo(byte pin, int pulseWidth) {
+    noEdges++;
+    if (enabled == true) printf("%10lu S%-2u %d\n", millis(), pin, pulseWidth);
+  }
+}
+
+#ifdef BrugSporing
+// Ansvar: Modtager sporingens udskrift og skriver den i en fil, som Serial.write ville sende den.
+// Bufferen bliver tømt, når den er halvt fuld, så filen indeholder hele forløbet og kan afspilles af ovk_replay.
+namespace SimTrace {
+  const unsigned int DrainLevel = Trace::Size/2;
+  FILE *file = nullptr;
+  void put(byte value) {fputc(value, file);}
+  void doClockCycle(void) {if ((file != nullptr) && (Trace::used >= DrainLevel)) Trace::drain(put);}
+}
+#endif
+
+#ifdef BrugTicklessKlok
+// Simulatorens kort sover som en Uno og et pinskift vækker klokken
+void simSleep(unsigned long) {Sim::sleep();}
+#endif
+#ifdef BrugKantfangst
+// Et pinskift kalder interrupt for benets port, som også vækker tickless klok
+void simPinChange(byte pin, byte) {EdgeCapture::onPinChange(digitalPinToPort(pin));}
+#elif defined(BrugTicklessKlok)
+void simPinChange(byte, byte) {Clock::wake();}
+#endif
+
+int main(int argc, char *argv[]) {
+  unsigned long simSeconds = 3600;
+  unsigned long trainPeriod = 180;
+  unsigned long busyMicros = 0;
+  unsigned long spikeEvery = 0, spikeMicros = 0;
+  const char *scriptName = nullptr;
+  const char *dumpName = nullptr;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-t") == 0) && (cnt+1 < argc)) simSeconds = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-s") == 0) && (cnt+1 < argc)) scriptName = argv[++cnt];
+    else if ((strcmp(argv[cnt], "-p") == 0) && (cnt+1 < argc)) trainPeriod = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-b") == 0) && (cnt+1 < argc)) busyMicros = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-c") == 0) && (cnt+1 < argc)) Sim::callMicros = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-o") == 0) && (cnt+1 < argc)) {
+      if (sscanf(argv[++cnt], "%lu:%lu", &spikeEvery, &spikeMicros) != 2) spikeEvery = 0;
+    }
+    else if (strcmp(argv[cnt], "-l") == 0) SimLog::enabled = true;
+    else if ((strcmp(argv[cnt], "-d") == 0) && (cnt+1 < argc)) dumpName = argv[++cnt];
+    else {
+      fprintf(stderr, "Brug: %s [-t sekunder] [-s scriptfil] [-p togperiode sekunder] [-b µsek] [-c µsek] [-o n:µsek] [-l] [-d fil]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (dumpName != nullptr) {
+#ifdef BrugSporing
+    SimTrace::file = fopen(dumpName, "wb");
+    if (SimTrace::file == nullptr) {
+      fprintf(stderr, "Kan ikke skrive: %s\n", dumpName);
+      return 1;
+    }
+#else
+    fprintf(stderr, "-d kræver BrugSporing\n");
+#endif
+  }
+  if (scriptName != nullptr) {
+    if (SimScript::loadFile(scriptName) == false) {
+      fprintf(stderr, "Kan ikke læse script: %s\n", scriptName);
+      return 1;
+    }
+  }
+  else SimScript::addTrainSchedule(simSeconds*1000, trainPeriod*1000, ARDPin.ManuelKnap, ARDPin.Taendsted, ARDPin.Togvej);
+
+  Sim::onWrite = SimLog::onWrite;
+  Sim::onServo = SimLog::onServo;
+#ifdef BrugTicklessKlok
+  Clock::idle = simSleep;
+#endif
+#if defined(BrugTicklessKlok) || defined(BrugKantfangst)
+  Sim::onInput = simPinChange;
+#endif
+  setup();
+
+  unsigned long noTicks = 0;
+#ifndef BrugTicklessKlok
+  unsigned long nextCycle = Clock::ClockCycle;
+#endif
+  double totalNs = 0, maxNs = 0;
+  unsigned long long noDispatched = 0;
+  unsigned long maxPortWrites = 0, noWriteTicks = 0;
+#ifdef BrugTimerhjul
+  unsigned long long noTouched = 0;
+#endif
+  auto wallStart = std::chrono::steady_clock::now();
+  while (millis() < simSeconds*1000) {
+#ifndef BrugTicklessKlok
+    // Klokken venter aktivt, så tiden flyttes frem til næste klokcyklus
+#ifdef BrugKlokmaaling
+    CycleStats::stop();   // En Uno venter inde i pendulum(...), så ventetid er ikke arbejde
+#endif
+    if (millis() < nextCycle) Sim::advanceMicros(nextCycle*1000ULL-Sim::clockMicros);
+#endif
+    Clock::pendulum();
+#ifndef BrugTicklessKlok
+    nextCycle = (millis()/Clock::ClockCycle+1)*Clock::ClockCycle;
+#endif
+    Blinker::doClockCycle();
+    unsigned long portWrites = Sim::count.portWrites;
+    auto t0 = std::chrono::steady_clock::now();
+    crossing.doClockCycle();
+    auto t1 = std::chrono::steady_clock::now();
+    portWrites = Sim::count.portWrites-portWrites;
+    if (portWrites > maxPortWrites) maxPortWrites = portWrites;
+    if (portWrites > 0) noWriteTicks++;
+    double ns = std::chrono::duration<double, std::nano>(t1-t0).count();
+    totalNs += ns;
+    if (ns > maxNs) maxNs = ns;
+    noDispatched += crossing.dispatchCount();
+#ifdef BrugTimerhjul
+    noTouched += TimerWheel::noTouched;
+#endif
+#ifdef BrugSporing
+    SimTrace::doClockCycle();
+#endif
+    noTicks++;
+    Sim::advanceMicros(busyMicros);
+    if ((spikeEvery > 0) && ((noTicks % spikeEvery) == 0)) Sim::advanceMicros(spikeMicros);
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-wallStart).count();
+
+  printf("Simuleret tid:        %lu sek\n", simSeconds);
+  printf("Klokcyklusser:        %lu\n", noTicks);
+  printf("Realtid:              %.3f sek (%.0f x realtid)\n", wallSeconds, simSeconds/wallSeconds);
+  printf("doClockCycle middel:  %.1f nsek\n", totalNs/noTicks);
+  printf("doClockCycle maks:    %.1f nsek\n", maxNs);
+  printf("Kald per klokcyklus:  %.2f\n", (double)noDispatched/noTicks);
+#if defined(BrugKonfiguration)
+  printf("RAM til overkørsel:   %u byte + %u byte lager til enheder\n", (unsigned)(sizeof(collection)+sizeof(crossing)), (unsigned)sizeof(konfiguration));
+#elif !defined(BrugStatiskOverkoersel)
+  printf("RAM til overkørsel:   %u byte\n", (unsigned)(sizeof(collection)+sizeof(crossing)));
+#else
+  printf("RAM til overkørsel:   %u byte\n", (unsigned)sizeof(crossing));
+#endif
+  printf("Ændrede udgange:      %lu\n", SimLog::noEdges);
+  printf("digitalWrite kald:    %lu\n", Sim::count.digitalWrites);
+  printf("digitalRead kald:     %lu\n", Sim::count.digitalReads);
+  printf("Portskrivninger:      %lu i %lu klokcyklusser, maks %lu per klokcyklus\n", Sim::count.portWrites, noWriteTicks, maxPortWrites);
+  printf("Portlæsninger:        %lu, %.2f per klokcyklus\n", Sim::count.portReads, (double)Sim::count.portReads/noTicks);
+  printf("Servo skrivninger:    %lu\n", Sim::count.servoWrites);
+#ifdef BrugTimerhjul
+  printf("Timere i hjul:        %u af %u%s\n", TimerWheel::noTimers, MaxNoTimers, (TimerWheel::overflow == true)?" (for mange)":"");
+  printf("Timere berørt:        %.3f per klokcyklus\n", (double)noTouched/noTicks);
+  printf("RAM per urværk:       %u + %u byte\n", (unsigned)sizeof(t_ClockWork), (unsigned)sizeof(TimerWheel::t_Timer));
+#else
+  printf("RAM per urværk:       %u byte\n", (unsigned)sizeof(t_ClockWork));
+#endif
+#ifdef BrugTicklessKlok
+  printf("Søvn:                 %u %%\n", Clock::idlePercent());
+  printf("Opvågninger:          %lu\n", Clock::noWakeUps);
+  printf("Forsinkelse middel:   %.1f µsek\n", (Clock::noWakeUps > 0)?(double)Clock::sumJitter/Clock::noWakeUps:0.0);
+  printf("Forsinkelse maks:     %lu µsek\n", Clock::maxJitter);
+#endif
+#ifdef BrugKlokmaaling
+  printf("Arbejde per klokcyklus: %lu klokcyklusser\n", CycleStats::noCycles);
+  for (byte cnt=0; cnt < CycleStats::NoBuckets; cnt++) {
+    if (cnt < CycleStats::NoBuckets-1) printf("  under %5u µsek:    %lu\n", CycleStats::Limit[cnt], CycleStats::histogram[cnt]);
+    else printf("  %5u µsek og over: %lu\n", CycleStats::Limit[cnt-1], CycleStats::histogram[cnt]);
+  }
+  printf("Arbejde maks:         %u µsek\n", CycleStats::worstCycle);
+  printf("Maks per del:         betjening %u, tilstand %u, ydre enheder %u µsek\n", CycleStats::worstPart[CycleStats::CTRLS],
+         CycleStats::worstPart[CycleStats::STATE], CycleStats::worstPart[CycleStats::DEVICES]);
+  printf("Overskridelser:       %lu, %lu klokcyklusser sprunget over\n", CycleStats::noOverruns, CycleStats::lostCycles);
+  printf("Urværker forsinket:   %lu msek\n", CycleStats::driftMillis);
+#endif
+#ifdef BrugSporing
+  printf("Sporing:              %lu hændelser, %lu overskrevet, %u byte i buffer\n", Trace::noEvents, Trace::noDropped, Trace::used);
+#endif
+#ifdef BrugKantfangst
+  printf("Kanter fanget:        %lu, %lu tabt, højst %u af %u i kø\n", EdgeCapture::edgeCount(), EdgeCapture::overflowCount(), EdgeCapture::maxUsed, EdgeCapture::Size);
+#endif
+#ifdef BrugSporing
+  if (SimTrace::file != nullptr) {
+    Trace::drain(SimTrace::put);
+    fclose(SimTrace::file);
+  }
+#endif
+  return 0;
+}
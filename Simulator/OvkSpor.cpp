@@ -0,0 +1,114 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Afkodning af sporing fra overkørsel
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Afkoder en udskrift fra Trace::dump(...) til en tidslinje med en hændelse per linje.
+ * Filen kan indeholde flere udskrifter efter hinanden, for eksempel fra Trace::drain(...).
+ * Udskriften kan komme fra en arduino over seriel forbindelse eller fra ovk_sim_spor -d fil.
+ * Navne på tilstande, ydre enheder og flipflops kan gives som kommaseparerede lister i samme rækkefølge som i programmet.
+ * Brug: ovk_spor [-s tilstande] [-e ydre enheder] [-f flipflops] fil
+ *       ovk_spor -b   måler tid per registrering
+ */
+
+#define BrugSporing
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "SimSpor.h"
+
+// Ansvar: Navne fra kommandolinjen. Et tal bliver skrevet, hvis listen ikke har et navn.
+struct t_Names {
+  std::vector<std::string> names;
+  void parse(const char *list) {
+    names.clear();
+    std::string item;
+    for (const char *pos = list; ; pos++) {
+      if ((*pos == ',') || (*pos == 0)) {
+        names.push_back(item);
+        item.clear();
+        if (*pos == 0) break;
+      }
+      else item += *pos;
+    }
+  }
+  std::string of(unsigned int index) const {
+    if (index < names.size()) return names[index];
+    return std::to_string(index);
+  }
+};
+
+// Måler registrering med korte og lange mellemrum, også når ældste hændelser bliver overskrevet
+int bench(void) {
+  const unsigned long NoEvents = 10000000;
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned long cnt = 0; cnt < NoEvents; cnt++) {
+    Trace::cycle += ((cnt & 63) == 0)?1000:(cnt & 3);
+    Trace::record(cnt & 3, cnt);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-t0).count();
+  printf("Registrering:         %.1f nsek per hændelse\n", ns/NoEvents);
+  printf("Byte per hændelse:    %.2f\n", (double)Trace::Size/(Trace::noEvents-Trace::noDropped));
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  t_Names states, devices, flipflops;
+  const char *fileName = nullptr;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-s") == 0) && (cnt+1 < argc)) states.parse(argv[++cnt]);
+    else if ((strcmp(argv[cnt], "-e") == 0) && (cnt+1 < argc)) devices.parse(argv[++cnt]);
+    else if ((strcmp(argv[cnt], "-f") == 0) && (cnt+1 < argc)) flipflops.parse(argv[++cnt]);
+    else if (strcmp(argv[cnt], "-b") == 0) return bench();
+    else if ((argv[cnt][0] != '-') && (fileName == nullptr)) fileName = argv[cnt];
+    else fileName = nullptr, cnt = argc;
+  }
+  if (fileName == nullptr) {
+    fprintf(stderr, "Brug: %s [-s tilstande] [-e ydre enheder] [-f flipflops] fil\n       %s -b\n", argv[0], argv[0]);
+    return 2;
+  }
+  std::vector<SimSpor::t_Event> events;
+  if (SimSpor::loadFile(fileName, events) == false) {
+    fprintf(stderr, "%s\n", SimSpor::error.c_str());
+    return 1;
+  }
+  if (SimSpor::badChecks > 0) fprintf(stderr, "Advarsel: Kontrolsum passer ikke i %lu af %lu udskrifter\n", SimSpor::badChecks, SimSpor::noDumps);
+
+  printf("%10s %10s  %s\n", "Klokcyklus", "Sekunder", "Hændelse");
+  for (const SimSpor::t_Event &event : events) {
+    byte name = event.data & 0x7F;
+    bool level = (event.data & 0x80) != 0;
+    printf("%10lu %10.3f  ", event.cycle, event.cycle*SimSpor::clockCycle/1000.0);
+    switch (event.type) {
+      case Trace::STATE: printf("tilstand %s\n", states.of(event.data).c_str()); break;
+      case Trace::BUTTON: printf("indgang D%u %s\n", name, level?"høj":"lav"); break;
+      case Trace::FLIPFLOP: printf("flipflop %s %s\n", flipflops.of(name).c_str(), level?"ON":"OFF"); break;
+      case Trace::DEVICE: printf("%s %s\n", devices.of(name).c_str(), level?"PASS":"BLOCK"); break;
+      case Trace::RAW: printf("læst D%u %s\n", name, level?"høj":"lav"); break;
+      case Trace::LINK: printf("sikringsanlæg %u %s\n", name, level?"ON":"OFF"); break;
+      default: printf("ukendt type %u data 0x%02X\n", event.type, event.data); break;
+    }
+  }
+  return 0;
+}
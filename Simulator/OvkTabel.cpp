@@ -0,0 +1,240 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Kontrol af overgange med betingelse og timer i tilstandstabel
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Noter:
+ * Kører en lille tilstandstabel med en overgang, der kræver både en betjeningsenhed og udløbet tid,
+ * i t_Crossing og i t_CrossingFleet. Tiden skal tælles hver klokcyklus som i en klasse med clockWork.triggered(),
+ * også mens betjeningsenheden er OFF. Overgangen skal derfor ske ved første udløb efter betjeningsenheden er ON,
+ * og udløbene ligger fast i forhold til, hvornår tilstanden startede.
+ * Første runde måler første udløb med betjeningsenheden ON fra tilstanden starter. Hver følgende runde sætter den ON et tilfældigt
+ * sted i op til 3 perioder og kontrollerer, at overgangen sker ved det forventede udløb.
+ * Brug: ovk_tabel [-n runder] [-s frø]
+ * Afslutter med 0 når alle runder passer og 1 ved fejl.
+ */
+
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <Arduino.h>
+
+// Tidsenhed til urværk
+enum {MSEC, SECONDS};
+// Kontakttyper for trykknap
+enum {NOPEN, NCLOSED};
+// Overkørslens betjeningsenheder magasin kan konfigureres
+enum {BISTABLE, ONESHOT};
+// Overkørslens betjeningsenheder leverer
+enum {OFF, ON};
+// Overkørslens ydre enheder kan blive sat til
+enum {BLOCK, PASS};
+
+// Betjeningsenhed, ingen ydre enheder og 2 tilstande
+const byte MaxNoCtrls = 1;
+enum {KNAP};
+const byte MaxNoDevices = 1;
+const byte MaxNoStates = 2;
+enum {HVILE, AKTIV};
+#ifdef BrugTimerhjul
+// Urværker: Blinker og tilstandsmaskine
+const byte MaxNoTimers = 3;
+#endif
+
+#ifndef BrugTilstandstabel
+#define BrugTilstandstabel
+#endif
+#ifndef BrugAnlaeg
+#define BrugAnlaeg
+#endif
+#include <Ovkoersel.h>
+
+#ifdef BrugTicklessKlok
+void simSleep(unsigned long) {Sim::sleep();}
+#endif
+
+// HVILE: Går til AKTIV, når knappen er ON og tiden er udløbet. Tiden starter ved ENTRY.
+// AKTIV: Går til HVILE, når knappen er OFF.
+const unsigned int Periode = 100;
+constexpr StateTable::t_Transition Overgange[] PROGMEM = {
+  {HVILE, StateTable::ctrl(KNAP), 0, true, AKTIV},
+  {AKTIV, 0, StateTable::ctrl(KNAP), false, HVILE},
+};
+constexpr StateTable::t_Action Handlinger[] PROGMEM = {
+  {HVILE, StateTable::ENTRY, StateTable::MSEC, 0, Periode},
+};
+static_assert(StateTable::isSorted(Overgange) && StateTable::isSorted(Handlinger), "Tilstandstabel er ikke sorteret efter tilstand");
+static_assert(StateTable::deadEnds(Overgange) == 0, "En tilstand har ingen overgang");
+
+// Ansvar: Knap som testen sætter direkte uden kontaktprel.
+class t_TestIn: public t_DigitalInDrv {
+private:
+  bool level;
+public:
+  t_TestIn(void): level(OFF) {value = OFF;}
+  void set(bool a_level) {level = a_level;}
+  void doClockCycle(void) {value = level;}
+};
+
+// Ansvar: Afvikler tabellen i t_Crossing med simulatorens klok.
+// begin(...): Kobler knap og tabel og starter i HVILE. tick(...): Én gennemløb af loop
+// now(...), state(...), isOn(...): Tid i msek, tilstand og knappens status. set(...): Sætter knappen
+struct t_CrossingEngine {
+  const char *name = "t_Crossing:";
+  t_TestIn knapDrv;
+  t_CrossingCtrl knap;
+#ifndef BrugTicklessKlok
+  unsigned long nextCycle = Clock::ClockCycle;
+#endif
+  void begin(void) {
+#ifdef BrugTicklessKlok
+    Clock::idle = simSleep;
+#endif
+    knap.setDriver(&knapDrv);
+    collection.initialize();
+    crossing.setCtrl(KNAP, &knap);
+    crossing.setTable(Overgange, Handlinger);
+    crossing.initState(HVILE);
+  }
+  void tick(void) {
+#ifndef BrugTicklessKlok
+    if (millis() < nextCycle) Sim::advanceMicros(nextCycle*1000ULL-Sim::clockMicros);
+#endif
+    Clock::pendulum();
+    crossing.doClockCycle();
+#ifndef BrugTicklessKlok
+    nextCycle = (millis()/Clock::ClockCycle+1)*Clock::ClockCycle;
+#endif
+  }
+  unsigned long now(void) {return millis();}
+  byte state(void) {return crossing.state();}
+  bool isOn(void) {return crossing.status(KNAP) == ON;}
+  void set(bool level) {knapDrv.set(level);}
+};
+
+// Ansvar: Afvikler tabellen for én overkørsel i t_CrossingFleet med egen tid. Knappen har kontaktprel som i anlæg.
+struct t_FleetEngine {
+  const char *name = "t_CrossingFleet:";
+  t_CrossingFleet<1> fleet;
+  unsigned long millis = 0;
+  byte inputs = 0;
+  void begin(void) {
+    fleet.setTable(Overgange, Handlinger, HVILE);
+    fleet.setCtrl(KNAP, NOPEN);
+    fleet.add();
+  }
+  void tick(void) {
+    millis += Clock::ClockCycle;
+    fleet.setInput(0, inputs);
+    fleet.doClockCycle();
+  }
+  unsigned long now(void) {return millis;}
+  byte state(void) {return fleet.stateOf(0);}
+  bool isOn(void) {return fleet.status(0, KNAP) == ON;}
+  void set(bool level) {inputs = (level == true)?(1 << KNAP):0;}
+};
+
+// Ansvar: Kører runder og tæller overgange på forkert tid.
+// MaxMillis: Længste tid en runde venter på en tilstand
+// Tolerance: Afvigelse i msek fra millis() i tickless klok. Under en klokcyklus, så en forkert cyklus opdages
+// waitFor(...): Kører til tilstanden er nået. Leverer tid hvor knappen først var ON, eller 0
+template <typename T>
+struct t_Check {
+  static const unsigned long MaxMillis = 50*Periode;
+  static const unsigned long Tolerance = Clock::ClockCycle/2;
+  T &engine;
+  unsigned long noErrors = 0;
+  t_Check(T &a_engine): engine(a_engine) {}
+
+  unsigned long waitFor(byte stateNo, bool &isTimedOut) {
+    unsigned long start = engine.now(), onMillis = 0;
+    isTimedOut = false;
+    while (engine.state() != stateNo) {
+      if (engine.now()-start > MaxMillis) {
+        isTimedOut = true;
+        break;
+      }
+      engine.tick();
+      if ((onMillis == 0) && (engine.isOn() == true)) onMillis = engine.now();
+    }
+    return onMillis;
+  }
+
+  bool run(unsigned long noRounds, std::mt19937 &random) {
+    std::uniform_int_distribution<unsigned long> offset(0, 3*Periode);
+    bool isTimedOut;
+    // Første udløb måles fra en overgang til HVILE som i de følgende runder
+    engine.set(true);
+    engine.begin();
+    waitFor(AKTIV, isTimedOut);
+    engine.set(false);
+    waitFor(HVILE, isTimedOut);
+    unsigned long entryMillis = engine.now();
+    engine.set(true);
+    waitFor(AKTIV, isTimedOut);
+    unsigned long first = engine.now()-entryMillis;
+    if (isTimedOut == true) noErrors++;
+    for (unsigned long round=0; (round < noRounds) && (isTimedOut == false); round++) {
+      engine.set(false);
+      waitFor(HVILE, isTimedOut);
+      entryMillis = engine.now();
+      unsigned long onAt = entryMillis+offset(random);
+      while (engine.now() < onAt) engine.tick();
+      engine.set(true);
+      unsigned long onMillis = waitFor(AKTIV, isTimedOut);
+      if (onMillis == 0) onMillis = engine.now();
+      // Udløb ligger fast efter tilstanden startede. Overgangen sker ved første udløb, hvor knappen er ON
+      unsigned long expected = entryMillis+first;
+      while (expected+Tolerance < onMillis) expected += Periode;
+      if ((isTimedOut == true) || (engine.now()+Tolerance < expected) || (engine.now() > expected+Tolerance)) {
+        if (noErrors < 10) fprintf(stderr, "Fejl: %s HVILE startet ved %lu msek, knap ON ved %lu msek: AKTIV ved %lu msek, ventet %lu msek\n",
+          engine.name, entryMillis, onMillis, engine.now(), expected);
+        noErrors++;
+      }
+    }
+    printf("%-22s %lu runder, første udløb efter %lu msek, periode %u msek, %lu fejl  %s\n",
+      engine.name, noRounds, first, Periode, noErrors, (noErrors == 0)?"OK":"FEJL");
+    return noErrors == 0;
+  }
+};
+
+int main(int argc, char *argv[]) {
+  unsigned long noRounds = 200;
+  unsigned long seed = 1;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-n") == 0) && (cnt+1 < argc)) noRounds = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-s") == 0) && (cnt+1 < argc)) seed = strtoul(argv[++cnt], nullptr, 10);
+    else {
+      fprintf(stderr, "Brug: %s [-n runder] [-s frø]\n", argv[0]);
+      return 2;
+    }
+  }
+  std::mt19937 random(seed);
+  t_CrossingEngine crossingEngine;
+  t_FleetEngine fleetEngine;
+  t_Check<t_CrossingEngine> crossingCheck(crossingEngine);
+  t_Check<t_FleetEngine> fleetCheck(fleetEngine);
+  bool isOk = crossingCheck.run(noRounds, random);
+  isOk = fleetCheck.run(noRounds, random) && isOk;
+  printf("Resultat:              %s\n", (isOk == true)?"OK":"FEJL");
+  return (isOk == true)?0:1;
+}
@@ -0,0 +1,471 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Udforskning af sikkerhedskrav for overkørslens tilstandsmaskine
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Kører RefOverkoersel.h med tilfældige eller alle kombinationer af manuelknap, tændsted og togvej i virtuel tid.
+ * Oversat med BrugAnkomsttid køres RefOverkoerselAnkomst.h, hvor målested også skifter, og VENTER skal forlades,
+ * når ventetiden er gået. Oversat med BrugTilstandstabel køres RefOverkoerselTabel.h. Oversat med BrugTicklessKlok sover klokken mellem behov.
+ * Indgangene skifter på vilkårlige msek, også kortere end kontaktprel. Efter hver klokcyklus kontrolleres udgangene:
+ * Banesignal viser kun kør, når bommen er nede, og vejlys har blinket længe nok til forring og bomvandring.
+ * Hvid lanterne lyser aldrig sammen med rød. Bommen forlader kun oppe stilling, når vejlys har blinket i forring,
+ * og vejlys blinker så længe bommen ikke er oppe. Ingen tilstand varer længere end sin tid eller sin betingelse tillader.
+ * Hvert forløb køres i en proces kopieret fra programmet lige efter setup(), så alle objekter starter forfra.
+ * Et forløb med fejl bliver reduceret til de færreste skift af indgange, som giver samme fejl, og skrevet som script.
+ * Brug: ovk_udforsk [-n klokcyklusser] [-s frø] [-e dybde:msek] [-t msek] [-r scriptfil] [-o scriptfil]
+ * -n: Klokcyklusser i alt for tilfældige forløb. -s: Frø til første forløb.
+ * -t: millis() ved start af hvert forløb. 4294667296 får millis() til at løbe rundt 300 sek inde i forløbet.
+ * -e: Alle kombinationer af skift på en indgang eller intet skift for hvert trin på msek, dybde trin i træk.
+ * -r: Afspiller et script og kontrollerer det. -o: Fil til reduceret script, standard ovk_udforsk_fejl.txt.
+ * Scriptet kan også afspilles med ovk_sim -s scriptfil -l.
+ * ovk_udforsk_kontrol kører ovk_udforsk, ovk_udforsk_ankomst, ovk_udforsk_tabel og ovk_udforsk_tickless ved hver oversættelse,
+ * også med millis() der løber rundt, så et brudt krav stopper oversættelsen.
+ * Kontrollen måler tid med Sim::elapsedMillis(), som ikke løber rundt.
+ * Afslutter med 0 når alle krav holder og 1 ved fejl.
+ */
+
+#if defined(BrugServoPuls) || defined(BrugPortudvidelse) || defined(BrugLysdaemper)
+#error "ovk_udforsk læser udgange på kortets ben og kan ikke bruges med servopulser, portudvidelser eller lysdæmper"
+#endif
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#if defined(BrugAnkomsttid)
+#include "RefOverkoerselAnkomst.h"
+#elif defined(BrugTilstandstabel)
+#include "RefOverkoerselTabel.h"
+#else
+#include "RefOverkoersel.h"
+#endif
+#include "SimScript.h"
+
+#ifdef BrugTicklessKlok
+void simSleep(unsigned long) {Sim::sleep();}
+#endif
+#ifdef BrugKantfangst
+void simPinChange(byte pin, byte) {EdgeCapture::onPinChange(digitalPinToPort(pin));}
+#elif defined(BrugTicklessKlok)
+void simPinChange(byte, byte) {Clock::wake();}
+#endif
+
+// Ansvar: Kontrollerer sikkerhedskrav ud fra udgangene efter hver klokcyklus.
+// Krav: RAILPASS: Banesignal viser kør uden nede bom og vejlys i tide. WHITELAMP: Hvid lanterne lyser sammen med rød
+//   BARRIER: Bommen går ned uden vejlys i forring eller er ikke oppe uden vejlys. STUCK: En tilstand varer for længe
+//   CRASH: Forløbet stoppede uden at melde
+// UpPW, DownPW: Pulsbredde for bom oppe og nede
+// BlinkLag: Vejlys tænder først ved blinkerens næste skift til tændt, op til 2 perioder efter ordren
+// Forring: Tid i FORRING
+// Warning: Tid vejlys mindst har blinket, før bommen forlader oppe
+// Secure: Tid vejlys mindst har blinket, før banesignal viser kør
+// Slack: Tilstand skifter og udgange følger op til 2 klokcyklusser efter betingelsen
+// MaxDwell: Længste tid i hver tilstand. IKKESIKRET, VENTER og SIKRET har ingen grænse, men skifter når betingelsen holder
+// lastRise, blockSince, isBlocking: Vejlys seneste tænding, start af blink og om det blinker
+// isBarrierUp: Bom oppe efter forrige klokcyklus
+// stateNo, stateSince, exitSince: Tilstand, dens start og start af betingelse til at skifte
+// visited: Tilstandsskift set, index fra*NoStates+til
+// reset(...): Starter kontrol efter setup()
+// exitHolds(...): Betingelsen til at forlade IKKESIKRET, VENTER eller SIKRET. VENTER forlades, når ventetiden er gået
+// check(...): Leverer krav der ikke holder, eller NONE
+// isQuiet(...): Overkørslen kan blive i sin tilstand, og udgangene er faldet til ro
+namespace SimInvariant {
+  enum {NONE, RAILPASS, WHITELAMP, BARRIER, STUCK, CRASH, NoInvariants};
+  const char *Text[NoInvariants] = {"Ingen", "Banesignal viser kør uden nede bom og vejlys i tide", "Hvid lanterne lyser sammen med rød",
+    "Bom er ikke oppe uden vejlys i forring", "Tilstand varer for længe", "Forløbet stoppede"};
+  const byte NoStates = OPLOES+1;
+#ifdef BrugAnkomsttid
+  const char *StateText[NoStates] = {"IKKESIKRET", "VENTER", "FORRING", "BOMNED", "SIKRET", "OPLOES"};
+#else
+  const char *StateText[NoStates] = {"IKKESIKRET", "FORRING", "BOMNED", "SIKRET", "OPLOES"};
+#endif
+  const int UpPW = map(Timing.AngleAdjust, PWMLimits.AngleMin, PWMLimits.AngleMax, PWMLimits.PulseWidthMin, PWMLimits.PulseWidthMax);
+  const int DownPW = map(Timing.AngleAdjust+PWMLimits.AngleDiff, PWMLimits.AngleMin, PWMLimits.AngleMax, PWMLimits.PulseWidthMin, PWMLimits.PulseWidthMax);
+  // Tilstandstabellen har forringstiden udenfor Timing
+#ifdef BrugTilstandstabel
+  const unsigned long Forring = ForringSek*1000UL;
+#else
+  const unsigned long Forring = Timing.Forring*1000;
+#endif
+  const unsigned long Slack = 2*Clock::ClockCycle;
+  const unsigned long BlinkLag = 2*Blinker::Period+Slack;
+  const unsigned long Warning = (Forring > BlinkLag)?Forring-BlinkLag:0;
+  const unsigned long Secure = Warning+Timing.BarrierTime;
+#ifdef BrugAnkomsttid
+  const unsigned long MaxDwell[NoStates] = {0, 0, Forring+Slack, Timing.BarrierTime+Slack, 0, Timing.BarrierTime+Slack};
+#else
+  const unsigned long MaxDwell[NoStates] = {0, Forring+Slack, Timing.BarrierTime+Slack, 0, Timing.BarrierTime+Slack};
+#endif
+  unsigned long lastRise, blockSince;
+  bool isBlocking, isBarrierUp;
+  byte stateNo;
+  unsigned long stateSince, exitSince;
+  bool hasExit;
+  bool visited[NoStates*NoStates];
+
+  void reset(void) {
+    isBlocking = false;
+    isBarrierUp = true;
+    stateNo = crossing.state();
+    stateSince = Sim::elapsedMillis();
+    hasExit = false;
+  }
+
+  bool exitHolds(byte state) {
+    if (state == IKKESIKRET) return (crossing.status(MANUELBETJ) == ON) || ((crossing.status(TAENDSTED) == ON) && (crossing.status(TOGVEJ) == ON));
+#ifdef BrugAnkomsttid
+    if (state == VENTER) return (crossing.status(MANUELBETJ) == ON) || (ankomst.waitTime() == 0);
+#endif
+    if (state == SIKRET) return (crossing.status(TOGVEJ) == OFF) && (crossing.status(MANUELBETJ) == OFF);
+    return true;
+  }
+
+  byte check(void) {
+    unsigned long now = Sim::elapsedMillis();
+    const Sim::t_Board &board = *Sim::board;
+    // Vejlys blinker fra første tænding, til det har været slukket længere end en blinkperiode
+    if (board.output[ARDPin.VejLys] == HIGH) {
+      if (isBlocking == false) blockSince = now;
+      isBlocking = true;
+      lastRise = now;
+    }
+    else if ((isBlocking == true) && (now-lastRise > 2*Blinker::Period+Slack)) isBlocking = false;
+    unsigned long blocked = (isBlocking == true)?now-blockSince:0;
+
+    int pulseWidth = board.servoPW[ARDPin.ServM];
+    bool isUp = (pulseWidth == UpPW);
+    if ((isUp == false) && (isBarrierUp == true) && (blocked < Warning)) return BARRIER;
+    if ((isUp == false) && (isBlocking == false)) return BARRIER;
+    isBarrierUp = isUp;
+
+    bool isPass = (board.output[ARDPin.OUSignAB] == LOW) || (board.output[ARDPin.OUSignBA] == LOW);
+    if ((isPass == true) && ((pulseWidth != DownPW) || (blocked < Secure))) return RAILPASS;
+    if ((board.output[ARDPin.OUSignABHvid] == HIGH) && (board.output[ARDPin.OUSignAB] == HIGH)) return WHITELAMP;
+    if ((board.output[ARDPin.OUSignBAHvid] == HIGH) && (board.output[ARDPin.OUSignBA] == HIGH)) return WHITELAMP;
+
+    byte state = crossing.state();
+    if (state != stateNo) {
+      visited[stateNo*NoStates+state] = true;
+      stateNo = state;
+      stateSince = now;
+      hasExit = false;
+    }
+    if (MaxDwell[stateNo] > 0) return (now-stateSince > MaxDwell[stateNo])?STUCK:NONE;
+    if (exitHolds(stateNo) == false) hasExit = false;
+    else if (hasExit == false) {
+      hasExit = true;
+      exitSince = now;
+    }
+    else if (now-exitSince > Slack) return STUCK;
+    return NONE;
+  }
+
+  bool isQuiet(void) {
+#ifdef BrugAnkomsttid
+    // Et forløb slutter ikke, mens overkørslen venter på toget
+    if (stateNo == VENTER) return false;
+#endif
+    return (MaxDwell[stateNo] == 0) && (hasExit == false) && (isBlocking == (stateNo == SIKRET)) &&
+      (Sim::elapsedMillis()-stateSince > 2*Blinker::Period+Slack);
+  }
+}
+
+// Ansvar: Danner forløb, kører dem hver i sin proces og reducerer forløb med fejl.
+// NoInputs, Pins, Rest, Names: Indgange, deres hvileniveau og navne
+// MaxGap: Længste tid mellem skift i tilfældige forløb
+// Horizon: Længde af et tilfældigt forløb
+// MinSettle, MaxSettle: Korteste og længste tid efter sidste skift, til overkørslen skal være faldet til ro. Korteste dækker kontaktprel
+// t_Result: ticks: Klokcyklusser kørt. invariant, atMillis, state: Krav der ikke holdt, tiden og tilstanden. visited: Tilstandsskift set
+// shared: Resultat fra seneste forløb. Deles med processen der kører forløbet
+// t_Random: Xorshift generator, så forløb kan gentages fra frø
+// run(...): Kører et forløb i denne proces
+// test(...): Kører et forløb i en ny proces og leverer resultatet
+// randomEpisode(...): Danner et tilfældigt forløb
+// gridEpisode(...): Danner forløb nummer index blandt alle kombinationer på et gitter
+// minimise(...): Fjerner skift så længe samme krav stadig ikke holder
+// write(...): Skriver forløb som script til SimScript::loadFile(...)
+namespace SimExplore {
+#ifdef BrugAnkomsttid
+  const byte NoInputs = 4;
+  const byte Pins[NoInputs] = {ARDPin.ManuelKnap, ARDPin.Maalested, ARDPin.Taendsted, ARDPin.Togvej};
+  const byte Rest[NoInputs] = {HIGH, HIGH, HIGH, LOW};
+  const char *Names[NoInputs] = {"manuelknap", "målested", "tændsted", "togvej"};
+#else
+  const byte NoInputs = 3;
+  const byte Pins[NoInputs] = {ARDPin.ManuelKnap, ARDPin.Taendsted, ARDPin.Togvej};
+  const byte Rest[NoInputs] = {HIGH, HIGH, LOW};
+  const char *Names[NoInputs] = {"manuelknap", "tændsted", "togvej"};
+#endif
+  const unsigned long MaxGap = 40000;
+  const unsigned long Horizon = 600000;
+  const unsigned long MinSettle = 2*Blinker::Period;
+  const unsigned long MaxSettle = 30000;
+  typedef std::vector<Sim::t_InputEvent> t_Events;
+  struct t_Result {
+    unsigned long long ticks;
+    byte invariant;
+    unsigned long atMillis;
+    byte state;
+    bool visited[SimInvariant::NoStates*SimInvariant::NoStates];
+  };
+  t_Result *shared = nullptr;
+
+  struct t_Random {
+    unsigned long long state;
+    t_Random(unsigned long long seed): state(seed*0x9E3779B97F4A7C15ULL+1) {}
+    unsigned long long next(void) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      return state;
+    }
+    double uniform(void) {return (next() >> 11)*(1.0/9007199254740992.0);}
+  };
+
+  void run(const t_Events &events, unsigned long endMillis, t_Result &result) {
+    Sim::script = events;
+    Sim::scriptPos = 0;
+    result = t_Result();
+    SimInvariant::reset();
+    unsigned long settleMillis = endMillis+MaxSettle;
+#ifndef BrugTicklessKlok
+    unsigned long nextCycle = (Sim::elapsedMillis()/Clock::ClockCycle+1)*Clock::ClockCycle;
+#endif
+    while (Sim::elapsedMillis() < settleMillis) {
+#ifndef BrugTicklessKlok
+      if (Sim::elapsedMillis() < nextCycle) Sim::advanceMicros(nextCycle*1000ULL-Sim::clockMicros);
+#endif
+      loop();
+#ifndef BrugTicklessKlok
+      nextCycle = (Sim::elapsedMillis()/Clock::ClockCycle+1)*Clock::ClockCycle;
+#endif
+      result.ticks++;
+      result.invariant = SimInvariant::check();
+      if (result.invariant != SimInvariant::NONE) {
+        result.atMillis = Sim::elapsedMillis();
+        result.state = crossing.state();
+        break;
+      }
+      if ((Sim::elapsedMillis() >= endMillis+MinSettle) && (SimInvariant::isQuiet() == true)) break;
+    }
+    memcpy(result.visited, SimInvariant::visited, sizeof(result.visited));
+  }
+
+  t_Result test(const t_Events &events, unsigned long endMillis) {
+    fflush(stdout);
+    fflush(stderr);
+    *shared = t_Result();
+    shared->invariant = SimInvariant::CRASH;
+    pid_t child = fork();
+    if (child == 0) {
+      t_Result result;
+      run(events, endMillis, result);
+      *shared = result;
+      _exit(0);
+    }
+    int status = 0;
+    if (child > 0) waitpid(child, &status, 0);
+    return *shared;
+  }
+
+  t_Events randomEpisode(unsigned long long seed, unsigned long &endMillis) {
+    t_Random random(seed);
+    t_Events events;
+    byte level[NoInputs];
+    memcpy(level, Rest, sizeof(level));
+    unsigned long at = 0;
+    // Tid mellem skift er logaritmisk fordelt fra 1 msek, så både prel og hele togforløb forekommer
+    while (true) {
+      at += (unsigned long)exp(random.uniform()*log((double)MaxGap));
+      if (at >= Horizon) break;
+      byte input = random.next() % NoInputs;
+      level[input] = !level[input];
+      events.push_back(Sim::t_InputEvent{at, Pins[input], level[input]});
+    }
+    endMillis = Horizon;
+    return events;
+  }
+
+  t_Events gridEpisode(unsigned long long index, byte depth, unsigned long step, unsigned long &endMillis) {
+    t_Events events;
+    byte level[NoInputs];
+    memcpy(level, Rest, sizeof(level));
+    for (byte cnt=0; cnt < depth; cnt++, index /= NoInputs+1) {
+      byte choice = index % (NoInputs+1);
+      if (choice == NoInputs) continue;
+      level[choice] = !level[choice];
+      events.push_back(Sim::t_InputEvent{(cnt+1)*step, Pins[choice], level[choice]});
+    }
+    endMillis = (depth+1)*step;
+    return events;
+  }
+
+  // Delta debugging: Fjerner først alle skift efter fejlen, derefter stykker af faldende størrelse
+  t_Events minimise(t_Events events, const t_Result &failure, unsigned long &noTests) {
+    while ((events.empty() == false) && (events.back().atMillis > failure.atMillis)) events.pop_back();
+    size_t chunk = (events.size()+1)/2;
+    while (chunk > 0) {
+      bool removed = false;
+      for (size_t start=0; start < events.size(); ) {
+        t_Events candidate(events);
+        candidate.erase(candidate.begin()+start, candidate.begin()+std::min(start+chunk, candidate.size()));
+        unsigned long endMillis = (candidate.empty() == false)?candidate.back().atMillis:0;
+        noTests++;
+        if (test(candidate, endMillis).invariant == failure.invariant) {
+          events = candidate;
+          removed = true;
+        }
+        else start += chunk;
+      }
+      if ((removed == false) || (chunk > events.size())) chunk /= 2;
+    }
+    return events;
+  }
+
+  bool write(const char *fileName, const t_Events &events, const t_Result &failure) {
+    FILE *file = fopen(fileName, "w");
+    if (file == nullptr) return false;
+    fprintf(file, "# Fundet af ovk_udforsk: %s ved %lu msek i %s\n", SimInvariant::Text[failure.invariant], failure.atMillis, SimInvariant::StateText[failure.state]);
+    fprintf(file, "# Afspilles med ovk_udforsk -r %s eller ovk_sim -s %s -l\n", fileName, fileName);
+    fprintf(file, "# msek ben niveau\n");
+    for (const Sim::t_InputEvent &event : events) {
+      byte input = 0;
+      while ((input < NoInputs-1) && (Pins[input] != event.pin)) input++;
+      fprintf(file, "%lu %u %u   # %s %s\n", event.atMillis, event.pin, event.level, Names[input], (event.level == Rest[input])?"hviler":"aktiv");
+    }
+    fclose(file);
+    return true;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long long budget = 20000000;
+  unsigned long long seed = 1;
+  unsigned int depth = 0;
+  unsigned long step = 0;
+  const char *replayName = nullptr;
+  const char *outName = "ovk_udforsk_fejl.txt";
+  bool isValid = true;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-n") == 0) && (cnt+1 < argc)) budget = strtoull(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-s") == 0) && (cnt+1 < argc)) seed = strtoull(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-e") == 0) && (cnt+1 < argc)) isValid = (sscanf(argv[++cnt], "%u:%lu", &depth, &step) == 2) && (depth > 0) && (depth <= 12) && (step > 0);
+    else if ((strcmp(argv[cnt], "-t") == 0) && (cnt+1 < argc)) Sim::startMillis = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-r") == 0) && (cnt+1 < argc)) replayName = argv[++cnt];
+    else if ((strcmp(argv[cnt], "-o") == 0) && (cnt+1 < argc)) outName = argv[++cnt];
+    else isValid = false;
+  }
+  if (isValid == false) {
+    fprintf(stderr, "Brug: %s [-n klokcyklusser] [-s frø] [-e dybde:msek] [-t msek] [-r scriptfil] [-o scriptfil]\n", argv[0]);
+    return 2;
+  }
+
+  using namespace SimExplore;
+  shared = (t_Result *)mmap(nullptr, sizeof(t_Result), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (shared == MAP_FAILED) {
+    fprintf(stderr, "Kan ikke dele hukommelse med forløb\n");
+    return 1;
+  }
+#ifdef BrugTicklessKlok
+  Clock::idle = simSleep;
+#endif
+#if defined(BrugTicklessKlok) || defined(BrugKantfangst)
+  Sim::onInput = simPinChange;
+#endif
+  setup();
+
+  // Alle forløb starter fra denne proces, som ikke selv kører klokcyklusser
+  t_Events events, failing;
+  t_Result result, failure;
+  failure.invariant = SimInvariant::NONE;
+  unsigned long endMillis = 0;
+  unsigned long long noEpisodes = 0, noTicks = 0;
+  bool visited[SimInvariant::NoStates*SimInvariant::NoStates] = {};
+  auto wallStart = std::chrono::steady_clock::now();
+  if (replayName != nullptr) {
+    if (SimScript::loadFile(replayName) == false) {
+      fprintf(stderr, "Kan ikke læse script: %s\n", replayName);
+      return 1;
+    }
+    events = Sim::script;
+    Sim::script.clear();
+    endMillis = (events.empty() == false)?events.back().atMillis:0;
+    result = test(events, endMillis);
+    noEpisodes = 1;
+    noTicks = result.ticks;
+    memcpy(visited, result.visited, sizeof(visited));
+    if (result.invariant != SimInvariant::NONE) {
+      failure = result;
+      failing = events;
+    }
+  }
+  else {
+    unsigned long long noGrid = 1;
+    if (depth > 0) for (unsigned int cnt=0; cnt < depth; cnt++) noGrid *= NoInputs+1;
+    for (unsigned long long index=0; (depth > 0)?(index < noGrid):(noTicks < budget); index++) {
+      events = (depth > 0)?gridEpisode(index, depth, step, endMillis):randomEpisode(seed+index, endMillis);
+      result = test(events, endMillis);
+      noEpisodes++;
+      noTicks += result.ticks;
+      for (size_t cnt=0; cnt < sizeof(visited); cnt++) visited[cnt] = visited[cnt] || result.visited[cnt];
+      if (result.invariant != SimInvariant::NONE) {
+        failure = result;
+        failing = events;
+        if (depth == 0) fprintf(stderr, "Fejl i forløb med frø %llu: %s ved %lu msek\n", seed+index, SimInvariant::Text[failure.invariant], failure.atMillis);
+        else fprintf(stderr, "Fejl i forløb %llu på gitter: %s ved %lu msek\n", index, SimInvariant::Text[failure.invariant], failure.atMillis);
+        break;
+      }
+    }
+  }
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-wallStart).count();
+
+  unsigned int noTransitions = 0;
+  for (bool seen : visited) if (seen == true) noTransitions++;
+  printf("Forløb:                %llu %s\n", noEpisodes, (replayName != nullptr)?"afspillet":((depth > 0)?"på gitter":"tilfældige"));
+  if (Sim::startMillis != 0) printf("millis() ved start:    %lu, løber rundt efter %lu msek\n", (unsigned long)Sim::startMillis, 0x100000000UL-Sim::startMillis);
+  printf("Klokcyklusser:         %llu kontrolleret på %.2f sek, %.1f mio per sek\n", noTicks, wallSeconds, (wallSeconds > 0)?noTicks/wallSeconds/1.0e6:0.0);
+  printf("Tilstandsskift:        %u forskellige set:", noTransitions);
+  for (byte from=0; from < SimInvariant::NoStates; from++)
+    for (byte to=0; to < SimInvariant::NoStates; to++)
+      if (visited[from*SimInvariant::NoStates+to] == true) printf(" %s>%s", SimInvariant::StateText[from], SimInvariant::StateText[to]);
+  printf("\n");
+  printf("Krav:                  Kør efter %lu msek vejlys og nede bom, bom ned efter %lu msek vejlys, tilstande højst %lu/%lu/%lu msek  %s\n",
+    SimInvariant::Secure, SimInvariant::Warning, SimInvariant::MaxDwell[FORRING], SimInvariant::MaxDwell[BOMNED], SimInvariant::MaxDwell[OPLOES],
+    (failure.invariant == SimInvariant::NONE)?"OK":"FEJL");
+  if (failure.invariant != SimInvariant::NONE) {
+    unsigned long noTests = 0;
+    failing = minimise(failing, failure, noTests);
+    t_Result reduced = test(failing, (failing.empty() == false)?failing.back().atMillis:0);
+    printf("Fejl:                  %s ved %lu msek i %s, reduceret til %zu skift med %lu forsøg\n",
+      SimInvariant::Text[reduced.invariant], reduced.atMillis, SimInvariant::StateText[reduced.state], failing.size(), noTests);
+    if (replayName == nullptr) {
+      if (write(outName, failing, reduced) == true) printf("Script:                %s\n", outName);
+      else fprintf(stderr, "Kan ikke skrive: %s\n", outName);
+    }
+  }
+  printf("Resultat:              %s\n", (failure.invariant == SimInvariant::NONE)?"OK":"FEJL");
+  return (failure.invariant == SimInvariant::NONE)?0:1;
+}
@@ -0,0 +1,221 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Kontrol af portudvidelser mod simuleret SPI og I2C bus
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Kører RefOverkoersel.h med lamper på 74HC595, togvej på 74HC165 og manuelknap og vejklokker på MCP23017 og en togplan i virtuel tid.
+ * Skifteregistrenes og MCP23017's ben er forbundet til de ben, som enhederne har uden portudvidelse, så togplanen er den samme.
+ * Kontrol: Efter hver klokcyklus har portudvidelsernes ben samme værdi som driverne har skrevet.
+ * MCP23017 har kun tilknyttede udgange som udgange, så ubrugte ben ikke drives lave.
+ * Latch sker kun i klokcyklusser, hvor en udgang er ændret. Overkørslen bliver sikret for hvert tog.
+ * Bustid for SPI og I2C i hver klokcyklus er inden for klokcyklus.
+ * Transaktioner, bytes og bustid tælles per klokcyklus.
+ * Brug: ovk_udvidelse [-t sek] [-p togperiode sek] [-f sek] [-l]
+ * -f: I2C bussen hænger i 1 sek fra sek. Wire skal give op efter timeout, og det skal tælles som busfejl.
+ *   Vejklokker kontrolleres ikke, mens bussen hænger.
+ * -l skriver bus og ben for de første 200 klokcyklusser, hvor en udgang ændres.
+ * Afslutter med 0 når alle klokcyklusser passer og 1 ved fejl.
+ */
+
+#ifndef BrugPortudvidelse
+#define BrugPortudvidelse
+#endif
+#include <stdio.h>
+#include <string.h>
+#include "RefOverkoersel.h"
+#include "SimScript.h"
+
+#ifdef BrugTicklessKlok
+void simSleep(unsigned long) {Sim::sleep();}
+#endif
+#ifdef BrugKantfangst
+void simPinChange(byte pin, byte) {EdgeCapture::onPinChange(digitalPinToPort(pin));}
+#elif defined(BrugTicklessKlok)
+void simPinChange(byte, byte) {Clock::wake();}
+#endif
+
+// Ansvar: Forbinder portudvidelser til kortet og kontrollerer dem efter hver klokcyklus.
+// NoShiftOuts, ShiftOuts, ShiftPins: 74HC595 ben og kortets ben
+// noLatches: Latch siden forrige klokcyklus. prevOut, prevDirty: Udgange i spejlet og ikke overførte ændringer efter forrige klokcyklus
+// prevSpi, prevI2c: Bustællere efter forrige klokcyklus
+// noCycles, noIdleCycles: Klokcyklusser og dem uden bustrafik til udgange
+// McpOutputs: Ben på MCP23017 der er udgange. Alle andre skal være indgange
+// noPinErrors, noLatchErrors, noBudgetErrors: Ben med forkert værdi, latch uden ændring og bus over klokcyklus
+// noDirectionErrors: Klokcyklusser hvor MCP23017 har andre udgange end McpOutputs
+// sumTransactions, maxTransactions, sumBytes, maxBytes, sumMicros, maxMicros: Bus per klokcyklus
+// noSecured, prevState: Antal gange overkørslen er sikret og tilstand efter forrige klokcyklus
+// onWrite(...): Kaldes af simulatorens kort ved ændring af et ben. Udfører latch og load
+// connect(...): Forbinder portudvidelser til kortet
+// check(...): Kaldes efter hver klokcyklus. Leverer sand hvis en udgang er ændret
+namespace SimBus {
+  const byte NoShiftOuts = 5;
+  const byte ShiftOuts[NoShiftOuts] = {UdvBen.OUSignAB, UdvBen.OUSignBA, UdvBen.OUSignABHvid, UdvBen.OUSignBAHvid, UdvBen.VejLys};
+  const byte ShiftPins[NoShiftOuts] = {ARDPin.OUSignAB, ARDPin.OUSignBA, ARDPin.OUSignABHvid, ARDPin.OUSignBAHvid, ARDPin.VejLys};
+  unsigned long noLatches = 0;
+  byte prevOut[Expander::MaxNoMcps+1][Expander::MaxNoChainBytes];
+  bool prevDirty = true;
+  Sim::SpiBus::t_Counters prevSpi;
+  Sim::I2cBus::t_Counters prevI2c;
+  unsigned long noCycles = 0, noIdleCycles = 0;
+  const unsigned int McpOutputs = 1U << UdvBen.VejKlokker;
+  unsigned long noPinErrors = 0, noLatchErrors = 0, noBudgetErrors = 0;
+  unsigned long noDirectionErrors = 0;
+  unsigned long sumTransactions = 0, maxTransactions = 0, sumBytes = 0, maxBytes = 0;
+  double sumMicros = 0, maxMicros = 0;
+  unsigned long noSecured = 0;
+  byte prevState = IKKESIKRET;
+
+  void onWrite(byte pin, byte value) {
+    if ((pin == ARDPin.Latch) && (value == HIGH)) {
+      Sim::SpiBus::latch();
+      noLatches++;
+    }
+    if ((pin == ARDPin.Load) && (value == LOW)) Sim::SpiBus::load();
+  }
+
+  void connect(void) {
+    for (byte cnt=0; cnt < NoShiftOuts; cnt++) Sim::SpiBus::connectOut(ShiftOuts[cnt], ShiftPins[cnt]);
+    Sim::SpiBus::connectIn(UdvBen.Togvej, ARDPin.Togvej);
+    Sim::I2cBus::add(UdvBen.Mcp);
+    Sim::I2cBus::connect(UdvBen.Mcp, UdvBen.ManuelKnap, ARDPin.ManuelKnap);
+    Sim::I2cBus::connect(UdvBen.Mcp, UdvBen.VejKlokker, ARDPin.VejKlokker);
+  }
+
+  bool expected(byte source, byte bit) {return (Expander::sources[source].out[bit/8] & (1 << (bit%8))) != 0;}
+
+  bool check(void) {
+    const byte Mcp = Expander::attachMcp(UdvBen.Mcp);
+    bool changed = false;
+    for (byte source=0; source <= Expander::Chain; source++)
+      if (memcmp(prevOut[source], Expander::sources[source].out, Expander::MaxNoChainBytes) != 0) changed = true;
+    for (byte cnt=0; cnt < NoShiftOuts; cnt++)
+      if (Sim::board->output[ShiftPins[cnt]] != expected(Expander::Chain, ShiftOuts[cnt])) noPinErrors++;
+    const Sim::I2cBus::t_Device *device = Sim::I2cBus::device(UdvBen.Mcp);
+    if ((Sim::I2cBus::isStuck == false) && (Sim::board->output[ARDPin.VejKlokker] != expected(Mcp, UdvBen.VejKlokker))) noPinErrors++;
+    unsigned int direction = device->reg[Sim::I2cBus::IODIRA] | (device->reg[Sim::I2cBus::IODIRA+1] << 8);
+    if (direction != (0xFFFF & ~McpOutputs)) noDirectionErrors++;
+    if ((noLatches > 0) && (prevDirty == false) && (memcmp(prevOut[Expander::Chain], Expander::sources[Expander::Chain].out, Expander::MaxNoChainBytes) == 0)) noLatchErrors++;
+
+    unsigned long transactions = Sim::SpiBus::count.transactions-prevSpi.transactions+Sim::I2cBus::count.transactions-prevI2c.transactions;
+    unsigned long bytes = Sim::SpiBus::count.bytes-prevSpi.bytes+Sim::I2cBus::count.bytes-prevI2c.bytes;
+    double micros = Sim::SpiBus::count.micros-prevSpi.micros+Sim::I2cBus::count.micros-prevI2c.micros;
+    if (micros > Clock::ClockCycle*1000.0) noBudgetErrors++;
+    if (changed == false) noIdleCycles++;
+    if (transactions > maxTransactions) maxTransactions = transactions;
+    if (bytes > maxBytes) maxBytes = bytes;
+    if (micros > maxMicros) maxMicros = micros;
+    sumTransactions += transactions;
+    sumBytes += bytes;
+    sumMicros += micros;
+    noCycles++;
+
+    if ((crossing.state() == SIKRET) && (prevState != SIKRET)) noSecured++;
+    prevState = crossing.state();
+    for (byte source=0; source <= Expander::Chain; source++) memcpy(prevOut[source], Expander::sources[source].out, Expander::MaxNoChainBytes);
+    prevDirty = Expander::sources[Expander::Chain].dirty;
+    prevSpi = Sim::SpiBus::count;
+    prevI2c = Sim::I2cBus::count;
+    noLatches = 0;
+    return changed;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long simSeconds = 1000;
+  unsigned long trainPeriod = 120;
+  unsigned long noLogLines = 0;
+  unsigned long stuckMillis = 0;
+  bool isValid = true;
+  for (int cnt = 1; cnt < argc; cnt++) {
+    if ((strcmp(argv[cnt], "-t") == 0) && (cnt+1 < argc)) simSeconds = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-p") == 0) && (cnt+1 < argc)) trainPeriod = strtoul(argv[++cnt], nullptr, 10);
+    else if ((strcmp(argv[cnt], "-f") == 0) && (cnt+1 < argc)) stuckMillis = strtoul(argv[++cnt], nullptr, 10)*1000;
+    else if (strcmp(argv[cnt], "-l") == 0) noLogLines = 200;
+    else isValid = false;
+  }
+  if ((isValid == false) || (trainPeriod == 0) || (simSeconds < 100)) {
+    fprintf(stderr, "Brug: %s [-t sek] [-p togperiode sek] [-f sek] [-l]\n", argv[0]);
+    return 2;
+  }
+
+  using namespace SimBus;
+  unsigned long noTrains = 0;
+  for (unsigned long at = 10000; at+90000 < simSeconds*1000; at += trainPeriod*1000) noTrains++;
+  SimScript::addTrainSchedule(simSeconds*1000, trainPeriod*1000, ARDPin.ManuelKnap, ARDPin.Taendsted, ARDPin.Togvej);
+  connect();
+  Sim::onWrite = onWrite;
+#ifdef BrugTicklessKlok
+  Clock::idle = simSleep;
+#endif
+#if defined(BrugTicklessKlok) || defined(BrugKantfangst)
+  Sim::onInput = simPinChange;
+#endif
+  setup();
+  // Portudvidelser overføres først ved afslutning af første klokcyklus
+  check();
+  noPinErrors = noDirectionErrors = 0;
+  noCycles = 0;
+  noIdleCycles = 0;
+  sumTransactions = sumBytes = 0;
+  sumMicros = 0;
+
+  const unsigned long endMillis = simSeconds*1000;
+#ifndef BrugTicklessKlok
+  unsigned long nextCycle = Clock::ClockCycle;
+#endif
+  while (millis() < endMillis) {
+#ifndef BrugTicklessKlok
+    if (millis() < nextCycle) Sim::advanceMicros(nextCycle*1000ULL-Sim::clockMicros);
+#endif
+    unsigned long spiBytes = Sim::SpiBus::count.bytes, i2cBytes = Sim::I2cBus::count.bytes;
+    Sim::I2cBus::isStuck = (stuckMillis > 0) && (millis() >= stuckMillis) && (millis() < stuckMillis+1000);
+    loop();
+#ifndef BrugTicklessKlok
+    nextCycle = (millis()/Clock::ClockCycle+1)*Clock::ClockCycle;
+#endif
+    if ((check() == true) && (noLogLines > 0)) {
+      noLogLines--;
+      printf("%8lu SPI %lu I2C %2lu bytes 595 %02X MCP %02X%02X", millis(), Sim::SpiBus::count.bytes-spiBytes, Sim::I2cBus::count.bytes-i2cBytes,
+        Sim::SpiBus::storage[0], Sim::I2cBus::device(UdvBen.Mcp)->reg[Sim::I2cBus::OLATA+1], Sim::I2cBus::device(UdvBen.Mcp)->reg[Sim::I2cBus::OLATA]);
+      for (byte cnt=0; cnt < NoShiftOuts; cnt++) printf(" D%u %u", ShiftPins[cnt], Sim::board->output[ShiftPins[cnt]]);
+      printf(" D%u %u\n", ARDPin.VejKlokker, Sim::board->output[ARDPin.VejKlokker]);
+    }
+  }
+
+  const double Budget = Clock::ClockCycle*1000.0;
+  bool isPinsOk = (noPinErrors == 0) && (noLatchErrors == 0) && (noDirectionErrors == 0);
+  bool isTrainsOk = (noSecured == noTrains) && (noTrains > 0);
+  // Hængt bus skal give op efter timeout og tælles som busfejl
+  bool isBusOk = (noBudgetErrors == 0) && (Sim::I2cBus::count.hangs == 0) &&
+    ((stuckMillis > 0)?(Expander::noBusErrors > 0):(Expander::noBusErrors == 0));
+  printf("Simuleret:             %lu sek, %lu klokcyklusser\n", simSeconds, noCycles);
+  printf("Ben:                   %lu forkerte, %lu latch uden ændring, %lu med forkert retning  %s\n", noPinErrors, noLatchErrors, noDirectionErrors, (isPinsOk == true)?"OK":"FEJL");
+  printf("Tog:                   %lu af %lu sikret  %s\n", noSecured, noTrains, (isTrainsOk == true)?"OK":"FEJL");
+  printf("Transaktioner:         %.2f per klokcyklus i gennemsnit, højst %lu\n", (noCycles > 0)?(double)sumTransactions/noCycles:0.0, maxTransactions);
+  printf("Bytes:                 %.2f per klokcyklus i gennemsnit, højst %lu\n", (noCycles > 0)?(double)sumBytes/noCycles:0.0, maxBytes);
+  printf("Bustid:                %.1f µsek per klokcyklus i gennemsnit, højst %.1f µsek, %.1f %% af %.0f µsek, %lu busfejl, %lu timeout, %lu hængt  %s\n",
+    (noCycles > 0)?sumMicros/noCycles:0.0, maxMicros, maxMicros*100/Budget, Budget, Expander::noBusErrors, Sim::I2cBus::count.timeouts,
+    Sim::I2cBus::count.hangs, (isBusOk == true)?"OK":"FEJL");
+  printf("Udgange:               %lu klokcyklusser uden ændring, %lu skrivninger sprunget over\n", noIdleCycles, Expander::noSkipped);
+  printf("Resultat:              %s\n", ((isPinsOk == true) && (isTrainsOk == true) && (isBusOk == true))?"OK":"FEJL");
+  return ((isPinsOk == true) && (isTrainsOk == true) && (isBusOk == true))?0:1;
+}
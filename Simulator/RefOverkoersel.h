@@ -0,0 +1,331 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Reference overkørsel til simulering
+ * Version: 1.0
+ * Type: Program
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Et program bygget efter "Vejledning bygge en overkørsel".
+ * Overkørslen har 2 overkørselssignaler med hvid lanterne, vejlys, vejklokke og 1 sæt vejbomme.
+ * Med BrugSeriel bliver togvej sat af sikringsanlægget over seriel forbindelse, og overkørslen melder sikret tilbage samme vej.
+ * Filen svarer til en .ino fil og inkluderes af simulatorens programmer.
+ */
+
+#ifndef RefOverkoersel_h
+#define RefOverkoersel_h
+
+// Arduino IDE inkluderer Arduino.h automatisk i en .ino fil
+#include <Arduino.h>
+
+// Tidsenhed til urværk
+enum {MSEC, SECONDS};
+// Kontakttyper for trykknap
+enum {NOPEN, NCLOSED};
+// Overkørslens betjeningsenheder magasin kan konfigureres
+enum {BISTABLE, ONESHOT};
+// Overkørslens betjeningsenheder leverer
+enum {OFF, ON};
+// Overkørslens ydre enheder kan blive sat til
+enum {BLOCK, PASS};
+
+// Betjenings- og sensorenheder
+const byte MaxNoCtrls = 3;
+enum {MANUELBETJ, TAENDSTED, TOGVEJ};
+// Overkørslens ydre enheder. Med seriel forbindelse meldes sikret til sikringsanlæg
+#ifndef BrugSeriel
+const byte MaxNoDevices = 5;
+enum {BANESIGNAB, BANESIGNBA, VEJSIGNAL, VEJKLOKKE, VEJBOM};
+#else
+const byte MaxNoDevices = 6;
+enum {BANESIGNAB, BANESIGNBA, VEJSIGNAL, VEJKLOKKE, VEJBOM, SIKRETMELD};
+#endif
+// Overkørslens tilstande
+const byte MaxNoStates = 5;
+enum {IKKESIKRET, FORRING, BOMNED, SIKRET, OPLOES};
+#ifdef BrugTimerhjul
+// Urværker: 3 knapper, 1 servomotor, blinker og tilstandsmaskine
+const byte MaxNoTimers = 6;
+#endif
+
+// Overkørslens moduler
+#define BrugVejbom
+#include <Ovkoersel.h>
+
+// Arduino pins
+struct {
+  const byte ManuelKnap = 2;
+  const byte Taendsted = 3;
+#ifndef BrugSeriel
+  const byte Togvej = 4;
+#endif
+  const byte OUSignABHvid = 5;
+  const byte OUSignBAHvid = 6;
+  const byte OUSignAB = 7;
+  const byte OUSignBA = 8;
+  const byte ServM = 9;
+  const byte VejKlokker = 10;
+  const byte VejLys = 11;
+#ifdef BrugPortudvidelse
+  const byte Latch = 14;
+  const byte Load = 15;
+#endif
+} ARDPin;
+
+#ifdef BrugPortudvidelse
+// Ben på portudvidelser. Lamper på 74HC595, togvej på 74HC165 og manuelknap og vejklokker på MCP23017
+struct {
+  const byte Mcp = 0x20;
+  const byte ManuelKnap = 0;
+  const byte VejKlokker = 8;
+  const byte Togvej = 0;
+  const byte OUSignABHvid = 0;
+  const byte OUSignBAHvid = 1;
+  const byte OUSignAB = 2;
+  const byte OUSignBA = 3;
+  const byte VejLys = 4;
+} UdvBen;
+#endif
+
+// Tider til tilstandsmaskine
+struct {
+  const unsigned long Forring = 4;          // Sekunder fra vejlys tænder til bomme går ned
+  const unsigned long BarrierTime = 8000;   // Msek for en bombevægelse
+  const int AngleAdjust = 0;
+} Timing;
+
+#ifdef BrugSeriel
+// Hastighed på seriel forbindelse til sikringsanlæg
+const unsigned long Baud = 19200;
+#endif
+
+// Hardware drivere til den overkørsel, som dette program leverer
+#ifndef BrugPortudvidelse
+t_PushButton manuelKnapDrv(ARDPin.ManuelKnap, NCLOSED);
+#else
+t_McpIn manuelKnapDrv(UdvBen.Mcp, UdvBen.ManuelKnap, NCLOSED);
+#endif
+#ifndef BrugKantfangst
+t_PushButton taendstedDrv(ARDPin.Taendsted, NCLOSED);
+#else
+t_EdgeInput taendstedDrv(ARDPin.Taendsted, NCLOSED);
+#endif
+#if defined(BrugSeriel)
+t_SerialIn togvejDrv(TOGVEJ);
+#elif defined(BrugPortudvidelse)
+t_ShiftIn togvejDrv(UdvBen.Togvej, NOPEN);
+#else
+t_PushButton togvejDrv(ARDPin.Togvej, NOPEN);
+#endif
+#ifdef BrugPortudvidelse
+t_ShiftOut OUSignABDrv(UdvBen.OUSignAB, HIGH);
+t_ShiftOut OUSignBADrv(UdvBen.OUSignBA, HIGH);
+t_ShiftOut OUSignABHvidDrv(UdvBen.OUSignABHvid);
+t_ShiftOut OUSignBAHvidDrv(UdvBen.OUSignBAHvid);
+t_ShiftOut vejLysDrv(UdvBen.VejLys);
+t_McpOut vejKlokkerDrv(UdvBen.Mcp, UdvBen.VejKlokker);
+#else
+#ifndef BrugLysdaemper
+t_SimpleOnOff OUSignABDrv(ARDPin.OUSignAB, HIGH);
+t_SimpleOnOff OUSignBADrv(ARDPin.OUSignBA, HIGH);
+t_SimpleOnOff OUSignABHvidDrv(ARDPin.OUSignABHvid);
+t_SimpleOnOff OUSignBAHvidDrv(ARDPin.OUSignBAHvid);
+t_SimpleOnOff vejLysDrv(ARDPin.VejLys);
+#else
+t_DimmedLamp OUSignABDrv(ARDPin.OUSignAB, HIGH);
+t_DimmedLamp OUSignBADrv(ARDPin.OUSignBA, HIGH);
+t_DimmedLamp OUSignABHvidDrv(ARDPin.OUSignABHvid);
+t_DimmedLamp OUSignBAHvidDrv(ARDPin.OUSignBAHvid);
+t_DimmedLamp vejLysDrv(ARDPin.VejLys);
+#endif
+t_SimpleOnOff vejKlokkerDrv(ARDPin.VejKlokker);
+#endif
+t_ServoMotor SG90(HIGH);
+#ifdef BrugSeriel
+t_SerialOut sikretMeldDrv(SIKRETMELD);
+#endif
+
+// Overkørslens betjeningsenheder
+t_CrossingCtrl manuelBetj;
+t_CrossingCtrl taendsted;
+t_CrossingCtrl togvej;
+// Flipflop til manuelknap og tændsted
+t_FlipFlop manFF(NCLOSED);
+t_FlipFlop taendFF(NCLOSED);
+
+// Overkørslens ydre enheder
+t_RailSignal OUSignAB;
+t_RailSignal OUSignBA;
+t_RoadSignal vejLys(PASS);
+t_RoadSignal vejKlokker(PASS);
+t_Barrier vejBom(PASS);
+#ifdef BrugSeriel
+t_Report sikretMeld;
+#endif
+
+// Tilstand: Overkørsel er slukket. Tænder ved manuel betjening eller ved tændsted passeret med togvej sat.
+class t_IkkeSikretState: public t_StateMachine {
+public:
+  t_IkkeSikretState(void): t_StateMachine() {}
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (crossing.status(MANUELBETJ) == ON) nextState = FORRING;
+    if ((crossing.status(TAENDSTED) == ON) && (crossing.status(TOGVEJ) == ON)) nextState = FORRING;
+    return nextState;
+  }
+} ikkesikret;
+
+// Tilstand: Vejlys og vejklokke advarer vejtrafik inden bomme går ned.
+class t_ForringState: public t_StateMachine {
+public:
+  t_ForringState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJSIGNAL, BLOCK);
+    crossing.to(VEJKLOKKE, BLOCK);
+    crossing.reset(TAENDSTED);
+    clockWork.setDuration(Timing.Forring, SECONDS);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = BOMNED;
+    return nextState;
+  }
+} forring;
+
+// Tilstand: Bomme går ned.
+class t_BomNedState: public t_StateMachine {
+public:
+  t_BomNedState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJBOM, BLOCK);
+    clockWork.setDuration(Timing.BarrierTime, MSEC);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = SIKRET;
+    return nextState;
+  }
+} bomned;
+
+// Tilstand: Overkørsel er sikret og må passeres af tog. Med seriel forbindelse meldes sikret til sikringsanlæg.
+// Slukker når togvej er opløst og manuel betjening er slukket.
+class t_SikretState: public t_StateMachine {
+public:
+  t_SikretState(void): t_StateMachine() {}
+  void onEntry(void) {
+#ifdef BrugSeriel
+    crossing.to(SIKRETMELD, PASS);
+#endif
+    crossing.to(VEJKLOKKE, PASS);
+    crossing.to(BANESIGNAB, PASS);
+    crossing.to(BANESIGNBA, PASS);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if ((crossing.status(TOGVEJ) == OFF) && (crossing.status(MANUELBETJ) == OFF)) nextState = OPLOES;
+    return nextState;
+  }
+  void onExit(void) {
+#ifdef BrugSeriel
+    crossing.to(SIKRETMELD, BLOCK);
+#endif
+    crossing.to(BANESIGNAB, BLOCK);
+    crossing.to(BANESIGNBA, BLOCK);
+    crossing.reset(TAENDSTED);
+  }
+} sikret;
+
+// Tilstand: Bomme går op. Vejlys slukker når bomme er oppe.
+class t_OploesState: public t_StateMachine {
+public:
+  t_OploesState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJBOM, PASS);
+    clockWork.setDuration(Timing.BarrierTime, MSEC);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = IKKESIKRET;
+    return nextState;
+  }
+  void onExit(void) {
+    crossing.to(VEJSIGNAL, PASS);
+  }
+} oploes;
+
+void setup() {
+#ifdef BrugSeriel
+  // Seriel forbindelse til sikringsanlæg
+  SerialLink::begin(Baud);
+#endif
+  // Specifikation og start af servomotor til vejbom
+  SG90.startMotor(ARDPin.ServM, Timing.AngleAdjust, Timing.BarrierTime);
+#ifdef BrugPortudvidelse
+  // Start af kæden med skifteregistre
+  Expander::begin(ARDPin.Latch, ARDPin.Load);
+#endif
+  // Drivere kobles til betjenings- og ydre enheder
+  manuelBetj.setDriver(&manuelKnapDrv);
+  taendsted.setDriver(&taendstedDrv);
+  togvej.setDriver(&togvejDrv);
+  manuelBetj.setFlipFlop(&manFF);
+  taendsted.setFlipFlop(&taendFF, ONESHOT);
+  OUSignAB.setDriver(&OUSignABDrv);
+  OUSignBA.setDriver(&OUSignBADrv);
+  OUSignAB.setWhiteLamp(&OUSignABHvidDrv);
+  OUSignBA.setWhiteLamp(&OUSignBAHvidDrv);
+  vejLys.setDriver(&vejLysDrv);
+  vejKlokker.setDriver(&vejKlokkerDrv);
+  vejBom.setDriver(&SG90);
+#ifdef BrugOscillatorbank
+  vejKlokker.setOscillator(Oscillator::BELL);
+#endif
+#ifdef BrugSeriel
+  sikretMeld.setDriver(&sikretMeldDrv);
+#endif
+  // Opsætning af overkørsel
+  collection.initialize();
+  crossing.setCtrl(MANUELBETJ, &manuelBetj);
+  crossing.setCtrl(TAENDSTED, &taendsted);
+  crossing.setCtrl(TOGVEJ, &togvej);
+  crossing.setDevice(BANESIGNAB, &OUSignAB);
+  crossing.setDevice(BANESIGNBA, &OUSignBA);
+  crossing.setDevice(VEJSIGNAL, &vejLys);
+  crossing.setDevice(VEJKLOKKE, &vejKlokker);
+  crossing.setDevice(VEJBOM, &vejBom);
+#ifdef BrugSeriel
+  crossing.setDevice(SIKRETMELD, &sikretMeld);
+#endif
+  // Opsætning af tilstandsmaskine
+  crossing.setState(IKKESIKRET, &ikkesikret);
+  crossing.setState(FORRING, &forring);
+  crossing.setState(BOMNED, &bomned);
+  crossing.setState(SIKRET, &sikret);
+  crossing.setState(OPLOES, &oploes);
+  // Start tilstandsmaskine
+  crossing.initState(IKKESIKRET);
+}
+
+void loop() {
+  Clock::pendulum();
+  Blinker::doClockCycle();
+  crossing.doClockCycle();
+}
+
+#endif
@@ -0,0 +1,295 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Reference overkørsel med ankomsttid til simulering
+ * Version: 1.0
+ * Type: Program
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Et program bygget efter "Vejledning bygge en overkørsel".
+ * Overkørslen har 2 overkørselssignaler med hvid lanterne, vejlys, vejklokke og 1 sæt vejbomme.
+ * Filen svarer til en .ino fil og inkluderes af simulatorens programmer.
+ * Samme overkørsel som RefOverkoersel.h med et målested før tændsted. Togets hastighed mellem målested og tændsted
+ * bestemmer, hvor længe advarsel venter, så vejen er lukket Varsling msek før toget er i overkørslen.
+ */
+
+#ifndef RefOverkoerselAnkomst_h
+#define RefOverkoerselAnkomst_h
+
+// Arduino IDE inkluderer Arduino.h automatisk i en .ino fil
+#include <Arduino.h>
+
+// Tidsenhed til urværk
+enum {MSEC, SECONDS};
+// Kontakttyper for trykknap
+enum {NOPEN, NCLOSED};
+// Overkørslens betjeningsenheder magasin kan konfigureres
+enum {BISTABLE, ONESHOT};
+// Overkørslens betjeningsenheder leverer
+enum {OFF, ON};
+// Overkørslens ydre enheder kan blive sat til
+enum {BLOCK, PASS};
+
+// Betjenings- og sensorenheder
+const byte MaxNoCtrls = 4;
+enum {MANUELBETJ, MAALESTED, TAENDSTED, TOGVEJ};
+// Overkørslens ydre enheder
+const byte MaxNoDevices = 5;
+enum {BANESIGNAB, BANESIGNBA, VEJSIGNAL, VEJKLOKKE, VEJBOM};
+// Overkørslens tilstande
+const byte MaxNoStates = 6;
+enum {IKKESIKRET, VENTER, FORRING, BOMNED, SIKRET, OPLOES};
+#ifdef BrugTimerhjul
+// Urværker: 4 knapper, 1 servomotor, blinker og tilstandsmaskine
+const byte MaxNoTimers = 7;
+#endif
+
+// Overkørslens moduler
+#define BrugVejbom
+#ifndef BrugAnkomsttid
+#define BrugAnkomsttid
+#endif
+#include <Ovkoersel.h>
+
+// Arduino pins
+struct {
+  const byte ManuelKnap = 2;
+  const byte Taendsted = 3;
+  const byte Togvej = 4;
+  const byte OUSignABHvid = 5;
+  const byte OUSignBAHvid = 6;
+  const byte OUSignAB = 7;
+  const byte OUSignBA = 8;
+  const byte ServM = 9;
+  const byte VejKlokker = 10;
+  const byte VejLys = 11;
+  const byte Maalested = 12;
+} ARDPin;
+
+// Tider til tilstandsmaskine
+struct {
+  const unsigned long Forring = 4;          // Sekunder fra vejlys tænder til bomme går ned
+  const unsigned long BarrierTime = 8000;   // Msek for en bombevægelse
+  const int AngleAdjust = 0;
+  const unsigned int Varsling = 14000;      // Msek fra vejlys tænder til toget er i overkørslen. Forring og bomme ned og 2 sek
+  const byte Hastighedsmargin = 20;         // Procent toget højst bliver hurtigere efter målested
+} Timing;
+
+// Afstande på strækningen i mm
+struct {
+  const unsigned int Maalested = 1000;      // Fra målested til tændsted
+  const unsigned int Overkoersel = 6000;    // Fra tændsted til overkørsel
+} Afstand;
+
+// Hardware drivere til den overkørsel, som dette program leverer
+t_PushButton manuelKnapDrv(ARDPin.ManuelKnap, NCLOSED);
+#ifndef BrugKantfangst
+t_PushButton maalestedDrv(ARDPin.Maalested, NCLOSED);
+t_PushButton taendstedDrv(ARDPin.Taendsted, NCLOSED);
+#else
+t_EdgeInput maalestedDrv(ARDPin.Maalested, NCLOSED);
+t_EdgeInput taendstedDrv(ARDPin.Taendsted, NCLOSED);
+#endif
+t_PushButton togvejDrv(ARDPin.Togvej, NOPEN);
+t_SimpleOnOff OUSignABDrv(ARDPin.OUSignAB, HIGH);
+t_SimpleOnOff OUSignBADrv(ARDPin.OUSignBA, HIGH);
+t_SimpleOnOff OUSignABHvidDrv(ARDPin.OUSignABHvid);
+t_SimpleOnOff OUSignBAHvidDrv(ARDPin.OUSignBAHvid);
+t_SimpleOnOff vejLysDrv(ARDPin.VejLys);
+t_SimpleOnOff vejKlokkerDrv(ARDPin.VejKlokker);
+t_ServoMotor SG90(HIGH);
+
+// Overkørslens betjeningsenheder
+t_CrossingCtrl manuelBetj;
+t_CrossingCtrl maalested;
+t_CrossingCtrl taendsted;
+t_CrossingCtrl togvej;
+// Flipflop til manuelknap og tændsted
+t_FlipFlop manFF(NCLOSED);
+t_FlipFlop taendFF(NCLOSED);
+t_FlipFlop maalFF(NCLOSED);
+
+// Overkørslens ydre enheder
+t_RailSignal OUSignAB;
+t_RailSignal OUSignBA;
+t_RoadSignal vejLys(PASS);
+t_RoadSignal vejKlokker(PASS);
+t_Barrier vejBom(PASS);
+
+// Ventetid fra togets hastighed
+t_ArrivalTimer ankomst;
+
+// Tilstand: Overkørsel er slukket. Tænder ved manuel betjening eller ved tændsted passeret med togvej sat.
+// Er toget målt langsomt nok, venter overkørslen før den tænder.
+class t_IkkeSikretState: public t_StateMachine {
+public:
+  t_IkkeSikretState(void): t_StateMachine() {}
+  void onEntry(void) {
+    ankomst.restart();
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    ankomst.update();
+    if ((crossing.status(TAENDSTED) == ON) && (crossing.status(TOGVEJ) == ON)) nextState = (ankomst.waitTime() > 0)?VENTER:FORRING;
+    if (crossing.status(MANUELBETJ) == ON) nextState = FORRING;
+    return nextState;
+  }
+} ikkesikret;
+
+// Tilstand: Toget er målt og har langt til overkørslen. Tænder når ventetiden er gået eller ved manuel betjening.
+// Urværket vækker klokken til tiden. Ventetiden er gået, når waitTime(...) er 0, også hvis urværket ikke har udløst.
+class t_VenterState: public t_StateMachine {
+public:
+  t_VenterState(void): t_StateMachine() {}
+  void onEntry(void) {
+    clockWork.setDuration(ankomst.waitTime(), MSEC);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if ((clockWork.triggered() == true) || (ankomst.waitTime() == 0)) nextState = FORRING;
+    if (crossing.status(MANUELBETJ) == ON) nextState = FORRING;
+    return nextState;
+  }
+} venter;
+
+// Tilstand: Vejlys og vejklokke advarer vejtrafik inden bomme går ned.
+class t_ForringState: public t_StateMachine {
+public:
+  t_ForringState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJSIGNAL, BLOCK);
+    crossing.to(VEJKLOKKE, BLOCK);
+    crossing.reset(TAENDSTED);
+    clockWork.setDuration(Timing.Forring, SECONDS);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = BOMNED;
+    return nextState;
+  }
+} forring;
+
+// Tilstand: Bomme går ned.
+class t_BomNedState: public t_StateMachine {
+public:
+  t_BomNedState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJBOM, BLOCK);
+    clockWork.setDuration(Timing.BarrierTime, MSEC);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = SIKRET;
+    return nextState;
+  }
+} bomned;
+
+// Tilstand: Overkørsel er sikret og må passeres af tog. Slukker når togvej er opløst og manuel betjening er slukket.
+class t_SikretState: public t_StateMachine {
+public:
+  t_SikretState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJKLOKKE, PASS);
+    crossing.to(BANESIGNAB, PASS);
+    crossing.to(BANESIGNBA, PASS);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if ((crossing.status(TOGVEJ) == OFF) && (crossing.status(MANUELBETJ) == OFF)) nextState = OPLOES;
+    return nextState;
+  }
+  void onExit(void) {
+    crossing.to(BANESIGNAB, BLOCK);
+    crossing.to(BANESIGNBA, BLOCK);
+    crossing.reset(TAENDSTED);
+  }
+} sikret;
+
+// Tilstand: Bomme går op. Vejlys slukker når bomme er oppe.
+class t_OploesState: public t_StateMachine {
+public:
+  t_OploesState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJBOM, PASS);
+    clockWork.setDuration(Timing.BarrierTime, MSEC);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = IKKESIKRET;
+    return nextState;
+  }
+  void onExit(void) {
+    crossing.to(VEJSIGNAL, PASS);
+  }
+} oploes;
+
+void setup() {
+  // Specifikation og start af servomotor til vejbom
+  SG90.startMotor(ARDPin.ServM, Timing.AngleAdjust, Timing.BarrierTime);
+  // Drivere kobles til betjenings- og ydre enheder
+  manuelBetj.setDriver(&manuelKnapDrv);
+  maalested.setDriver(&maalestedDrv);
+  taendsted.setDriver(&taendstedDrv);
+  togvej.setDriver(&togvejDrv);
+  manuelBetj.setFlipFlop(&manFF);
+  taendsted.setFlipFlop(&taendFF, ONESHOT);
+  maalested.setFlipFlop(&maalFF, ONESHOT);
+  OUSignAB.setDriver(&OUSignABDrv);
+  OUSignBA.setDriver(&OUSignBADrv);
+  OUSignAB.setWhiteLamp(&OUSignABHvidDrv);
+  OUSignBA.setWhiteLamp(&OUSignBAHvidDrv);
+  vejLys.setDriver(&vejLysDrv);
+  vejKlokker.setDriver(&vejKlokkerDrv);
+  vejBom.setDriver(&SG90);
+  // Målested og tændsted til måling af togets hastighed
+  ankomst.setSensors(&maalested, &taendsted);
+  ankomst.setDistances(Afstand.Maalested, Afstand.Overkoersel);
+  ankomst.setWarning(Timing.Varsling, Timing.Hastighedsmargin);
+#ifdef BrugOscillatorbank
+  vejKlokker.setOscillator(Oscillator::BELL);
+#endif
+  // Opsætning af overkørsel
+  collection.initialize();
+  crossing.setCtrl(MANUELBETJ, &manuelBetj);
+  crossing.setCtrl(MAALESTED, &maalested);
+  crossing.setCtrl(TAENDSTED, &taendsted);
+  crossing.setCtrl(TOGVEJ, &togvej);
+  crossing.setDevice(BANESIGNAB, &OUSignAB);
+  crossing.setDevice(BANESIGNBA, &OUSignBA);
+  crossing.setDevice(VEJSIGNAL, &vejLys);
+  crossing.setDevice(VEJKLOKKE, &vejKlokker);
+  crossing.setDevice(VEJBOM, &vejBom);
+  // Opsætning af tilstandsmaskine
+  crossing.setState(IKKESIKRET, &ikkesikret);
+  crossing.setState(VENTER, &venter);
+  crossing.setState(FORRING, &forring);
+  crossing.setState(BOMNED, &bomned);
+  crossing.setState(SIKRET, &sikret);
+  crossing.setState(OPLOES, &oploes);
+  // Start tilstandsmaskine
+  crossing.initState(IKKESIKRET);
+}
+
+void loop() {
+  Clock::pendulum();
+  Blinker::doClockCycle();
+  crossing.doClockCycle();
+}
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Reference overkørsel med konfiguration fra tabeller
+ * Version: 1.0
+ * Type: Program
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Et program bygget efter "Vejledning bygge en overkørsel".
+ * Overkørslen har 2 overkørselssignaler med hvid lanterne, vejlys, vejklokke og 1 sæt vejbomme.
+ * Filen svarer til en .ino fil og inkluderes af simulatorens programmer.
+ * Samme overkørsel som RefOverkoersel.h, men ben og enheder er beskrevet i tabeller i flash og oprettes ved start.
+ * Med en jumper fra ben 12 til stel vælges i stedet en overkørsel med kun vejlys og banesignaler uden hvid lanterne.
+ */
+
+#ifndef RefOverkoerselKonfig_h
+#define RefOverkoerselKonfig_h
+
+// Arduino IDE inkluderer Arduino.h automatisk i en .ino fil
+#include <Arduino.h>
+
+// Tidsenhed til urværk
+enum {MSEC, SECONDS};
+// Kontakttyper for trykknap
+enum {NOPEN, NCLOSED};
+// Overkørslens betjeningsenheder magasin kan konfigureres
+enum {BISTABLE, ONESHOT};
+// Overkørslens betjeningsenheder leverer
+enum {OFF, ON};
+// Overkørslens ydre enheder kan blive sat til
+enum {BLOCK, PASS};
+
+// Betjenings- og sensorenheder
+const byte MaxNoCtrls = 3;
+enum {MANUELBETJ, TAENDSTED, TOGVEJ};
+// Overkørslens ydre enheder
+const byte MaxNoDevices = 5;
+enum {BANESIGNAB, BANESIGNBA, VEJSIGNAL, VEJKLOKKE, VEJBOM};
+// Overkørslens tilstande
+const byte MaxNoStates = 5;
+enum {IKKESIKRET, FORRING, BOMNED, SIKRET, OPLOES};
+#ifdef BrugTimerhjul
+// Urværker: 3 knapper, 1 servomotor, blinker og tilstandsmaskine
+const byte MaxNoTimers = 6;
+#endif
+
+// Overkørslens moduler
+#define BrugVejbom
+#ifndef BrugKonfiguration
+#define BrugKonfiguration
+#endif
+#include <Ovkoersel.h>
+
+// Arduino pins. constexpr så tabellerne kan tjekkes ved oversættelse
+constexpr struct {
+  const byte ManuelKnap = 2;
+  const byte Taendsted = 3;
+  const byte Togvej = 4;
+  const byte OUSignABHvid = 5;
+  const byte OUSignBAHvid = 6;
+  const byte OUSignAB = 7;
+  const byte OUSignBA = 8;
+  const byte ServM = 9;
+  const byte VejKlokker = 10;
+  const byte VejLys = 11;
+  const byte Valg = 12;
+} ARDPin = {};
+
+// Tider til tilstandsmaskine og vejbom
+const unsigned long BomTidMsek = 8000;
+struct {
+  const unsigned long Forring = 4;                // Sekunder fra vejlys tænder til bomme går ned
+  const unsigned long BarrierTime = BomTidMsek;   // Msek for en bombevægelse
+} Timing;
+
+// Overkørslens betjeningsenheder med trykknap og magasin
+constexpr Config::t_Ctrl Betjening[] PROGMEM = {
+  {MANUELBETJ, ARDPin.ManuelKnap, NCLOSED, BISTABLE},
+  {TAENDSTED, ARDPin.Taendsted, NCLOSED, ONESHOT},
+  {TOGVEJ, ARDPin.Togvej, NOPEN, Config::NoFlipFlop},
+};
+
+// Overkørslens ydre enheder med udgange
+constexpr Config::t_Device Enheder[] PROGMEM = {
+  {BANESIGNAB, Config::RAILSIGNAL, BLOCK, ARDPin.OUSignAB, ARDPin.OUSignABHvid},
+  {BANESIGNBA, Config::RAILSIGNAL, BLOCK, ARDPin.OUSignBA, ARDPin.OUSignBAHvid},
+  {VEJSIGNAL, Config::ROADSIGNAL, PASS, ARDPin.VejLys, Config::NoPin},
+  {VEJKLOKKE, Config::ROADSIGNAL, PASS, ARDPin.VejKlokker, Config::NoPin},
+  {VEJBOM, Config::BARRIER, PASS, ARDPin.ServM, Config::NoPin},
+};
+
+// Servomotor til vejbom: justering, vinkel, tid for en bombevægelse og grænser for pulsbredde
+constexpr Config::t_Servo Servoer[] PROGMEM = {
+  {VEJBOM, 0, 90, BomTidMsek, 544, 2400},
+};
+
+// Overkørsel uden vejklokke og vejbom. Banesignaler har ingen hvid lanterne
+constexpr Config::t_Device EnhederUdenBom[] PROGMEM = {
+  {BANESIGNAB, Config::RAILSIGNAL, BLOCK, ARDPin.OUSignAB, Config::NoPin},
+  {BANESIGNBA, Config::RAILSIGNAL, BLOCK, ARDPin.OUSignBA, Config::NoPin},
+  {VEJSIGNAL, Config::ROADSIGNAL, PASS, ARDPin.VejLys, Config::NoPin},
+};
+
+constexpr Config::t_Layout Overkoersel PROGMEM = Config::layout(Betjening, Enheder, Servoer);
+constexpr Config::t_Layout OverkoerselUdenBom PROGMEM = Config::layout(Betjening, EnhederUdenBom);
+
+// Tabellerne tjekkes ved oversættelse
+static_assert(Config::namesValid(Betjening, MaxNoCtrls) && Config::namesValid(Enheder, MaxNoDevices) &&
+  Config::namesValid(EnhederUdenBom, MaxNoDevices), "Et navn er ugyldigt eller brugt to gange");
+static_assert(Config::itemsValid(Betjening) && Config::itemsValid(Enheder) && Config::itemsValid(EnhederUdenBom),
+  "Ugyldigt ben, kontakttype, magasin, type eller tilstand");
+static_assert(Config::pinsValid(Betjening, Enheder) && Config::pinsValid(Betjening, EnhederUdenBom), "Et ben er ugyldigt eller brugt to gange");
+static_assert(Config::servosValid(Enheder, Servoer) && Config::servosValid(EnhederUdenBom), "Servomotor passer ikke til vejbom eller grænser");
+
+// Lager til den største af overkørslerne
+const size_t Plads = Config::bytes(Betjening, Enheder);
+const size_t PladsUdenBom = Config::bytes(Betjening, EnhederUdenBom);
+Config::t_Store<(Plads > PladsUdenBom)?Plads:PladsUdenBom> konfiguration;
+
+// Tilstand: Overkørsel er slukket. Tænder ved manuel betjening eller ved tændsted passeret med togvej sat.
+class t_IkkeSikretState: public t_StateMachine {
+public:
+  t_IkkeSikretState(void): t_StateMachine() {}
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (crossing.status(MANUELBETJ) == ON) nextState = FORRING;
+    if ((crossing.status(TAENDSTED) == ON) && (crossing.status(TOGVEJ) == ON)) nextState = FORRING;
+    return nextState;
+  }
+} ikkesikret;
+
+// Tilstand: Vejlys og vejklokke advarer vejtrafik inden bomme går ned.
+class t_ForringState: public t_StateMachine {
+public:
+  t_ForringState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJSIGNAL, BLOCK);
+    crossing.to(VEJKLOKKE, BLOCK);
+    crossing.reset(TAENDSTED);
+    clockWork.setDuration(Timing.Forring, SECONDS);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = BOMNED;
+    return nextState;
+  }
+} forring;
+
+// Tilstand: Bomme går ned.
+class t_BomNedState: public t_StateMachine {
+public:
+  t_BomNedState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJBOM, BLOCK);
+    clockWork.setDuration(Timing.BarrierTime, MSEC);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = SIKRET;
+    return nextState;
+  }
+} bomned;
+
+// Tilstand: Overkørsel er sikret og må passeres af tog. Slukker når togvej er opløst og manuel betjening er slukket.
+class t_SikretState: public t_StateMachine {
+public:
+  t_SikretState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJKLOKKE, PASS);
+    crossing.to(BANESIGNAB, PASS);
+    crossing.to(BANESIGNBA, PASS);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if ((crossing.status(TOGVEJ) == OFF) && (crossing.status(MANUELBETJ) == OFF)) nextState = OPLOES;
+    return nextState;
+  }
+  void onExit(void) {
+    crossing.to(BANESIGNAB, BLOCK);
+    crossing.to(BANESIGNBA, BLOCK);
+    crossing.reset(TAENDSTED);
+  }
+} sikret;
+
+// Tilstand: Bomme går op. Vejlys slukker når bomme er oppe.
+class t_OploesState: public t_StateMachine {
+public:
+  t_OploesState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJBOM, PASS);
+    clockWork.setDuration(Timing.BarrierTime, MSEC);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = IKKESIKRET;
+    return nextState;
+  }
+  void onExit(void) {
+    crossing.to(VEJSIGNAL, PASS);
+  }
+} oploes;
+
+void setup() {
+  // Opsætning af overkørsel fra den valgte tabel
+  pinMode(ARDPin.Valg, INPUT_PULLUP);
+  collection.initialize();
+  konfiguration.build(crossing, (digitalRead(ARDPin.Valg) == HIGH)?&Overkoersel:&OverkoerselUdenBom);
+  // Opsætning af tilstandsmaskine
+  crossing.setState(IKKESIKRET, &ikkesikret);
+  crossing.setState(FORRING, &forring);
+  crossing.setState(BOMNED, &bomned);
+  crossing.setState(SIKRET, &sikret);
+  crossing.setState(OPLOES, &oploes);
+  // Start tilstandsmaskine
+  crossing.initState(IKKESIKRET);
+}
+
+void loop() {
+  Clock::pendulum();
+  Blinker::doClockCycle();
+  crossing.doClockCycle();
+}
+
+#endif
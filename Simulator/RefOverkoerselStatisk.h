@@ -0,0 +1,251 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Reference overkørsel sammensat på oversættelsestidspunktet
+ * Version: 1.0
+ * Type: Program
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Et program bygget efter "Vejledning bygge en overkørsel".
+ * Overkørslen har 2 overkørselssignaler med hvid lanterne, vejlys, vejklokke og 1 sæt vejbomme.
+ * Filen svarer til en .ino fil og inkluderes af simulatorens programmer.
+ * Samme overkørsel som RefOverkoersel.h, men sammensat med t_StaticCrossing uden collection og virtuelle kald.
+ * Tilstande er skrevet efter overkørslen, som opretter tilstandsobjekterne.
+ */
+
+#ifndef RefOverkoerselStatisk_h
+#define RefOverkoerselStatisk_h
+
+// Arduino IDE inkluderer Arduino.h automatisk i en .ino fil
+#include <Arduino.h>
+
+// Tidsenhed til urværk
+enum {MSEC, SECONDS};
+// Kontakttyper for trykknap
+enum {NOPEN, NCLOSED};
+// Overkørslens betjeningsenheder magasin kan konfigureres
+enum {BISTABLE, ONESHOT};
+// Overkørslens betjeningsenheder leverer
+enum {OFF, ON};
+// Overkørslens ydre enheder kan blive sat til
+enum {BLOCK, PASS};
+
+// Betjenings- og sensorenheder
+const byte MaxNoCtrls = 3;
+enum {MANUELBETJ, TAENDSTED, TOGVEJ};
+// Overkørslens ydre enheder
+const byte MaxNoDevices = 5;
+enum {BANESIGNAB, BANESIGNBA, VEJSIGNAL, VEJKLOKKE, VEJBOM};
+// Overkørslens tilstande
+const byte MaxNoStates = 5;
+enum {IKKESIKRET, FORRING, BOMNED, SIKRET, OPLOES};
+#ifdef BrugTimerhjul
+// Urværker: 3 knapper, 1 servomotor, blinker og tilstandsmaskine
+const byte MaxNoTimers = 6;
+#endif
+
+// Overkørslens moduler
+#define BrugVejbom
+#ifndef BrugStatiskOverkoersel
+#define BrugStatiskOverkoersel
+#endif
+#include <Ovkoersel.h>
+
+// Arduino pins
+struct {
+  const byte ManuelKnap = 2;
+  const byte Taendsted = 3;
+  const byte Togvej = 4;
+  const byte OUSignABHvid = 5;
+  const byte OUSignBAHvid = 6;
+  const byte OUSignAB = 7;
+  const byte OUSignBA = 8;
+  const byte ServM = 9;
+  const byte VejKlokker = 10;
+  const byte VejLys = 11;
+} ARDPin;
+
+// Tider til tilstandsmaskine
+struct {
+  const unsigned long Forring = 4;          // Sekunder fra vejlys tænder til bomme går ned
+  const unsigned long BarrierTime = 8000;   // Msek for en bombevægelse
+  const int AngleAdjust = 0;
+} Timing;
+
+// Hardware drivere til den overkørsel, som dette program leverer
+t_PushButton manuelKnapDrv(ARDPin.ManuelKnap, NCLOSED);
+t_PushButton taendstedDrv(ARDPin.Taendsted, NCLOSED);
+t_PushButton togvejDrv(ARDPin.Togvej, NOPEN);
+t_SimpleOnOff OUSignABDrv(ARDPin.OUSignAB, HIGH);
+t_SimpleOnOff OUSignBADrv(ARDPin.OUSignBA, HIGH);
+t_SimpleOnOff OUSignABHvidDrv(ARDPin.OUSignABHvid);
+t_SimpleOnOff OUSignBAHvidDrv(ARDPin.OUSignBAHvid);
+t_SimpleOnOff vejLysDrv(ARDPin.VejLys);
+t_SimpleOnOff vejKlokkerDrv(ARDPin.VejKlokker);
+t_ServoMotor SG90(HIGH);
+
+// Overkørslens betjeningsenheder
+t_CrossingCtrl manuelBetj;
+t_CrossingCtrl taendsted;
+t_CrossingCtrl togvej;
+// Flipflop til manuelknap og tændsted
+t_FlipFlop manFF(NCLOSED);
+t_FlipFlop taendFF(NCLOSED);
+
+// Overkørslens ydre enheder
+t_RailSignal OUSignAB;
+t_RailSignal OUSignBA;
+t_RoadSignal vejLys(PASS);
+t_RoadSignal vejKlokker(PASS);
+t_Barrier vejBom(PASS);
+
+// Tilstande bliver skrevet efter overkørslen
+class t_IkkeSikretState;
+class t_ForringState;
+class t_BomNedState;
+class t_SikretState;
+class t_OploesState;
+
+// Overkørslen sammensat af navngivne enheder og tilstande
+t_StaticCrossing<
+  t_Slots<t_Slot<MANUELBETJ, t_CrossingCtrl, manuelBetj>,
+          t_Slot<TAENDSTED, t_CrossingCtrl, taendsted>,
+          t_Slot<TOGVEJ, t_CrossingCtrl, togvej>>,
+  t_Slots<t_Slot<BANESIGNAB, t_RailSignal, OUSignAB>,
+          t_Slot<BANESIGNBA, t_RailSignal, OUSignBA>,
+          t_Slot<VEJSIGNAL, t_RoadSignal, vejLys>,
+          t_Slot<VEJKLOKKE, t_RoadSignal, vejKlokker>,
+          t_Slot<VEJBOM, t_Barrier, vejBom>>,
+  t_Slots<t_StateSlot<IKKESIKRET, t_IkkeSikretState>,
+          t_StateSlot<FORRING, t_ForringState>,
+          t_StateSlot<BOMNED, t_BomNedState>,
+          t_StateSlot<SIKRET, t_SikretState>,
+          t_StateSlot<OPLOES, t_OploesState>>
+> crossing;
+
+// Tilstand: Overkørsel er slukket. Tænder ved manuel betjening eller ved tændsted passeret med togvej sat.
+class t_IkkeSikretState: public t_StateMachine {
+public:
+  t_IkkeSikretState(void): t_StateMachine() {}
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (crossing.status(MANUELBETJ) == ON) nextState = FORRING;
+    if ((crossing.status(TAENDSTED) == ON) && (crossing.status(TOGVEJ) == ON)) nextState = FORRING;
+    return nextState;
+  }
+};
+
+// Tilstand: Vejlys og vejklokke advarer vejtrafik inden bomme går ned.
+class t_ForringState: public t_StateMachine {
+public:
+  t_ForringState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJSIGNAL, BLOCK);
+    crossing.to(VEJKLOKKE, BLOCK);
+    crossing.reset(TAENDSTED);
+    clockWork.setDuration(Timing.Forring, SECONDS);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = BOMNED;
+    return nextState;
+  }
+};
+
+// Tilstand: Bomme går ned.
+class t_BomNedState: public t_StateMachine {
+public:
+  t_BomNedState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJBOM, BLOCK);
+    clockWork.setDuration(Timing.BarrierTime, MSEC);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = SIKRET;
+    return nextState;
+  }
+};
+
+// Tilstand: Overkørsel er sikret og må passeres af tog. Slukker når togvej er opløst og manuel betjening er slukket.
+class t_SikretState: public t_StateMachine {
+public:
+  t_SikretState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJKLOKKE, PASS);
+    crossing.to(BANESIGNAB, PASS);
+    crossing.to(BANESIGNBA, PASS);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if ((crossing.status(TOGVEJ) == OFF) && (crossing.status(MANUELBETJ) == OFF)) nextState = OPLOES;
+    return nextState;
+  }
+  void onExit(void) {
+    crossing.to(BANESIGNAB, BLOCK);
+    crossing.to(BANESIGNBA, BLOCK);
+    crossing.reset(TAENDSTED);
+  }
+};
+
+// Tilstand: Bomme går op. Vejlys slukker når bomme er oppe.
+class t_OploesState: public t_StateMachine {
+public:
+  t_OploesState(void): t_StateMachine() {}
+  void onEntry(void) {
+    crossing.to(VEJBOM, PASS);
+    clockWork.setDuration(Timing.BarrierTime, MSEC);
+  }
+  byte doCondition(byte currentStateNo) {
+    byte nextState = currentStateNo;
+    if (clockWork.triggered() == true) nextState = IKKESIKRET;
+    return nextState;
+  }
+  void onExit(void) {
+    crossing.to(VEJSIGNAL, PASS);
+  }
+};
+
+void setup() {
+  // Specifikation og start af servomotor til vejbom
+  SG90.startMotor(ARDPin.ServM, Timing.AngleAdjust, Timing.BarrierTime);
+  // Drivere kobles til betjenings- og ydre enheder
+  manuelBetj.setDriver(&manuelKnapDrv);
+  taendsted.setDriver(&taendstedDrv);
+  togvej.setDriver(&togvejDrv);
+  manuelBetj.setFlipFlop(&manFF);
+  taendsted.setFlipFlop(&taendFF, ONESHOT);
+  OUSignAB.setDriver(&OUSignABDrv);
+  OUSignBA.setDriver(&OUSignBADrv);
+  OUSignAB.setWhiteLamp(&OUSignABHvidDrv);
+  OUSignBA.setWhiteLamp(&OUSignBAHvidDrv);
+  vejLys.setDriver(&vejLysDrv);
+  vejKlokker.setDriver(&vejKlokkerDrv);
+  vejBom.setDriver(&SG90);
+  // Start tilstandsmaskine
+  crossing.initState(IKKESIKRET);
+}
+
+void loop() {
+  Clock::pendulum();
+  Blinker::doClockCycle();
+  crossing.doClockCycle();
+}
+
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Reference overkørsel med tilstandstabel
+ * Version: 1.0
+ * Type: Program
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Et program bygget efter "Vejledning bygge en overkørsel".
+ * Overkørslen har 2 overkørselssignaler med hvid lanterne, vejlys, vejklokke og 1 sæt vejbomme.
+ * Filen svarer til en .ino fil og inkluderes af simulatorens programmer.
+ * Samme overkørsel som RefOverkoersel.h, men tilstandsmaskinen er beskrevet i tabeller i flash.
+ */
+
+#ifndef RefOverkoerselTabel_h
+#define RefOverkoerselTabel_h
+
+// Arduino IDE inkluderer Arduino.h automatisk i en .ino fil
+#include <Arduino.h>
+
+// Tidsenhed til urværk
+enum {MSEC, SECONDS};
+// Kontakttyper for trykknap
+enum {NOPEN, NCLOSED};
+// Overkørslens betjeningsenheder magasin kan konfigureres
+enum {BISTABLE, ONESHOT};
+// Overkørslens betjeningsenheder leverer
+enum {OFF, ON};
+// Overkørslens ydre enheder kan blive sat til
+enum {BLOCK, PASS};
+
+// Betjenings- og sensorenheder
+const byte MaxNoCtrls = 3;
+enum {MANUELBETJ, TAENDSTED, TOGVEJ};
+// Overkørslens ydre enheder
+const byte MaxNoDevices = 5;
+enum {BANESIGNAB, BANESIGNBA, VEJSIGNAL, VEJKLOKKE, VEJBOM};
+// Overkørslens tilstande
+const byte MaxNoStates = 5;
+enum {IKKESIKRET, FORRING, BOMNED, SIKRET, OPLOES};
+#ifdef BrugTimerhjul
+// Urværker: 3 knapper, 1 servomotor, blinker og tilstandsmaskine
+const byte MaxNoTimers = 6;
+#endif
+
+// Overkørslens moduler
+#define BrugVejbom
+#ifndef BrugTilstandstabel
+#define BrugTilstandstabel
+#endif
+#include <Ovkoersel.h>
+
+// Arduino pins
+struct {
+  const byte ManuelKnap = 2;
+  const byte Taendsted = 3;
+  const byte Togvej = 4;
+  const byte OUSignABHvid = 5;
+  const byte OUSignBAHvid = 6;
+  const byte OUSignAB = 7;
+  const byte OUSignBA = 8;
+  const byte ServM = 9;
+  const byte VejKlokker = 10;
+  const byte VejLys = 11;
+} ARDPin;
+
+// Tider til tilstandsmaskine
+const unsigned int ForringSek = 4;           // Sekunder fra vejlys tænder til bomme går ned
+const unsigned int BomTidMsek = 8000;        // Msek for en bombevægelse
+
+// Tider til servomotor
+struct {
+  const unsigned long BarrierTime = BomTidMsek;   // Msek for en bombevægelse
+  const int AngleAdjust = 0;
+} Timing;
+
+// Hardware drivere til den overkørsel, som dette program leverer
+t_PushButton manuelKnapDrv(ARDPin.ManuelKnap, NCLOSED);
+t_PushButton taendstedDrv(ARDPin.Taendsted, NCLOSED);
+t_PushButton togvejDrv(ARDPin.Togvej, NOPEN);
+t_SimpleOnOff OUSignABDrv(ARDPin.OUSignAB, HIGH);
+t_SimpleOnOff OUSignBADrv(ARDPin.OUSignBA, HIGH);
+t_SimpleOnOff OUSignABHvidDrv(ARDPin.OUSignABHvid);
+t_SimpleOnOff OUSignBAHvidDrv(ARDPin.OUSignBAHvid);
+t_SimpleOnOff vejLysDrv(ARDPin.VejLys);
+t_SimpleOnOff vejKlokkerDrv(ARDPin.VejKlokker);
+t_ServoMotor SG90(HIGH);
+
+// Overkørslens betjeningsenheder
+t_CrossingCtrl manuelBetj;
+t_CrossingCtrl taendsted;
+t_CrossingCtrl togvej;
+// Flipflop til manuelknap og tændsted
+t_FlipFlop manFF(NCLOSED);
+t_FlipFlop taendFF(NCLOSED);
+
+// Overkørslens ydre enheder
+t_RailSignal OUSignAB;
+t_RailSignal OUSignBA;
+t_RoadSignal vejLys(PASS);
+t_RoadSignal vejKlokker(PASS);
+t_Barrier vejBom(PASS);
+
+// Overgange sorteret efter tilstand. Første opfyldte overgang vælges.
+// IKKESIKRET: Tænder ved manuel betjening eller ved tændsted passeret med togvej sat.
+// FORRING: Vejlys og vejklokke advarer vejtrafik inden bomme går ned.
+// BOMNED: Bomme går ned.
+// SIKRET: Overkørsel er sikret og må passeres af tog. Slukker når togvej er opløst og manuel betjening er slukket.
+// OPLOES: Bomme går op. Vejlys slukker når bomme er oppe.
+constexpr StateTable::t_Transition Overgange[] PROGMEM = {
+  {IKKESIKRET, StateTable::ctrl(MANUELBETJ), 0, false, FORRING},
+  {IKKESIKRET, StateTable::ctrl(TAENDSTED) | StateTable::ctrl(TOGVEJ), 0, false, FORRING},
+  {FORRING, 0, 0, true, BOMNED},
+  {BOMNED, 0, 0, true, SIKRET},
+  {SIKRET, 0, StateTable::ctrl(TOGVEJ) | StateTable::ctrl(MANUELBETJ), false, OPLOES},
+  {OPLOES, 0, 0, true, IKKESIKRET},
+};
+
+// Handlinger sorteret efter tilstand
+constexpr StateTable::t_Action Handlinger[] PROGMEM = {
+  {FORRING, StateTable::ENTRY, StateTable::TO, VEJSIGNAL, BLOCK},
+  {FORRING, StateTable::ENTRY, StateTable::TO, VEJKLOKKE, BLOCK},
+  {FORRING, StateTable::ENTRY, StateTable::RESET, TAENDSTED, 0},
+  {FORRING, StateTable::ENTRY, StateTable::SECONDS, 0, ForringSek},
+  {BOMNED, StateTable::ENTRY, StateTable::TO, VEJBOM, BLOCK},
+  {BOMNED, StateTable::ENTRY, StateTable::MSEC, 0, BomTidMsek},
+  {SIKRET, StateTable::ENTRY, StateTable::TO, VEJKLOKKE, PASS},
+  {SIKRET, StateTable::ENTRY, StateTable::TO, BANESIGNAB, PASS},
+  {SIKRET, StateTable::ENTRY, StateTable::TO, BANESIGNBA, PASS},
+  {SIKRET, StateTable::EXIT, StateTable::TO, BANESIGNAB, BLOCK},
+  {SIKRET, StateTable::EXIT, StateTable::TO, BANESIGNBA, BLOCK},
+  {SIKRET, StateTable::EXIT, StateTable::RESET, TAENDSTED, 0},
+  {OPLOES, StateTable::ENTRY, StateTable::TO, VEJBOM, PASS},
+  {OPLOES, StateTable::ENTRY, StateTable::MSEC, 0, BomTidMsek},
+  {OPLOES, StateTable::EXIT, StateTable::TO, VEJSIGNAL, PASS},
+};
+
+// Tilstandsmaskinen tjekkes ved oversættelse
+static_assert(StateTable::isSorted(Overgange) && StateTable::isSorted(Handlinger), "Tilstandstabel er ikke sorteret efter tilstand");
+static_assert(StateTable::reachable(Overgange, IKKESIKRET) == StateTable::stateBit(MaxNoStates)-1, "En tilstand kan ikke nås");
+static_assert(StateTable::deadEnds(Overgange) == 0, "En tilstand har ingen overgang");
+
+void setup() {
+  // Specifikation og start af servomotor til vejbom
+  SG90.startMotor(ARDPin.ServM, Timing.AngleAdjust, Timing.BarrierTime);
+  // Drivere kobles til betjenings- og ydre enheder
+  manuelBetj.setDriver(&manuelKnapDrv);
+  taendsted.setDriver(&taendstedDrv);
+  togvej.setDriver(&togvejDrv);
+  manuelBetj.setFlipFlop(&manFF);
+  taendsted.setFlipFlop(&taendFF, ONESHOT);
+  OUSignAB.setDriver(&OUSignABDrv);
+  OUSignBA.setDriver(&OUSignBADrv);
+  OUSignAB.setWhiteLamp(&OUSignABHvidDrv);
+  OUSignBA.setWhiteLamp(&OUSignBAHvidDrv);
+  vejLys.setDriver(&vejLysDrv);
+  vejKlokker.setDriver(&vejKlokkerDrv);
+  vejBom.setDriver(&SG90);
+  // Opsætning af overkørsel
+  collection.initialize();
+  crossing.setCtrl(MANUELBETJ, &manuelBetj);
+  crossing.setCtrl(TAENDSTED, &taendsted);
+  crossing.setCtrl(TOGVEJ, &togvej);
+  crossing.setDevice(BANESIGNAB, &OUSignAB);
+  crossing.setDevice(BANESIGNBA, &OUSignBA);
+  crossing.setDevice(VEJSIGNAL, &vejLys);
+  crossing.setDevice(VEJKLOKKE, &vejKlokker);
+  crossing.setDevice(VEJBOM, &vejBom);
+  // Opsætning af tilstandsmaskine
+  crossing.setTable(Overgange, Handlinger);
+  // Start tilstandsmaskine
+  crossing.initState(IKKESIKRET);
+}
+
+void loop() {
+  Clock::pendulum();
+  Blinker::doClockCycle();
+  crossing.doClockCycle();
+}
+
+#endif
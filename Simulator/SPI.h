@@ -0,0 +1,118 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: SPI stedfortræder til simulering på Linux
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Samme grænseflade som Arduino SPI biblioteket. Bussen har en kæde af 74HC595 og en kæde af 74HC165,
+ * hvis ben kan forbindes til simulatorens kort. Transaktioner, bytes og bustid bliver talt.
+ */
+
+#ifndef SPI_h
+#define SPI_h
+
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define LSBFIRST 0
+#define SPI_MODE0 0
+
+// Ansvar: Spejler indstillinger til en SPI transaktion.
+// clock: Busfrekvens i Hz
+struct SPISettings {
+  unsigned long clock;
+  SPISettings(void): clock(4000000) {}
+  SPISettings(unsigned long a_clock, uint8_t, uint8_t): clock(a_clock) {}
+};
+
+// Ansvar: Spejler skifteregistre på SPI bussen.
+// MaxNoBytes: Længste kæde af hver slags
+// t_Counters: transactions, bytes: Antal transaktioner og bytes. micros: Bustid i µsek ved transaktionens busfrekvens
+// outPins, outConnected: Kortets ben for hver udgang på 74HC595 og hvilke der er forbundet. Byte 0 er nærmest arduino
+// inPins, inConnected: Kortets ben for hver indgang på 74HC165 og hvilke der er forbundet. En indgang der ikke er forbundet er høj
+// shift, storage: 74HC595 skifteregistre og udgangsregistre
+// parallel: 74HC165 registre
+// count, clock: Tællere og busfrekvens for aktuel transaktion
+// connectOut(...), connectIn(...): Forbinder en udgang eller indgang til et ben på kortet
+// transfer(...): Skifter en byte ind i 74HC595 og ud af 74HC165
+// latch(...): Overfører skifteregistre til udgange og kortets ben. Kaldes ved stigende flanke på latch
+// load(...): Indlæser indgange fra kortets ben. Kaldes ved faldende flanke på load
+namespace Sim {
+  namespace SpiBus {
+    const byte MaxNoBytes = 4;
+    struct t_Counters {
+      unsigned long transactions;
+      unsigned long bytes;
+      double micros;
+    };
+    inline byte outPins[MaxNoBytes*8];
+    inline uint32_t outConnected = 0;
+    inline byte inPins[MaxNoBytes*8];
+    inline uint32_t inConnected = 0;
+    inline byte shift[MaxNoBytes];
+    inline byte storage[MaxNoBytes];
+    inline byte parallel[MaxNoBytes];
+    inline t_Counters count;
+    inline unsigned long clock = 4000000;
+
+    inline void connectOut(byte bit, byte pin) {outPins[bit] = pin; outConnected |= (1UL << bit);}
+    inline void connectIn(byte bit, byte pin) {inPins[bit] = pin; inConnected |= (1UL << bit);}
+
+    inline uint8_t transfer(uint8_t data) {
+      count.bytes++;
+      count.micros += 8.0e6/clock;
+      for (byte pos = MaxNoBytes-1; pos > 0; pos--) shift[pos] = shift[pos-1];
+      shift[0] = data;
+      uint8_t result = parallel[0];
+      for (byte pos = 0; pos+1 < MaxNoBytes; pos++) parallel[pos] = parallel[pos+1];
+      parallel[MaxNoBytes-1] = 0xFF;
+      return result;
+    }
+
+    inline void latch(void) {
+      for (byte pos = 0; pos < MaxNoBytes; pos++) storage[pos] = shift[pos];
+      for (byte bit = 0; bit < MaxNoBytes*8; bit++)
+        if ((outConnected & (1UL << bit)) != 0) writePin(outPins[bit], (storage[bit/8] >> (bit%8)) & 1);
+    }
+
+    inline void load(void) {
+      for (byte pos = 0; pos < MaxNoBytes; pos++) parallel[pos] = 0xFF;
+      for (byte bit = 0; bit < MaxNoBytes*8; bit++)
+        if (((inConnected & (1UL << bit)) != 0) && (pinLevel(inPins[bit]) == LOW)) parallel[bit/8] &= ~(1 << (bit%8));
+    }
+  }
+}
+
+// Ansvar: Spejler SPI bussen som Arduino SPI biblioteket.
+class SPIClass {
+public:
+  void begin(void) {}
+  void beginTransaction(SPISettings settings) {
+    Sim::SpiBus::clock = settings.clock;
+    Sim::SpiBus::count.transactions++;
+  }
+  uint8_t transfer(uint8_t data) {return Sim::SpiBus::transfer(data);}
+  void endTransaction(void) {}
+};
+
+inline SPIClass SPI;
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Servo stedfortræder til simulering på Linux
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Samme grænseflade som Arduino Servo biblioteket. Pulsbredder registreres på simulatorens kort.
+ */
+
+#ifndef Servo_h
+#define Servo_h
+
+#include <Arduino.h>
+
+#define MIN_PULSE_WIDTH 544
+#define MAX_PULSE_WIDTH 2400
+#define DEFAULT_PULSE_WIDTH 1500
+
+// Ansvar: Spejler en servomotor tilkoblet en port.
+// pin: Arduino portnr
+// isAttached: Servo er koblet til port
+// minPW, maxPW: Pulsbredde ved 0 og 180 grader
+// pulseWidth: Sidst skrevne pulsbredde i µsek
+class Servo {
+private:
+  byte pin;
+  bool isAttached;
+  int minPW;
+  int maxPW;
+  int pulseWidth;
+public:
+  Servo(void): pin(0), isAttached(false), minPW(MIN_PULSE_WIDTH), maxPW(MAX_PULSE_WIDTH), pulseWidth(DEFAULT_PULSE_WIDTH) {}
+  uint8_t attach(int a_pin) {return attach(a_pin, MIN_PULSE_WIDTH, MAX_PULSE_WIDTH);}
+  uint8_t attach(int a_pin, int a_min, int a_max) {
+    pin = a_pin; minPW = a_min; maxPW = a_max; isAttached = true;
+    return pin;
+  }
+  void detach(void) {isAttached = false;}
+  bool attached(void) {return isAttached;}
+  void write(int angle) {writeMicroseconds(map(constrain(angle, 0, 180), 0, 180, minPW, maxPW));}
+  void writeMicroseconds(int a_pulseWidth) {
+    pulseWidth = a_pulseWidth;
+    if (isAttached == true) Sim::servoWrite(pin, pulseWidth);
+  }
+  int read(void) {return map(pulseWidth, minPW, maxPW, 0, 180);}
+  int readMicroseconds(void) {return pulseWidth;}
+};
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Script til indgange i simulering
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Et script er en tekstfil med en linje per indgangsændring: <msek> <pin> <niveau>
+ * Tekst efter # er kommentar.
+ */
+
+#ifndef SimScript_h
+#define SimScript_h
+
+#include <Arduino.h>
+#include <stdio.h>
+
+// Ansvar: Indlæser og danner scripts med indgangsændringer til simulatorens kort.
+// loadFile(...): Indlæser script fra fil. Leverer falsk hvis filen ikke kan læses
+// addPulse(...): Trykker en kontakt i et tidsrum. Hvilende niveau er givet af kontakttypen
+// addTrainSchedule(...): Danner en togplan, hvor et tog passerer med faste mellemrum
+namespace SimScript {
+  inline bool loadFile(const char *fileName) {
+    FILE *file = fopen(fileName, "r");
+    if (file == nullptr) return false;
+    char line[128];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      unsigned long atMillis;
+      unsigned int pin, level;
+      for (char *p = line; *p != '\0'; p++) if (*p == '#') {*p = '\0'; break;}
+      if (sscanf(line, "%lu %u %u", &atMillis, &pin, &level) == 3) Sim::addInput(atMillis, pin, level);
+    }
+    fclose(file);
+    return true;
+  }
+
+  inline void addPulse(unsigned long atMillis, byte pin, bool normallyClosed, unsigned long length) {
+    Sim::addInput(atMillis, pin, (normallyClosed == true)?LOW:HIGH);
+    Sim::addInput(atMillis+length, pin, (normallyClosed == true)?HIGH:LOW);
+  }
+
+  // Tog: Togvej sættes, tændsted passeres 5 sek senere og togvej opløses efter 60 sek.
+  // Hvert 7. tog bliver overkørslen i stedet tændt og slukket manuelt.
+  inline void addTrainSchedule(unsigned long untilMillis, unsigned long period, byte manuelPin, byte taendPin, byte togvejPin) {
+    unsigned long train = 0;
+    for (unsigned long at = 10000; at+90000 < untilMillis; at += period, train++) {
+      if ((train % 7) == 6) {
+        addPulse(at, manuelPin, true, 200);
+        addPulse(at+60000, manuelPin, true, 200);
+      }
+      else {
+        Sim::addInput(at, togvejPin, HIGH);
+        addPulse(at+5000, taendPin, true, 300);
+        Sim::addInput(at+60000, togvejPin, LOW);
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Afkodning af sporing i simulering
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Afkoder udskrifter fra Trace::dump(...) og Trace::drain(...). En fil kan indeholde flere udskrifter efter hinanden.
+ * Kræver at BrugSporing er defineret før OvkTrace.h inkluderes.
+ */
+
+#ifndef SimSpor_h
+#define SimSpor_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "OvkTrace.h"
+
+// Ansvar: Afkoder sporing til en liste af hændelser med absolut klokcyklus.
+// t_Event: En hændelse. type og data som i Trace::record(...)
+// clockCycle: Msek per klokcyklus fra seneste udskrift
+// noDumps, badChecks: Antal afkodede udskrifter og antal med forkert kontrolsum
+// error: Beskrivelse af fejl, når decode(...) eller loadFile(...) leverer falsk
+// decode(...): Afkoder alle udskrifter i data og tilføjer hændelserne til events
+// loadFile(...): Læser en fil og afkoder den
+namespace SimSpor {
+  struct t_Event {
+    unsigned long cycle;
+    byte type;
+    byte data;
+    bool operator==(const t_Event &other) const {return (cycle == other.cycle) && (type == other.type) && (data == other.data);}
+  };
+
+  inline unsigned int clockCycle = 0;
+  inline unsigned long noDumps = 0;
+  inline unsigned long badChecks = 0;
+  inline std::string error;
+
+  inline bool decode(const std::vector<byte> &data, std::vector<t_Event> &events) {
+    size_t start = 0;
+    while (start < data.size()) {
+      const byte *dump = data.data()+start;
+      if ((data.size()-start < Trace::HeaderSize+1) || (dump[0] != Trace::Magic[0]) || (dump[1] != Trace::Magic[1])) {
+        error = "Ikke en udskrift fra Trace::dump(...) ved byte "+std::to_string(start);
+        return false;
+      }
+      if (dump[2] != Trace::Version) {
+        error = "Ukendt version "+std::to_string(dump[2]);
+        return false;
+      }
+      clockCycle = dump[3];
+      unsigned long cycle = dump[4] | (dump[5] << 8) | ((unsigned long)dump[6] << 16) | ((unsigned long)dump[7] << 24);
+      size_t used = dump[8] | (dump[9] << 8);
+      if (data.size()-start < Trace::HeaderSize+used+1) {
+        error = "Udskriften er afkortet: "+std::to_string(data.size()-start-Trace::HeaderSize)+" af "+std::to_string(used+1)+" byte";
+        return false;
+      }
+      const byte *body = dump+Trace::HeaderSize;
+      byte check = 0;
+      for (size_t pos = 0; pos < used; pos++) check += body[pos];
+      if (check != body[used]) badChecks++;
+
+      size_t pos = 0;
+      bool first = true;
+      while (pos < used) {
+        byte type = body[pos] >> 5;
+        unsigned long delta = body[pos] & Trace::LongDelta;
+        pos++;
+        if (delta == Trace::LongDelta) {
+          delta = 0;
+          byte shift = 0;
+          while (pos < used) {
+            delta |= (unsigned long)(body[pos] & 0x7F) << shift;
+            shift += 7;
+            if ((body[pos++] & 0x80) == 0) break;
+          }
+        }
+        if (pos >= used) {
+          error = "Hændelse uden data ved byte "+std::to_string(start+Trace::HeaderSize+pos);
+          return false;
+        }
+        // Ældste hændelse står på tailCycle, de følgende er relative til forrige
+        if (first == false) cycle += delta;
+        first = false;
+        events.push_back(t_Event{cycle, type, body[pos++]});
+      }
+      start += Trace::HeaderSize+used+1;
+      noDumps++;
+    }
+    return true;
+  }
+
+  inline bool loadFile(const char *fileName, std::vector<t_Event> &events) {
+    FILE *file = fopen(fileName, "rb");
+    if (file == nullptr) {
+      error = std::string("Kan ikke læse: ")+fileName;
+      return false;
+    }
+    std::vector<byte> data;
+    int value;
+    while ((value = fgetc(file)) != EOF) data.push_back(value);
+    fclose(file);
+    return decode(data, events);
+  }
+}
+
+#endif
@@ -0,0 +1,210 @@
+/*
+ * Projekt: Overkørsel st. enkeltsporet strækning
+ * Produkt: Wire stedfortræder til simulering på Linux
+ * Version: 1.0
+ * Type: Simulator
+ * Programmeret af: Jan Birch
+ * Opdateret: 17-10-2026
+ * GNU General Public License version 3
+ * This file is part of Overkørsel simulator.
+ *
+ * "Overkørsel simulator" is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * "Overkørsel simulator" is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with "Overkørsel simulator".  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Noter:
+ * Samme grænseflade som Arduino Wire biblioteket for en I2C master. På bussen kan der være MCP23017 på adresse 0x20-0x27,
+ * hvis ben kan forbindes til simulatorens kort. Registre følger IOCON.BANK=0. Transaktioner, bytes og bustid bliver talt.
+ * Bussen kan sættes til at hænge. Med setWireTimeout(...) fejler transaktionen efter timeout som i Arduino Wire,
+ * uden bliver den talt som en transaktion, der ville hænge for evigt.
+ */
+
+#ifndef Wire_h
+#define Wire_h
+
+#include <Arduino.h>
+
+#define WIRE_HAS_TIMEOUT
+
+// Ansvar: Spejler MCP23017 på I2C bussen.
+// BaseAddress, MaxNoDevices: Adresser der kan have en MCP23017
+// IODIRA, GPPUA, GPIOA, OLATA: Registre for port A. Port B har næste adresse
+// NoRegisters: Antal registre
+// t_Counters: transactions, bytes: Antal transaktioner og bytes inklusiv adressebyte. micros: Bustid i µsek
+//   timeouts, hangs: Transaktioner på hængt bus med og uden timeout
+// t_Device: present: Svarer på sin adresse. reg: Registre. pointer: Aktuelt register
+//   pins, connected: Kortets ben for hver af de 16 ben og hvilke der er forbundet. GPA0-7 er 0-7 og GPB0-7 er 8-15
+// devices, count, clock: Enheder, tællere og busfrekvens
+// timeout: Timeout i µsek fra setWireTimeout(...). 0 venter for evigt. isStuck: Bussen hænger
+// add(...): Sætter en MCP23017 på bussen
+// connect(...): Forbinder et ben på MCP23017 til et ben på kortet
+// update(...): Skriver udgange til kortets ben
+// readRegister(...), writeRegister(...): Læser og skriver et register. Læsning af GPIO giver indgange fra kortet og udgange fra OLAT
+// charge(...): Tæller en transaktion med et antal bytes
+// isBlocked(...): Svarer på om bussen hænger og tæller timeout eller hængt transaktion
+namespace Sim {
+  namespace I2cBus {
+    const byte BaseAddress = 0x20;
+    const byte MaxNoDevices = 8;
+    enum {IODIRA = 0x00, GPPUA = 0x0C, GPIOA = 0x12, OLATA = 0x14, NoRegisters = 0x16};
+    struct t_Counters {
+      unsigned long transactions;
+      unsigned long bytes;
+      double micros;
+      unsigned long timeouts;
+      unsigned long hangs;
+    };
+    struct t_Device {
+      bool present;
+      byte reg[NoRegisters];
+      byte pointer;
+      byte pins[16];
+      unsigned int connected;
+    };
+    inline t_Device devices[MaxNoDevices];
+    inline t_Counters count;
+    inline unsigned long clock = 100000;
+    inline unsigned long timeout = 0;
+    inline bool isStuck = false;
+
+    inline t_Device *device(byte address) {
+      if ((address < BaseAddress) || (address >= BaseAddress+MaxNoDevices)) return nullptr;
+      t_Device &item = devices[address-BaseAddress];
+      return (item.present == true)?&item:nullptr;
+    }
+
+    inline void add(byte address) {
+      if ((address < BaseAddress) || (address >= BaseAddress+MaxNoDevices)) return;
+      t_Device &item = devices[address-BaseAddress];
+      item = t_Device();
+      item.present = true;
+      item.reg[IODIRA] = item.reg[IODIRA+1] = 0xFF;
+    }
+
+    inline void connect(byte address, byte bit, byte pin) {
+      if ((address < BaseAddress) || (address >= BaseAddress+MaxNoDevices)) return;
+      devices[address-BaseAddress].pins[bit] = pin;
+      devices[address-BaseAddress].connected |= (1U << bit);
+    }
+
+    inline void update(t_Device &item) {
+      for (byte bit = 0; bit < 16; bit++) {
+        bool isOutput = ((item.reg[IODIRA+bit/8] >> (bit%8)) & 1) == 0;
+        if (((item.connected & (1U << bit)) != 0) && (isOutput == true)) writePin(item.pins[bit], (item.reg[OLATA+bit/8] >> (bit%8)) & 1);
+      }
+    }
+
+    inline byte readRegister(t_Device &item, byte reg) {
+      if ((reg != GPIOA) && (reg != GPIOA+1)) return item.reg[reg];
+      byte port = reg-GPIOA;
+      byte value = item.reg[OLATA+port] & ~item.reg[IODIRA+port];
+      for (byte bit = 0; bit < 8; bit++) {
+        byte pin = port*8+bit;
+        if (((item.reg[IODIRA+port] >> bit) & 1) == 0) continue;
+        bool level = ((item.reg[GPPUA+port] >> bit) & 1) != 0;
+        if (((item.connected & (1U << pin)) != 0) && (board->driven[item.pins[pin]] == true)) level = board->input[item.pins[pin]];
+        if (level == HIGH) value |= (1 << bit);
+      }
+      return value;
+    }
+
+    inline void writeRegister(t_Device &item, byte reg, byte value) {
+      if ((reg == GPIOA) || (reg == GPIOA+1)) reg += OLATA-GPIOA;
+      item.reg[reg] = value;
+      update(item);
+    }
+
+    inline void charge(byte noBytes) {
+      count.transactions++;
+      count.bytes += 1+noBytes;
+      count.micros += (9.0*(1+noBytes)+2)*1.0e6/clock;
+    }
+
+    inline bool isBlocked(void) {
+      if (isStuck == false) return false;
+      if (timeout == 0) count.hangs++;
+      else {
+        count.timeouts++;
+        count.micros += timeout;
+      }
+      return true;
+    }
+  }
+}
+
+// Ansvar: Spejler I2C bussen som Arduino Wire biblioteket.
+// address, buffer, noBuffered: Transmission under opbygning
+// rxBuffer, noReceived, rxPos: Modtagne bytes
+// isRestart: Forrige transmission sluttede uden stop, så næste hører til samme transaktion
+class TwoWire {
+private:
+  byte address;
+  byte buffer[32];
+  byte noBuffered;
+  byte rxBuffer[32];
+  byte noReceived;
+  byte rxPos;
+  bool isRestart;
+public:
+  TwoWire(void): address(0), noBuffered(0), noReceived(0), rxPos(0), isRestart(false) {}
+  void begin(void) {}
+  void setClock(unsigned long a_clock) {Sim::I2cBus::clock = a_clock;}
+  void setWireTimeout(uint32_t a_timeout = 25000, bool = false) {Sim::I2cBus::timeout = a_timeout;}
+  void beginTransmission(uint8_t a_address) {
+    address = a_address;
+    noBuffered = 0;
+  }
+  size_t write(uint8_t data) {
+    if (noBuffered >= sizeof(buffer)) return 0;
+    buffer[noBuffered++] = data;
+    return 1;
+  }
+  uint8_t endTransmission(bool stop = true) {
+    Sim::I2cBus::charge(noBuffered);
+    if (isRestart == true) Sim::I2cBus::count.transactions--;
+    isRestart = !stop;
+    if (Sim::I2cBus::isBlocked() == true) {
+      isRestart = false;
+      return 5;
+    }
+    Sim::I2cBus::t_Device *item = Sim::I2cBus::device(address);
+    if (item == nullptr) return 2;
+    if (noBuffered == 0) return 0;
+    item->pointer = buffer[0];
+    for (byte pos = 1; pos < noBuffered; pos++) {
+      if (item->pointer < Sim::I2cBus::NoRegisters) Sim::I2cBus::writeRegister(*item, item->pointer, buffer[pos]);
+      item->pointer++;
+    }
+    return 0;
+  }
+  uint8_t requestFrom(uint8_t a_address, uint8_t quantity) {
+    if (quantity > sizeof(rxBuffer)) quantity = sizeof(rxBuffer);
+    Sim::I2cBus::charge(quantity);
+    if (isRestart == true) Sim::I2cBus::count.transactions--;
+    isRestart = false;
+    noReceived = rxPos = 0;
+    if (Sim::I2cBus::isBlocked() == true) return 0;
+    Sim::I2cBus::t_Device *item = Sim::I2cBus::device(a_address);
+    if (item == nullptr) return 0;
+    for (byte pos = 0; pos < quantity; pos++) {
+      rxBuffer[noReceived++] = (item->pointer < Sim::I2cBus::NoRegisters)?Sim::I2cBus::readRegister(*item, item->pointer):0;
+      item->pointer++;
+    }
+    return noReceived;
+  }
+  int available(void) const {return noReceived-rxPos;}
+  int read(void) {return (rxPos < noReceived)?rxBuffer[rxPos++]:-1;}
+};
+
+inline TwoWire Wire;
+
+#endif